@@ -0,0 +1,103 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <Arduino.h>
+#include "debug_config.h"
+
+// Subsystems that heap allocations are attributed to
+enum class AllocTag : uint8_t {
+    SYSTEM = 0,   // Anything outside a tagged scope
+    AUDIO,
+    WEATHER,
+    UI,
+    CONFIG,
+    ALARM,
+    SENSOR,
+    NETWORK,
+    COUNT
+};
+
+/**
+ * Allocation tracing per subsystem
+ *
+ * ALLOC_SCOPE(AllocTag::AUDIO) marks the rest of the enclosing scope as belonging
+ * to a subsystem (per task, nesting restores the outer tag). Two things are
+ * accounted against the active tag:
+ *
+ *  - Every C++ new/delete, exactly: the global operators are replaced and each
+ *    block carries a small header with its size, tag and memory region, so live
+ *    bytes and counts are tracked separately for internal RAM and PSRAM.
+ *  - The net heap change of the scope as a whole, which also captures malloc-based
+ *    allocations such as Arduino String and ArduinoJson pools.
+ *
+ * snapshot()/printDiff() compare two points in time, and the 'alloc leakcheck N'
+ * console command runs N radio play/stop cycles and reports any growth.
+ *
+ * With ALLOC_TRACE=0 (the default) everything is compiled out.
+ */
+
+#if ALLOC_TRACE
+
+struct AllocCounters {
+    int32_t liveBytes;
+    int32_t liveCount;
+    uint32_t totalAllocs;
+    int32_t scopeNetBytes;   // Net free-heap change across tagged scopes
+};
+
+struct AllocSnapshot {
+    AllocCounters internal[(int)AllocTag::COUNT];
+    AllocCounters psram[(int)AllocTag::COUNT];
+    uint32_t freeInternal;
+    uint32_t freePsram;
+};
+
+class AllocTracker {
+public:
+    static const char* tagName(AllocTag tag);
+
+    // Tag bookkeeping for the calling task
+    static AllocTag currentTag();
+    static AllocTag exchangeTag(AllocTag tag);
+
+    // Called by the replaced operators new/delete
+    static void onAlloc(AllocTag tag, bool psram, size_t size);
+    static void onFree(AllocTag tag, bool psram, size_t size);
+
+    // Called by AllocScope with the heap change observed during the scope
+    static void onScopeDelta(AllocTag tag, int32_t internalDelta, int32_t psramDelta);
+
+    static void snapshot(AllocSnapshot& out);
+    static void printSnapshot(const AllocSnapshot& snap);
+    static void printDiff(const AllocSnapshot& before, const AllocSnapshot& after);
+
+    // Register the 'alloc' console command
+    static void begin();
+
+    // Drives a running leak check, call from loop()
+    static void loop();
+};
+
+class AllocScope {
+public:
+    explicit AllocScope(AllocTag tag);
+    ~AllocScope();
+
+private:
+    AllocTag tag;
+    AllocTag previous;
+    uint32_t freeInternalBefore;
+    uint32_t freePsramBefore;
+};
+
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+#define ALLOC_SCOPE(tag) AllocScope ALLOC_CONCAT(_alloc_scope_, __LINE__)(tag)
+
+#else
+
+#define ALLOC_SCOPE(tag) do {} while (0)
+
+#endif // ALLOC_TRACE
+
+#endif // ALLOC_TRACKER_H
@@ -2,6 +2,7 @@
 #define _AUDIO_MANAGER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include "AudioTools.h"
 #include "AudioTools/AudioCodecs/CodecMP3Helix.h"
 // Resolve STACK_SIZE macro collision with EEZ-Flow
@@ -9,6 +10,9 @@
 #undef STACK_SIZE
 #endif
 
+// A new stream counts as starting for this long after connecting
+#define AUDIO_START_SETTLE_MS 8000
+
 class AudioManager {
 public:
     AudioManager();
@@ -21,6 +25,18 @@ public:
     uint8_t getVolume();
     bool isPlaying();
 
+    // True while a stream is being connected and while it fills its buffer;
+    // other network work (weather fetches) waits meanwhile
+    bool isStarting() const;
+
+    // Total time the audio task has spent in StreamCopy::copy(), in microseconds
+    // (wraps; use differences). Used by the 'bench' console command.
+    uint32_t getCopyTimeUs() const { return copy_time_us.load(std::memory_order_relaxed); }
+
+    // Total bytes decoded since boot (wraps). Used to detect the first audio
+    // after a standby wake.
+    uint32_t getTotalBytes() const { return total_bytes.load(std::memory_order_relaxed); }
+
 private:
     // Arduino Audio Tools components
     audio_tools::URLStream url;
@@ -43,6 +59,13 @@ private:
     String pending_url;
     bool _internal_connecttohost(const char* host);
 
+    // Stream statistics: written by the audio task, staged for the UI by loop()
+    std::atomic<uint32_t> bytes_copied;
+    std::atomic<uint32_t> total_bytes;
+    std::atomic<uint32_t> copy_time_us;
+    uint32_t last_stats_time;
+    uint32_t start_time;        // millis() when the current stream was connected
+
     // Legacy members (kept for compatibility)
     const char* current_host = nullptr;
     uint8_t volume = 100;
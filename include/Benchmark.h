@@ -0,0 +1,26 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+
+// Number of full-screen redraws timed by one 'bench' run
+#define BENCH_FRAME_COUNT 30
+
+/**
+ * Build profile benchmark
+ *
+ * The 'bench' console command forces BENCH_FRAME_COUNT full redraws of the
+ * active screen and reports render+flush time per frame, together with the
+ * share of one core the audio task spent in StreamCopy::copy() meanwhile.
+ * Running it on the debug and the release build (with the same screen and,
+ * for the audio figure, the same station playing) compares the two profiles.
+ */
+class Benchmark {
+public:
+    // Register the 'bench' console command
+    static void begin();
+
+    static void run();
+};
+
+#endif // BENCHMARK_H
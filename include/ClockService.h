@@ -0,0 +1,78 @@
+#ifndef CLOCK_SERVICE_H
+#define CLOCK_SERVICE_H
+
+#include <Arduino.h>
+#include <time.h>
+
+#define MAX_CLOCK_SUBSCRIBERS 8
+
+// Boundary events, combined as a bit mask
+enum ClockEvent : uint8_t {
+    CLOCK_SECOND = 1 << 0,
+    CLOCK_MINUTE = 1 << 1,
+    CLOCK_HOUR   = 1 << 2,
+    CLOCK_DAY    = 1 << 3,
+    CLOCK_DST    = 1 << 4,   // Daylight saving time started or ended
+    CLOCK_SYNC   = 1 << 5,   // Clock became valid or jumped (NTP); all other bits are set too
+    CLOCK_ALL    = 0x3F
+};
+
+struct ClockSnapshot {
+    time_t epoch;
+    struct tm local;
+    bool valid;              // False until the clock has been set (NTP or RTC)
+};
+
+typedef void (*ClockCallback)(const ClockSnapshot& snapshot, uint8_t events, void* context);
+
+/**
+ * @brief Single source of wall-clock time for the loop task
+ *
+ * The local time is converted once per second into a cached snapshot.
+ * tick() (called from loop()) notifies subscribers whose event mask
+ * matches the boundaries crossed since the previous tick, so the UI, the
+ * standby scheduler and the forecast summaries no longer poll and convert
+ * the time independently.
+ *
+ * Not thread-safe: use from the loop task only.
+ */
+class ClockService {
+public:
+    // Delete copy constructor and assignment operator
+    ClockService(ClockService const&) = delete;
+    void operator=(ClockService const&) = delete;
+
+    // Get singleton instance
+    static ClockService* getInstance();
+
+    // Register a callback for the events in 'mask'; false if the table is full
+    bool subscribe(uint8_t mask, ClockCallback callback, void* context = nullptr);
+
+    // Refresh the snapshot and notify subscribers, call from loop()
+    void tick();
+
+    // Current snapshot (converted at most once per second)
+    const ClockSnapshot& now();
+
+    // Boundaries crossed between two snapshots
+    static uint8_t eventsBetween(const ClockSnapshot& previous, const ClockSnapshot& current);
+
+private:
+    static ClockService* _instance;
+
+    struct Subscriber {
+        ClockCallback callback;
+        void* context;
+        uint8_t mask;
+    };
+
+    Subscriber subscribers[MAX_CLOCK_SUBSCRIBERS];
+    int subscriberCount;
+    ClockSnapshot snapshot;
+    uint8_t pendingEvents;   // Accumulated by refresh(), delivered by tick()
+
+    ClockService();
+    void refresh();
+};
+
+#endif // CLOCK_SERVICE_H
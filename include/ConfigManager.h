@@ -5,17 +5,26 @@
 #include <ArduinoJson.h>
 #include <SD.h>
 #include <SPI.h>
+#include "PsramAllocator.h"
+
+// One weather location: "weather.lat/lon/name" is the first (home),
+// "weather.locations" lists the others
+struct WeatherLocationConfig {
+    String name;
+    float lat;
+    float lon;
+};
 
 class ConfigManager {
 private:
     static ConfigManager* instance;
-    DynamicJsonDocument configDoc;
+    PsramJsonDocument configDoc;
     bool configLoaded;
     
     ConfigManager();
     bool loadConfigFromSD();
     void setDefaultConfig();
-    bool parseConfig(DynamicJsonDocument& doc);
+    bool parseConfig(JsonDocument& doc);
     
 public:
     static ConfigManager* getInstance();
@@ -38,6 +47,7 @@ public:
     bool getWiFiCredentials(String& ssid, String& password);
     bool getNTPSettings(String& server, String& timezone);
     bool getWeatherSettings(String& apiKey, float& lat, float& lon, String& units, String& lang);
+    int getWeatherLocations(WeatherLocationConfig* locations, int maxLocations);
 
     // Radio specific methods
     bool loadStations();
@@ -0,0 +1,169 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "debug_config.h"
+
+/**
+ * Deferred binary logging
+ *
+ * LOG_DEBUG(AUDIO, "Connecting to: %s", host) does not format anything on the
+ * calling task. It stores the format-string pointer, a millisecond timestamp and
+ * the raw arguments (strings copied inline) into a lock-free ring buffer. A
+ * task at idle priority, below the loop task, formats the records in small
+ * batches and writes them to both serial ports and, if enabled with
+ * 'log sd on', appends them to /log.txt on the SD card.
+ * When the ring is full the message is dropped and counted instead of blocking.
+ *
+ * Format strings must be string literals (only the pointer is stored) and do not
+ * need a trailing newline. Each module has a compile-time level LOG_LEVEL_<MODULE>;
+ * messages above it are removed by the compiler. With DEFERRED_LOG=0 the macros
+ * fall back to synchronous DEBUG_PRINTF output.
+ */
+
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+
+// Per-module compile-time levels, derived from the existing *_DEBUG flags
+#ifndef LOG_LEVEL_SYSTEM
+  #define LOG_LEVEL_SYSTEM  (SYSTEM_DEBUG ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO)
+#endif
+#ifndef LOG_LEVEL_AUDIO
+  #define LOG_LEVEL_AUDIO   (AUDIO_DEBUG ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARN)
+#endif
+#ifndef LOG_LEVEL_HEAP
+  #define LOG_LEVEL_HEAP    (HEAP_DEBUG ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARN)
+#endif
+#ifndef LOG_LEVEL_ALARM
+  #define LOG_LEVEL_ALARM   (ALARM_DEBUG ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARN)
+#endif
+#ifndef LOG_LEVEL_LVGL
+  #define LOG_LEVEL_LVGL    LOG_LEVEL_DEBUG
+#endif
+#ifndef LOG_LEVEL_WEATHER
+  #define LOG_LEVEL_WEATHER (WEATHER_DEBUG ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARN)
+#endif
+#ifndef LOG_LEVEL_SENSOR
+  #define LOG_LEVEL_SENSOR  (SENSOR_DEBUG ? LOG_LEVEL_DEBUG : LOG_LEVEL_WARN)
+#endif
+
+enum class LogModule : uint8_t {
+    SYSTEM = 0,
+    AUDIO,
+    HEAP,
+    ALARM,
+    LVGL,
+    WEATHER,
+    SENSOR,
+    COUNT
+};
+
+#define LOG_RING_SLOTS      64    // Must be a power of two
+#define LOG_MAX_ARGS        8
+#define LOG_PAYLOAD_BYTES   96
+#define LOG_STRING_MAX      (LOG_PAYLOAD_BYTES - 1)   // Longest string argument kept (length byte first)
+
+// Argument type tags stored next to the raw argument bytes
+enum class LogArgType : uint8_t {
+    I32 = 0,
+    U32,
+    I64,
+    U64,
+    DOUBLE,
+    STRING,     // Copied inline: length byte followed by the characters
+    POINTER
+};
+
+struct LogRecord {
+    const char* format;
+    uint32_t timestampMs;
+    uint8_t module;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t payloadLength;
+    uint8_t argTypes[LOG_MAX_ARGS];
+    uint8_t payload[LOG_PAYLOAD_BYTES];
+};
+
+// Packs printf-style arguments into a LogRecord
+class LogRecordBuilder {
+public:
+    explicit LogRecordBuilder(LogRecord& record) : record(record) {}
+
+    void add(int v)                { addRaw(LogArgType::I32, &v, sizeof(v)); }
+    void add(unsigned int v)       { addRaw(LogArgType::U32, &v, sizeof(v)); }
+    void add(long v)               { int32_t x = (int32_t)v; addRaw(LogArgType::I32, &x, sizeof(x)); }
+    void add(unsigned long v)      { uint32_t x = (uint32_t)v; addRaw(LogArgType::U32, &x, sizeof(x)); }
+    void add(long long v)          { addRaw(LogArgType::I64, &v, sizeof(v)); }
+    void add(unsigned long long v) { addRaw(LogArgType::U64, &v, sizeof(v)); }
+    void add(double v)             { addRaw(LogArgType::DOUBLE, &v, sizeof(v)); }
+    void add(const void* v)        { addRaw(LogArgType::POINTER, &v, sizeof(v)); }
+    void add(const char* v);
+    void add(char* v)              { add((const char*)v); }
+    void add(const String& v)      { add(v.c_str()); }
+
+private:
+    LogRecord& record;
+    void addRaw(LogArgType type, const void* data, size_t size);
+};
+
+class DeferredLog {
+public:
+    // Start the drain task and register the 'log' console command
+    static void begin();
+
+    // Enable or disable appending to /log.txt on the SD card
+    static void setSDLogging(bool enabled);
+
+    static uint32_t droppedCount();
+    static void printStats();
+
+    template <typename... Args>
+    static void write(LogModule module, uint8_t level, const char* format, const Args&... args) {
+        LogRecord* record = reserve();
+        if (!record) {
+            return;
+        }
+        record->format = format;
+        record->timestampMs = millis();
+        record->module = (uint8_t)module;
+        record->level = level;
+        record->argCount = 0;
+        record->payloadLength = 0;
+
+        LogRecordBuilder builder(*record);
+        int expand[] = {0, (builder.add(args), 0)...};
+        (void)expand;
+
+        commit(record);
+    }
+
+private:
+    static LogRecord* reserve();
+    static void commit(LogRecord* record);
+};
+
+#if DEFERRED_LOG
+#define LOG_AT(MODULE, LEVEL, fmt, ...) do { \
+    if (LOG_LEVEL_##MODULE >= (LEVEL)) { \
+        DeferredLog::write(LogModule::MODULE, (LEVEL), fmt, ##__VA_ARGS__); \
+    } \
+} while (0)
+#else
+#define LOG_AT(MODULE, LEVEL, fmt, ...) do { \
+    if (LOG_LEVEL_##MODULE >= (LEVEL)) { \
+        DEBUG_PRINTF("[" #MODULE "] " fmt "\n", ##__VA_ARGS__); \
+    } \
+} while (0)
+#endif
+
+#define LOG_ERROR(MODULE, fmt, ...) LOG_AT(MODULE, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(MODULE, fmt, ...)  LOG_AT(MODULE, LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_INFO(MODULE, fmt, ...)  LOG_AT(MODULE, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(MODULE, fmt, ...) LOG_AT(MODULE, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,56 @@
+#ifndef DISPLAY_POWER_H
+#define DISPLAY_POWER_H
+
+#include <Arduino.h>
+#include "ClockService.h"
+
+// Backlight off after this long without touch inside the standby night
+// window (STANDBY_NIGHT_START_HOUR..STANDBY_NIGHT_END_HOUR). 0 keeps the panel on.
+#ifndef DISPLAY_BLANK_TIMEOUT_MS
+  #define DISPLAY_BLANK_TIMEOUT_MS (5UL * 60UL * 1000UL)
+#endif
+
+// Switches the panel backlight
+typedef void (*BacklightFn)(bool on);
+
+/**
+ * @brief Night blanking of the panel and its power lock
+ *
+ * Holds PowerSubsystem::DISPLAY (no light sleep) while the backlight is
+ * on. At night, after DISPLAY_BLANK_TIMEOUT_MS without touch, the
+ * backlight goes off and the lock is released, so the chip can light-sleep
+ * between frames. The RGB scanout may stutter then, which is not visible
+ * with the backlight off. A touch or the end of the night window turns the
+ * panel back on; the waking touch is not passed on to the UI.
+ *
+ * Use from the loop task only.
+ */
+class DisplayPower {
+public:
+    // Delete copy constructor and assignment operator
+    DisplayPower(DisplayPower const&) = delete;
+    void operator=(DisplayPower const&) = delete;
+
+    // Get singleton instance
+    static DisplayPower* getInstance();
+
+    // Take the display lock and subscribe to the clock
+    void begin(BacklightFn backlight);
+
+    void blank();
+    void wake();
+    bool isBlanked() const { return blanked; }
+
+    // Blanking and morning check, called by ClockService on minute boundaries
+    void onMinute(const ClockSnapshot& clock);
+
+private:
+    static DisplayPower* _instance;
+
+    BacklightFn backlight;
+    bool blanked;
+
+    DisplayPower();
+};
+
+#endif // DISPLAY_POWER_H
@@ -5,7 +5,19 @@
 // I2C Bus Configuration
 #define I2C_SDA_PIN 17
 #define I2C_SCL_PIN 18
-#define I2C_FREQUENCY 100000  // 100kHz
+#define I2C_FREQUENCY 100000  // 100kHz, bus default after init and recovery
+
+// Per-device clocks and timeouts used by the I2C bus task (see I2CBus)
+#define I2C_CLOCK_GT911   400000  // Informational: LovyanGFX uses cfg.freq from lgfx_config.h
+#define I2C_CLOCK_SHT31   400000
+#define I2C_CLOCK_SGP30   100000  // Kept at the original bus speed
+#define I2C_TIMEOUT_MS    20
+
+// GT911 touch interrupt line (active low), -1 if not wired (TouchInput then
+// polls). TouchInput owns the pin, so cfg.pin_int in lgfx_config.h stays NC.
+#ifndef TOUCH_INT_PIN
+  #define TOUCH_INT_PIN -1
+#endif
 
 // SD Card pins
 #define SD_SCK  12
@@ -20,28 +32,3 @@
 
 // LVGL filesystem drive letter
 #define DRIVE_LETTER 'S'
-
-// Function to safely initialize/reinitialize I2C with consistent parameters
-inline void initializeI2CBus() {
-    Wire.end();
-    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_FREQUENCY);
-    delay(10); // Short delay after I2C reinitialization
-}
-
-// Function to reinitialize I2C bus only if there's an error
-// Returns true if bus was reinitialized, false otherwise
-inline bool reinitializeI2CBusIfNeeded() {
-    // Check if there's an error by trying a simple I2C transaction
-    Wire.beginTransmission(0x00);
-    byte error = Wire.endTransmission();
-    
-    // If there's an error (anything but 0=success or 2=address NACK which is expected for addr 0)
-    if (error != 0 && error != 2) {
-#ifdef SENSOR_DEBUG
-        DEBUG_PRINTF("I2C bus error detected (code %d), reinitializing...\n", error);
-#endif
-        initializeI2CBus();
-        return true;
-    }
-    return false;
-}
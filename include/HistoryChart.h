@@ -0,0 +1,109 @@
+#ifndef HISTORY_CHART_H
+#define HISTORY_CHART_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include "SensorHistory.h"
+
+#define CHART_WIDTH             800     // One column per pixel
+#define CHART_PLOT_HEIGHT       370
+#define CHART_LABEL_HEIGHT      30      // Time axis labels below the plot
+#define CHART_HEIGHT            (CHART_PLOT_HEIGHT + CHART_LABEL_HEIGHT)
+#define CHART_ADVANCE_COLUMNS   50      // Free columns on the right; the window jumps by this much
+#define CHART_X_DIVISIONS       8
+#define CHART_Y_DIVISIONS       5
+
+enum class ChartRange : uint8_t {
+    DAY = 0,    // 1-minute tier
+    WEEK,       // 15-minute tier
+    YEAR,       // Hourly tier
+    COUNT
+};
+
+/**
+ * @brief Full-screen history chart for one sensor channel
+ *
+ * Built in code like the OTA screen and opened by tapping a sensor value
+ * on the main screen. Records from SensorHistory are decimated to one
+ * min/max/avg column per pixel while they are read, so the renderer only
+ * ever sees CHART_WIDTH columns however many buckets the range holds.
+ *
+ * The plot is a canvas written directly: each column is the background and
+ * dotted grid, computed in place, with the min..max span and the average
+ * on top. On each minute only the columns touched by the newest bucket are
+ * redrawn and invalidated. The time axis is drawn into the canvas once per
+ * range; the value axis labels are label objects above it. A full redraw
+ * happens only when the range, channel or scale changes or the window
+ * advances. The canvas buffer (about 640 KB) lives in PSRAM while the
+ * screen is open and is freed when it closes.
+ */
+class HistoryChart {
+public:
+    // Delete copy constructor and assignment operator
+    HistoryChart(HistoryChart const&) = delete;
+    void operator=(HistoryChart const&) = delete;
+
+    // Get singleton instance
+    static HistoryChart* getInstance();
+
+    // Make the main screen sensor values open the chart; call after ui_init()
+    void begin();
+
+    void open(HistoryChannel channel);
+    void close();
+
+private:
+    struct Column {
+        int16_t min;
+        int16_t max;
+        int32_t sum;        // avg * samples, for the weighted column average
+        uint32_t samples;
+    };
+
+    static HistoryChart* _instance;
+
+    lv_obj_t* screen;
+    lv_obj_t* previousScreen;
+    lv_obj_t* canvas;
+    lv_obj_t* titleLabel;
+    lv_obj_t* channelButtons[(int)HistoryChannel::COUNT];
+    lv_obj_t* rangeButtons[(int)ChartRange::COUNT];
+    lv_obj_t* valueLabels[CHART_Y_DIVISIONS + 1];
+
+    uint16_t* pixels;           // Canvas buffer (RGB565)
+    Column* columns;
+    HistoryRecord* records;     // Query chunk
+
+    HistoryChannel channel;
+    ChartRange range;
+    time_t windowStart;
+    time_t windowEnd;
+    int32_t scaleMin;           // Value at the bottom / top of the plot
+    int32_t scaleMax;
+    int lastColumn;             // Newest column drawn
+    uint32_t fullRedraws;
+    uint32_t columnRedraws;
+
+    HistoryChart();
+    void createScreen();
+    void releaseBuffers();
+    void selectChannel(HistoryChannel newChannel);
+    void selectRange(ChartRange newRange);
+    void rebuild();
+    void collect(int firstColumn, int lastColumn);
+    bool chooseScale();
+    void drawBackground();
+    void drawColumn(int column);
+    void updateNewest(time_t now);
+    int valueToRow(int32_t value) const;
+    int timeToColumn(time_t t) const;
+    void updateTitle();
+
+    static void clockCallback(const ClockSnapshot& clock, uint8_t events, void* context);
+    static void openEvent(lv_event_t* e);
+    static void backEvent(lv_event_t* e);
+    static void channelEvent(lv_event_t* e);
+    static void rangeEvent(lv_event_t* e);
+};
+
+#endif // HISTORY_CHART_H
@@ -0,0 +1,46 @@
+#ifndef HTTPS_BODY_H
+#define HTTPS_BODY_H
+
+#include <Arduino.h>
+
+#ifndef HTTPS_READ_TIMEOUT_MS
+#define HTTPS_READ_TIMEOUT_MS       5000
+#endif
+
+/**
+ * @brief Body of the current response, limited to its own bytes
+ *
+ * Decodes chunked transfer encoding and stops at Content-Length, so the
+ * parser never reads into the next response on a kept-alive connection.
+ * Depends on Stream only, so test/test_https_body runs it on the host.
+ */
+class HttpsBody : public Stream {
+public:
+    HttpsBody() : client(nullptr), mode(UNTIL_CLOSE), remaining(0), finished(true), firstChunk(true) {}
+
+    void start(Stream* stream, int contentLength, bool chunked);
+
+    // Read and discard the rest of the body; true if it ended cleanly
+    bool drain();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    enum Mode : uint8_t { LENGTH, CHUNKED, UNTIL_CLOSE };
+
+    Stream* client;
+    Mode mode;
+    uint32_t remaining;         // Bytes left in the body or the current chunk
+    bool finished;
+    bool firstChunk;
+
+    bool ensureData();
+    bool readChunkHeader();
+    int timedRead();
+};
+
+#endif // HTTPS_BODY_H
@@ -0,0 +1,97 @@
+#ifndef HTTPS_CONNECTION_H
+#define HTTPS_CONNECTION_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include "ClockService.h"
+#include "HttpsBody.h"
+
+#define HTTPS_PORT                  443
+#define HTTPS_KEEPALIVE_MS          30000       // Idle connections are closed after this
+#define HTTPS_DNS_TTL_MS            (30 * 60 * 1000UL)
+#define HTTPS_HANDSHAKE_TIMEOUT_S   10
+#define HTTPS_MAX_HOST_LENGTH       48
+
+struct HttpsStats {
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t handshakes;        // New TLS connections
+    uint32_t keptAliveReuses;   // Requests sent on a kept-alive connection (no TLS session resumption)
+    uint32_t staleRetries;      // Kept-alive connections the server had already closed
+    uint32_t idleCloses;
+    uint32_t dnsLookups;
+    uint32_t dnsHits;
+    uint32_t lastHandshakeMs;
+    uint32_t totalHandshakeMs;
+    uint32_t lastLatencyMs;     // get() until end()
+    uint32_t maxLatencyMs;
+    uint32_t totalLatencyMs;
+};
+
+/**
+ * @brief Shared HTTPS connection for the API clients
+ *
+ * Requests go through one WiFiClientSecure that is kept open while the
+ * server allows it, so requests in quick succession (several locations,
+ * retries) skip TCP setup and the TLS handshake. Idle connections are
+ * closed after HTTPS_KEEPALIVE_MS to give the TLS buffers back; a
+ * connection the server already closed is detected on send and the
+ * request is repeated once on a new one. Host addresses are resolved
+ * once per HTTPS_DNS_TTL_MS. TLS sessions are not resumed: WiFiClientSecure
+ * in arduino-esp32 2.0.x offers no way to reuse a saved session, so every
+ * new connection runs the full handshake.
+ *
+ * Runs on the loop task only. The 'https' console command prints
+ * handshake, reuse and latency statistics.
+ */
+class HttpsConnectionManager {
+public:
+    // Delete copy constructor and assignment operator
+    HttpsConnectionManager(HttpsConnectionManager const&) = delete;
+    void operator=(HttpsConnectionManager const&) = delete;
+
+    // Get singleton instance
+    static HttpsConnectionManager* getInstance();
+
+    // Register the console command and the idle timeout
+    void begin();
+
+    // Send a GET request; returns the HTTP status or a negative HTTPClient error.
+    // The body is read from getBody(); every get() must be followed by end().
+    int get(const char* host, const String& uri);
+    Stream* getBody() { return &body; }
+    void end();
+
+    // Close the connection now (e.g. before standby)
+    void close();
+
+    const HttpsStats& getStats() const { return stats; }
+    void printStats();
+
+private:
+    static HttpsConnectionManager* _instance;
+
+    WiFiClientSecure client;
+    HTTPClient http;
+    HttpsBody body;
+    char host[HTTPS_MAX_HOST_LENGTH];
+    bool keepAlive;             // Server accepted keep-alive for the current response
+    bool requestOpen;
+    uint32_t requestStartMs;
+    uint32_t lastUseMs;
+
+    // DNS cache (one host)
+    char resolvedHost[HTTPS_MAX_HOST_LENGTH];
+    IPAddress resolvedAddress;
+    uint32_t resolvedAtMs;
+
+    HttpsStats stats;
+
+    HttpsConnectionManager();
+    bool connect(const char* targetHost);
+    bool resolve(const char* targetHost, IPAddress& address);
+    static void clockCallback(const ClockSnapshot& clock, uint8_t events, void* context);
+};
+
+#endif // HTTPS_CONNECTION_H
@@ -0,0 +1,147 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+#define MAX_I2C_DEVICES         8
+#define I2C_QUEUE_LENGTH        8     // Per priority level
+#define I2C_TASK_STACK_SIZE     4096
+#define I2C_TASK_PRIORITY       4     // Above the touch task, so queued reads start immediately
+#define I2C_RECOVERY_THRESHOLD  3     // Consecutive bus-level failures before a bus recovery
+
+// Lower value is served first
+enum class I2CPriority : uint8_t {
+    TOUCH = 0,
+    SENSOR,
+    BACKGROUND,
+    COUNT
+};
+
+enum class I2CResult : uint8_t {
+    OK = 0,
+    NACK,          // Address or data not acknowledged (device absent or busy)
+    TIMEOUT,
+    BUS_ERROR
+};
+
+// Runs on the bus task with exclusive use of Wire1 (for library drivers).
+// Library calls that only report success/failure should return NACK on failure.
+typedef I2CResult (*I2CCallback)(void* context);
+
+struct I2CDeviceStats {
+    uint32_t transactions;
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint32_t busErrors;
+    uint32_t maxWaitUs;     // Queue wait before the transaction started
+};
+
+/**
+ * @brief Client handle for one device on the shared bus
+ *
+ * Each call queues a transaction for the I2CBus task at the device's
+ * priority and blocks until it completes; the bus switches to the device's
+ * clock and timeout first. A device object must only be used by one task
+ * at a time. Devices add themselves to the bus when constructed and are
+ * never removed, so they must be static or live for the whole run. The
+ * completion semaphore is created in I2CBus::begin(), or at construction
+ * for devices created after it.
+ */
+class I2CDevice {
+public:
+    I2CDevice(const char* name, uint8_t address, uint32_t clockHz, uint16_t timeoutMs, I2CPriority priority);
+
+    I2CResult write(const uint8_t* data, size_t length);
+    I2CResult read(uint8_t* data, size_t length);
+    I2CResult writeRead(const uint8_t* tx, size_t txLength, uint8_t* rx, size_t rxLength);
+    I2CResult run(I2CCallback callback, void* context);
+
+    const char* getName() const { return name; }
+    uint8_t getAddress() const { return address; }
+    const I2CDeviceStats& getStats() const { return stats; }
+
+private:
+    friend class I2CBus;
+
+    const char* name;
+    uint8_t address;
+    uint32_t clockHz;
+    uint16_t timeoutMs;
+    I2CPriority priority;
+    SemaphoreHandle_t done;
+    I2CDeviceStats stats;
+};
+
+/**
+ * @brief Task that owns Wire1 and serves I2CDevice transactions by priority
+ *
+ * Touch transactions are always taken before sensor and background ones,
+ * so a slow sensor exchange delays a touch read by at most one transaction.
+ * Bus-level failures (timeouts, arbitration/bus errors, not NACKs) are
+ * counted per device; after I2C_RECOVERY_THRESHOLD in a row the task clocks
+ * SCL to release a stuck slave and restarts Wire1.
+ *
+ * Before begin() transactions run directly in the calling task.
+ * The 'i2c' console command prints per-device statistics.
+ */
+class I2CBus {
+public:
+    // Delete copy constructor and assignment operator
+    I2CBus(I2CBus const&) = delete;
+    void operator=(I2CBus const&) = delete;
+
+    // Get singleton instance
+    static I2CBus* getInstance();
+
+    // Start the bus task; Wire1 must already be initialized
+    void begin(int sdaPin, int sclPin, uint32_t defaultClockHz);
+
+    void printStats();
+
+private:
+    friend class I2CDevice;
+
+    enum class Operation : uint8_t { WRITE, READ, WRITE_READ, CALLBACK };
+
+    struct Transaction {
+        I2CDevice* device;
+        Operation operation;
+        const uint8_t* tx;
+        size_t txLength;
+        uint8_t* rx;
+        size_t rxLength;
+        I2CCallback callback;
+        void* context;
+        uint32_t queuedUs;
+        I2CResult result;
+    };
+
+    static I2CBus* _instance;
+
+    QueueHandle_t queues[(int)I2CPriority::COUNT];
+    SemaphoreHandle_t pending;
+    TaskHandle_t taskHandle;
+    int sda;
+    int scl;
+    uint32_t defaultClock;
+    uint32_t currentClock;
+    uint16_t currentTimeout;
+    uint8_t consecutiveFailures;
+    uint32_t recoveries;
+
+    I2CDevice* devices[MAX_I2C_DEVICES];
+    int deviceCount;
+
+    I2CBus();
+    I2CResult submit(Transaction& transaction);
+    void execute(Transaction& transaction);
+    void recoverBus();
+    void addDevice(I2CDevice* device);
+    static void taskFunction(void* parameter);
+};
+
+#endif // I2C_BUS_H
@@ -0,0 +1,51 @@
+#ifndef LVGL_HEAP_H
+#define LVGL_HEAP_H
+
+#include <Arduino.h>
+
+/**
+ * Two-tier LVGL heap (LV_USE_STDLIB_MALLOC = LV_STDLIB_CUSTOM)
+ *
+ * LVGL and EEZ-Flow allocate everything through lv_malloc(). This allocator
+ * splits those requests by size:
+ *
+ *  - Small, hot allocations (styles, label text, event descriptors, flow
+ *    values) come from fixed size-class pools in internal RAM. Each class is
+ *    a free list, so allocation and free are O(1) and never fragment.
+ *  - Larger and colder allocations (widget objects, draw layers, decoded
+ *    images) come from a dedicated region in PSRAM managed by the ESP-IDF
+ *    multi_heap allocator. In IDF 4.4 (arduino-esp32 2.0.x) that is a
+ *    first-fit allocator walking a block list, not TLSF (IDF 5 and later),
+ *    so allocation time grows with the number of free blocks in the region.
+ *
+ * A full size class falls back to the PSRAM region, and a full or missing
+ * PSRAM region falls back to the system heap. Both fallbacks are counted.
+ * Usage, peaks, fragmentation and fallbacks are printed by the 'lvheap'
+ * console command.
+ *
+ * LVGL runs on the loop task, but lv_malloc() does not check that. The
+ * pool free lists and counters are guarded by a spinlock, and the PSRAM
+ * region is given one as well, because a region registered by hand has none.
+ */
+
+// Internal-RAM size classes: block size and number of blocks
+#define LVGL_POOL_CLASS_COUNT   4
+#define LVGL_POOL_16_BLOCKS     512
+#define LVGL_POOL_32_BLOCKS     384
+#define LVGL_POOL_64_BLOCKS     128
+#define LVGL_POOL_128_BLOCKS    32
+
+// Size of the PSRAM region for large allocations
+#ifndef LVGL_PSRAM_HEAP_SIZE
+  #define LVGL_PSRAM_HEAP_SIZE  (2 * 1024 * 1024)
+#endif
+
+class LvglHeap {
+public:
+    // Register the 'lvheap' console command
+    static void begin();
+
+    static void printStats();
+};
+
+#endif // LVGL_HEAP_H
@@ -0,0 +1,79 @@
+#ifndef PLAYBACK_STATE_H
+#define PLAYBACK_STATE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Coarse state of the audio pipeline, published together with the metadata
+enum class PlaybackStateCode : uint8_t {
+    STOPPED = 0,
+    CONNECTING,
+    PLAYING,
+    ERROR
+};
+
+// One consistent view of the currently playing track and pipeline status.
+// Field names match the PlaybackStruc structure used by the UI data binding.
+struct PlaybackSnapshot {
+    char AlarmTitle[64];
+    char Title[128];
+    char Album[64];
+    char Artist[64];
+    PlaybackStateCode state;
+    uint16_t bitrateKbps;    // Measured network throughput of the stream
+    uint32_t bufferBytes;    // Bytes waiting in the network buffer
+    uint32_t sequence;       // Incremented on every publish that changed something
+};
+
+// Copies a C string into a fixed snapshot field, always null-terminating it
+template <size_t N>
+inline void setPlaybackText(char (&dst)[N], const char* src) {
+    strncpy(dst, src ? src : "", N - 1);
+    dst[N - 1] = '\0';
+}
+
+/**
+ * @brief Lock-free single-producer/single-consumer publication of playback state
+ *
+ * Implemented as a triple buffer: the producer owns a back slot, the consumer owns
+ * a front slot, and the most recently published slot is parked in the middle.
+ * Publishing and consuming are a single atomic exchange each, so neither side ever
+ * blocks and the consumer reads the snapshot in place without copying it.
+ * Publishing an unchanged staging copy is a no-op, so the consumer only wakes
+ * up (and the UI only rebinds) when something it shows actually changed.
+ *
+ * All publishing must happen from one task (the loop task, which runs the audio
+ * manager and the LVGL event handlers). The audio task itself only updates
+ * atomic counters that AudioManager::loop() folds into the next snapshot.
+ */
+class PlaybackStateChannel {
+public:
+    PlaybackStateChannel();
+
+    // Producer side: staging copy that may be modified field by field
+    PlaybackSnapshot& edit() { return staging; }
+
+    // Producer side: make the staging copy visible to the consumer; false if it
+    // equals the last published snapshot and nothing was handed over
+    bool publish();
+
+    // Consumer side: returns true if a newer snapshot was taken over since the last call
+    bool consume();
+
+    // Consumer side: snapshot owned by the consumer, valid until the next consume()
+    const PlaybackSnapshot& latest() const { return slots[front]; }
+
+private:
+    static const uint8_t SLOT_MASK = 0x03;
+    static const uint8_t FRESH_FLAG = 0x04;
+
+    PlaybackSnapshot slots[3];
+    PlaybackSnapshot staging;
+    PlaybackSnapshot published;  // Producer's copy of the last handed-over snapshot
+    std::atomic<uint8_t> middle;
+    uint8_t back;               // Only touched by the producer
+    uint8_t front;              // Only touched by the consumer
+    uint32_t sequence;
+};
+
+#endif // PLAYBACK_STATE_H
@@ -0,0 +1,82 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "PowerPolicy.h"
+#include "debug_config.h"
+
+// Clock range for dynamic frequency scaling. 80 MHz keeps the PLL running,
+// which the RGB panel clock depends on.
+#ifndef POWER_MAX_CPU_FREQ_MHZ
+  #define POWER_MAX_CPU_FREQ_MHZ 240
+#endif
+#ifndef POWER_MIN_CPU_FREQ_MHZ
+  #define POWER_MIN_CPU_FREQ_MHZ 80
+#endif
+
+/**
+ * @brief Singleton that applies PowerPolicy decisions to esp_pm locks
+ *
+ * begin() enables DFS (and automatic light sleep when the SDK is built with
+ * tickless idle). Subsystems report activity via setActive()/pulse(); lock
+ * changes are applied immediately so a frame or touch is handled at full
+ * clock, and loop() releases locks once their linger time has passed.
+ * The 'power' console command prints the active subsystems and the time
+ * spent at each clock level.
+ *
+ * With POWER_MANAGEMENT=0 the calls are kept but nothing is configured.
+ */
+class PowerManager {
+public:
+    // Delete copy constructor and assignment operator
+    PowerManager(PowerManager const&) = delete;
+    void operator=(PowerManager const&) = delete;
+
+    // Get singleton instance
+    static PowerManager* getInstance();
+
+    // Configure esp_pm and register the 'power' console command
+    void begin();
+
+    // Call from loop() to expire lingering locks and update statistics
+    void loop();
+
+    void setActive(PowerSubsystem subsystem, bool active);
+    void pulse(PowerSubsystem subsystem);
+
+    void printStatus();
+
+private:
+    static PowerManager* _instance;
+
+    PowerPolicy policy;
+    PowerLocks applied;
+    bool pmEnabled;
+    bool lightSleepEnabled;
+
+    // Time accounting by requested clock level
+    uint32_t lastAccountMs;
+    uint64_t timeAtMaxMs;
+    uint64_t timeAtMinMs;
+    uint64_t timeSleepAllowedMs;
+
+    PowerManager();
+    void apply(uint32_t nowMs);
+    void account(uint32_t nowMs);
+};
+
+// Marks a subsystem active for the lifetime of a scope
+class PowerActivityScope {
+public:
+    explicit PowerActivityScope(PowerSubsystem subsystem) : subsystem(subsystem) {
+        PowerManager::getInstance()->setActive(subsystem, true);
+    }
+    ~PowerActivityScope() {
+        PowerManager::getInstance()->setActive(subsystem, false);
+    }
+
+private:
+    PowerSubsystem subsystem;
+};
+
+#endif // POWER_MANAGER_H
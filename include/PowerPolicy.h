@@ -0,0 +1,71 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <stdint.h>
+
+/**
+ * Power lock policy
+ *
+ * Decides which power-management locks the firmware should hold, purely from
+ * subsystem activity events and a millisecond clock. It has no Arduino or
+ * ESP-IDF dependencies, so the rules can be exercised off-target by feeding
+ * events and times; PowerManager applies the result to esp_pm locks.
+ *
+ * Subsystems are either held active (setActive, e.g. audio while playing) or
+ * pulsed (pulse, e.g. each touch or rendered frame). Both keep their locks
+ * for a per-subsystem linger time after the last activity, so short gaps do
+ * not toggle the CPU clock back and forth.
+ */
+
+enum class PowerSubsystem : uint8_t {
+    DISPLAY = 0,   // Panel on: RGB scanout needs the PLL, so no light sleep
+    RENDER,        // LVGL rendering a frame
+    AUDIO,         // Stream connecting or playing
+    NETWORK,       // HTTP(S) transfer in progress
+    TOUCH,         // User interaction
+    COUNT
+};
+
+// Locks the policy wants held
+struct PowerLocks {
+    bool cpuMax;         // ESP_PM_CPU_FREQ_MAX
+    bool apbMax;         // ESP_PM_APB_FREQ_MAX
+    bool noLightSleep;   // ESP_PM_NO_LIGHT_SLEEP
+
+    bool operator==(const PowerLocks& other) const {
+        return cpuMax == other.cpuMax && apbMax == other.apbMax && noLightSleep == other.noLightSleep;
+    }
+    bool operator!=(const PowerLocks& other) const { return !(*this == other); }
+};
+
+class PowerPolicy {
+public:
+    PowerPolicy();
+
+    // Level-triggered activity (active until set inactive, then linger)
+    void setActive(PowerSubsystem subsystem, bool active, uint32_t nowMs);
+
+    // Edge-triggered activity (active for the linger time from now)
+    void pulse(PowerSubsystem subsystem, uint32_t nowMs);
+
+    // Locks required at 'nowMs'
+    PowerLocks evaluate(uint32_t nowMs) const;
+
+    bool isActive(PowerSubsystem subsystem, uint32_t nowMs) const;
+
+    static const char* subsystemName(PowerSubsystem subsystem);
+
+private:
+    struct SubsystemState {
+        bool held;
+        uint32_t lastActivityMs;
+        bool everActive;
+    };
+
+    SubsystemState states[(int)PowerSubsystem::COUNT];
+
+    static uint32_t lingerMs(PowerSubsystem subsystem);
+    static PowerLocks locksFor(PowerSubsystem subsystem);
+};
+
+#endif // POWER_POLICY_H
@@ -0,0 +1,83 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "debug_config.h"
+
+/**
+ * Scoped profiling zones
+ *
+ * Usage:
+ *   bool WeatherModel::parse(...) {
+ *       PROFILE_ZONE("weather.parse");
+ *       ...
+ *   }
+ *
+ * Each zone measures the CPU cycles between its construction and the end of the
+ * enclosing scope and aggregates count, min/max/mean and a log2 histogram into a
+ * fixed static table - nothing is allocated. Results are printed with the
+ * 'profile' console command ('profile json' for JSON, 'profile reset' to clear).
+ *
+ * With PROFILING=0 (the default) the macros expand to nothing and the profiler
+ * itself is compiled out.
+ */
+
+#if PROFILING
+
+struct ProfileZone {
+    static const int HISTOGRAM_BUCKETS = 32;  // Bucket n counts durations in [2^n, 2^(n+1)) cycles
+
+    const char* name;
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[HISTOGRAM_BUCKETS];
+};
+
+class Profiler {
+public:
+    static const int MAX_ZONES = 32;
+
+    // Returns a zone slot for 'name', or nullptr if the table is full
+    static ProfileZone* registerZone(const char* name);
+
+    // Add one measurement to a zone
+    static void record(ProfileZone* zone, uint32_t cycles);
+
+    // Register the 'profile' console command
+    static void begin();
+
+    static void printReport();
+    static void printJson();
+    static void reset();
+};
+
+// RAII helper created by PROFILE_ZONE
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileZone* zone) : zone(zone), start(ESP.getCycleCount()) {}
+    ~ProfileScope() {
+        // Cycle counters are per core; the measured tasks are pinned so this is consistent
+        Profiler::record(zone, ESP.getCycleCount() - start);
+    }
+
+private:
+    ProfileZone* zone;
+    uint32_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_ZONE(name) \
+    static ProfileZone* PROFILE_CONCAT(_profile_zone_, __LINE__) = Profiler::registerZone(name); \
+    ProfileScope PROFILE_CONCAT(_profile_scope_, __LINE__)(PROFILE_CONCAT(_profile_zone_, __LINE__))
+
+#else
+
+#define PROFILE_ZONE(name) do {} while (0)
+
+#endif // PROFILING
+
+#endif // PROFILER_H
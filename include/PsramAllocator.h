@@ -0,0 +1,79 @@
+#ifndef PSRAM_ALLOCATOR_H
+#define PSRAM_ALLOCATOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/**
+ * PSRAM-first allocation policy
+ *
+ * Large and transient buffers (JSON pools, HTTP bodies, decode buffers) go to
+ * PSRAM so internal RAM stays available for DMA, task stacks and LVGL. If PSRAM
+ * is missing or exhausted the allocation falls back to the internal heap and
+ * the fallback is counted. Usage is reported by the 'heap' console command.
+ */
+
+struct PsramStats {
+    uint32_t liveBytes;        // Bytes currently held in PSRAM through this policy
+    uint32_t peakBytes;
+    uint32_t allocations;
+    uint32_t internalFallbacks;
+};
+
+namespace Psram {
+    void* allocate(size_t size);
+    void* reallocate(void* ptr, size_t size);
+    void deallocate(void* ptr);
+
+    void getStats(PsramStats& out);
+    void printStats();
+}
+
+// ArduinoJson allocator: document memory pools live in PSRAM
+struct PsramJsonAllocator {
+    void* allocate(size_t size) { return Psram::allocate(size); }
+    void deallocate(void* ptr) { Psram::deallocate(ptr); }
+    void* reallocate(void* ptr, size_t size) { return Psram::reallocate(ptr, size); }
+};
+
+typedef BasicJsonDocument<PsramJsonAllocator> PsramJsonDocument;
+
+/**
+ * @brief Growable byte buffer in PSRAM, freed when it goes out of scope
+ *
+ * Used instead of String for HTTP bodies and other large payloads so they are
+ * never copied through the internal heap. It is a write-only Stream, so
+ * HTTPClient::writeToStream() can fill it (handling chunked transfer), and the
+ * content is always NUL-terminated for deserializeJson().
+ */
+class PsramBuffer : public Stream {
+public:
+    PsramBuffer() : data(nullptr), length(0), capacity(0) {}
+    ~PsramBuffer() { Psram::deallocate(data); }
+
+    PsramBuffer(PsramBuffer const&) = delete;
+    void operator=(PsramBuffer const&) = delete;
+
+    // Ensure room for 'size' bytes plus the terminator
+    bool reserve(size_t size);
+    void clear() { length = 0; if (data) data[0] = '\0'; }
+
+    const char* c_str() const { return data ? data : ""; }
+    size_t size() const { return length; }
+
+    // Print interface
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    // Stream interface (write-only)
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+private:
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+#endif // PSRAM_ALLOCATOR_H
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <vector>
 #include "lvgl.h"
+#include "PlaybackState.h"
 
 // Represents a single radio station
 struct Station {
@@ -13,20 +14,11 @@ struct Station {
     String genre;
 };
 
-// Represents the currently playing track information
-// This will be bound to the UI
-struct PlaybackInfo {
-    char AlarmTitle[64];
-    char Title[128];
-    char Album[64];
-    char Artist[64];
-};
-
 // Global vector to hold all radio stations loaded from stations.json
 extern std::vector<Station> g_stations;
 
-// Global struct for playback info, for UI data binding
-extern PlaybackInfo g_playbackInfo;
+// Playback info channel: published by the audio side, consumed by the UI data binding
+extern PlaybackStateChannel g_playbackState;
 
 // Helper function to populate the station list for the UI dropdown
 void populate_station_list_for_ui(lv_obj_t *dropdown);
@@ -0,0 +1,50 @@
+#ifndef SGP30_SENSOR_H
+#define SGP30_SENSOR_H
+
+#include <Arduino.h>
+#include "I2CBus.h"
+
+#define SGP30_DEFAULT_ADDRESS   0x58
+
+struct SGP30Stats {
+    uint32_t measurements;
+    uint32_t crcErrors;
+    uint32_t i2cErrors;
+};
+
+/**
+ * @brief Raw SGP30 driver on the shared I2C bus
+ *
+ * Each call writes one command, waits out its execution time with
+ * vTaskDelay (the bus is free in the meantime) and reads the CRC-protected
+ * result words. Meant for the sensor task; never call it from the UI loop.
+ */
+class SGP30Sensor {
+public:
+    explicit SGP30Sensor(uint8_t address = SGP30_DEFAULT_ADDRESS);
+
+    // Read the serial number and start the IAQ algorithm
+    bool begin();
+
+    // One IAQ step; must be called once per second for a valid baseline
+    bool measureIAQ(uint16_t* eco2, uint16_t* tvoc);
+
+    // Absolute humidity in g/m^3, 8.8 fixed point (0 disables compensation)
+    bool setHumidity(uint16_t absoluteHumidity);
+
+    bool getBaseline(uint16_t* eco2Baseline, uint16_t* tvocBaseline);
+    bool setBaseline(uint16_t eco2Baseline, uint16_t tvocBaseline);
+
+    const uint16_t* getSerial() const { return serial; }
+    const SGP30Stats& getStats() const { return stats; }
+
+private:
+    I2CDevice device;
+    uint16_t serial[3];
+    SGP30Stats stats;
+
+    bool command(uint16_t cmd, const uint16_t* args, uint8_t argCount,
+                 uint16_t* result, uint8_t resultCount, uint16_t durationMs);
+};
+
+#endif // SGP30_SENSOR_H
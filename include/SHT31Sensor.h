@@ -0,0 +1,67 @@
+#ifndef SHT31_SENSOR_H
+#define SHT31_SENSOR_H
+
+#include <Arduino.h>
+#include "I2CBus.h"
+
+#define SHT31_DEFAULT_ADDRESS   0x44
+#define SHT31_CONVERSION_MS     16    // High repeatability: 15.5 ms max
+#define SHT31_MEASURE_TIMEOUT_MS 100  // Give up if the result is still not readable
+
+struct SHT31Stats {
+    uint32_t measurements;   // Successful results
+    uint32_t notReady;       // Read NACKed because the conversion was still running
+    uint32_t crcErrors;
+    uint32_t i2cErrors;
+    uint32_t timeouts;       // No result within SHT31_MEASURE_TIMEOUT_MS
+    uint32_t lastConversionMs;
+};
+
+/**
+ * @brief Non-blocking SHT31 driver
+ *
+ * startMeasurement() sends one single-shot command (high repeatability, no
+ * clock stretching) and returns; poll(), called every loop, reads the six
+ * result bytes once the conversion time has elapsed, checks both CRCs and
+ * converts temperature and humidity from the same measurement. Nothing
+ * here waits: all bus traffic is short I2CBus transactions.
+ */
+class SHT31Sensor {
+public:
+    explicit SHT31Sensor(uint8_t address = SHT31_DEFAULT_ADDRESS);
+
+    // Soft reset and status check; true if the sensor answers
+    bool begin();
+
+    // Start a measurement; false if one is running or the command failed
+    bool startMeasurement(uint32_t nowMs);
+
+    // Advance the state machine; true once when a new result is available
+    bool poll(uint32_t nowMs);
+
+    bool isBusy() const { return measuring; }
+
+    // Latest result in hundredths of a degree Celsius / percent
+    int16_t getTemperatureCenti() const { return temperatureCenti; }
+    uint16_t getHumidityCenti() const { return humidityCenti; }
+    float getTemperature() const { return temperatureCenti / 100.0f; }
+    float getHumidity() const { return humidityCenti / 100.0f; }
+
+    const SHT31Stats& getStats() const { return stats; }
+    const I2CDevice& getDevice() const { return device; }
+
+    // Sensirion CRC-8 (polynomial 0x31, init 0xFF)
+    static uint8_t crc8(const uint8_t* data, size_t length);
+
+private:
+    I2CDevice device;
+    bool measuring;
+    uint32_t startMs;
+    int16_t temperatureCenti;
+    uint16_t humidityCenti;
+    SHT31Stats stats;
+
+    I2CResult command(uint16_t cmd);
+};
+
+#endif // SHT31_SENSOR_H
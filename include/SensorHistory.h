@@ -0,0 +1,158 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <Arduino.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "ClockService.h"
+
+#define HISTORY_FLUSH_BATCH     15          // Minute records per SD append (one flush per 15 min)
+#define HISTORY_QUEUE_LENGTH    4           // Batches waiting for the writer task
+#define HISTORY_TASK_STACK_SIZE 4096
+#define HISTORY_TASK_PRIORITY   1           // Same as the loop task; SD waits block only the writer
+#define HISTORY_SYNC_TIMEOUT_MS 5000        // flush() waits this long for the writer
+#define HISTORY_DIRECTORY       "/history"
+#define HISTORY_FILE_MAGIC      0x54534948u // "HIST"
+#define HISTORY_FILE_VERSION    1
+
+enum class HistoryChannel : uint8_t {
+    TEMPERATURE = 0,    // 0.01 degrees Celsius
+    HUMIDITY,           // 0.01 %RH
+    TVOC,               // ppb, saturates at 32767
+    ECO2,               // ppm, saturates at 32767
+    COUNT
+};
+
+// Ring resolutions: 1 min for 24 h, 15 min for 7 days, 1 h for a year
+enum class HistoryTier : uint8_t {
+    MINUTE = 0,
+    QUARTER,
+    HOUR,
+    COUNT
+};
+
+struct HistoryStat {
+    int16_t min;
+    int16_t max;
+    int16_t avg;
+};
+
+// One bucket as kept in PSRAM and stored on SD (32 bytes, no padding)
+struct HistoryRecord {
+    uint32_t bucket;        // epoch / tier resolution; 0 marks an empty slot
+    uint16_t samples;       // 1 Hz samples aggregated into this bucket
+    uint8_t channelMask;    // Bit n set if channel n has data
+    uint8_t reserved;
+    HistoryStat stats[(int)HistoryChannel::COUNT];
+};
+
+/**
+ * @brief Multi-resolution history of the environmental sensors
+ *
+ * Every second the latest SensorTask snapshot is folded into one open
+ * bucket per tier (min/max/sum per channel). A closed bucket is written to
+ * its PSRAM ring, slot = bucket % capacity, and queued for SD. Full batches
+ * go to the history writer task, which appends them to one binary file per
+ * tier and rewrites a file from the ring when it holds twice the ring
+ * capacity, so SD latency never reaches the loop task.
+ *
+ * begin() reloads each ring by seeking to the last 'capacity' records of
+ * its file, so no parsing is needed. query() visits each bucket of the
+ * range once, including the still open one.
+ *
+ * The public methods run on the loop task (ClockService callbacks,
+ * console, standby). The writer only reads the rings, in short locked
+ * copies. The 'history' console command prints ring fill and SD statistics.
+ */
+class SensorHistory {
+public:
+    // Delete copy constructor and assignment operator
+    SensorHistory(SensorHistory const&) = delete;
+    void operator=(SensorHistory const&) = delete;
+
+    // Get singleton instance
+    static SensorHistory* getInstance();
+
+    // Allocate the rings, reload them from SD and start sampling
+    bool begin();
+
+    // Fold one sample into the open buckets; values are indexed by HistoryChannel
+    void addSample(time_t epoch, const int16_t* values, uint8_t channelMask);
+
+    // Copy the records of [from, to] in time order, skipping empty buckets.
+    // Returns the number of records written to 'out'.
+    size_t query(HistoryTier tier, time_t from, time_t to, HistoryRecord* out, size_t maxRecords);
+
+    // Write all queued records to SD and wait for the writer (also done
+    // automatically in batches); false if it did not finish in time
+    bool flush();
+
+    // Close the open buckets early so their samples are not lost with RAM,
+    // e.g. before deep sleep; call flush() afterwards
+    void closeOpenBuckets();
+
+    static uint32_t getResolution(HistoryTier tier);
+    static uint32_t getCapacity(HistoryTier tier);
+
+    void printStats();
+
+private:
+    struct Accumulator {
+        uint32_t bucket;
+        uint16_t samples;
+        uint16_t counts[(int)HistoryChannel::COUNT];
+        int16_t min[(int)HistoryChannel::COUNT];
+        int16_t max[(int)HistoryChannel::COUNT];
+        int32_t sum[(int)HistoryChannel::COUNT];
+    };
+
+    struct Tier {
+        HistoryRecord* ring;
+        Accumulator open;
+        HistoryRecord pending[HISTORY_FLUSH_BATCH];
+        uint8_t pendingCount;
+        uint32_t stored;            // Valid slots in the ring
+        uint32_t fileRecords;       // Records in the SD file (writer task)
+        bool misaligned;            // File ends off a record boundary, rewrite before appending (writer task)
+    };
+
+    // Writer task input: records of one tier in bucket order, or a sync marker
+    struct Batch {
+        uint8_t tier;
+        uint8_t count;
+        bool sync;                  // Give syncDone once everything queued before is written
+        HistoryRecord records[HISTORY_FLUSH_BATCH];
+    };
+
+    static SensorHistory* _instance;
+
+    Tier tiers[(int)HistoryTier::COUNT];
+    uint32_t lastSensorSequence;
+    QueueHandle_t queue;
+    SemaphoreHandle_t syncDone;
+    TaskHandle_t taskHandle;
+
+    // Statistics
+    uint32_t samplesAdded;
+    uint32_t recordsLoaded;
+    uint32_t recordsWritten;
+    uint32_t writeErrors;
+    uint32_t compactions;
+    uint32_t discardedBuckets;      // Open buckets dropped after the clock went backwards
+    uint32_t queueFull;             // Batches kept back because the writer was behind
+
+    SensorHistory();
+    void closeBucket(int tier);
+    void store(int tier, const HistoryRecord& record);
+    bool queuePending(int tier, TickType_t wait);
+    static void toRecord(const Accumulator& open, HistoryRecord& record);
+    bool loadTier(int tier);
+    bool appendTier(const Batch& batch);
+    bool compactTier(int tier, uint32_t newest);
+    static void clockCallback(const ClockSnapshot& clock, uint8_t events, void* context);
+    static void taskFunction(void* parameter);
+};
+
+#endif // SENSOR_HISTORY_H
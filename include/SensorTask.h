@@ -0,0 +1,101 @@
+#ifndef SENSOR_TASK_H
+#define SENSOR_TASK_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "SHT31Sensor.h"
+#include "SGP30Sensor.h"
+
+#define SENSOR_TASK_STACK_SIZE      4096
+#define SENSOR_TASK_PRIORITY        2       // Above the loop task, so the 1 Hz period holds
+#define SENSOR_SAMPLE_PERIOD_MS     1000    // The SGP30 IAQ algorithm expects exactly 1 Hz
+#define SENSOR_UI_INTERVAL_MS       10000   // How often the UI takes over the smoothed values
+#define SENSOR_EMA_SHIFT            4       // EMA weight 1/16 (about 16 s time constant)
+#define SENSOR_AH_HYSTERESIS        16      // Resend humidity after a 1/16 g/m^3 change
+#define SGP30_WARMUP_SAMPLES        15      // Fixed 400 ppm / 0 ppb output after IAQ init
+
+// Baseline management for SGP30 sensor
+#define SGP30_BASELINE_INTERVAL_MS  3600000 // Every hour (in milliseconds)
+
+// Latest environmental values; air quality values are smoothed
+struct SensorSnapshot {
+    int16_t temperatureCenti;   // 0.01 degrees Celsius
+    uint16_t humidityCenti;     // 0.01 %RH
+    uint16_t absoluteHumidity;  // g/m^3, 8.8 fixed point
+    uint16_t eco2;              // ppm
+    uint16_t tvoc;              // ppb
+    bool climateValid;
+    bool airValid;
+    uint32_t sequence;          // Incremented on every publish
+};
+
+/**
+ * @brief Task sampling the SGP30 at 1 Hz with SHT31 humidity compensation
+ *
+ * Every period the task starts an SHT31 conversion, runs one SGP30 IAQ
+ * step, then collects the SHT31 result and feeds the absolute humidity
+ * (computed in fixed point from a saturation table) back to the SGP30.
+ * eCO2 and TVOC are smoothed with an exponential moving average and the
+ * snapshot is published for the UI, which picks it up every
+ * SENSOR_UI_INTERVAL_MS. The IAQ baseline is restored from NVS at start
+ * and saved every SGP30_BASELINE_INTERVAL_MS.
+ *
+ * The 'sensors' console command prints driver and timing statistics.
+ */
+class SensorTask {
+public:
+    // Delete copy constructor and assignment operator
+    SensorTask(SensorTask const&) = delete;
+    void operator=(SensorTask const&) = delete;
+
+    // Get singleton instance
+    static SensorTask* getInstance();
+
+    // Detect the sensors and start the task; false if any sensor is missing
+    bool begin();
+
+    // Copy of the latest published values
+    void getSnapshot(SensorSnapshot& snapshot);
+
+    bool isSHT31Present() const { return sht31Present; }
+    bool isSGP30Present() const { return sgp30Present; }
+
+    // Absolute humidity (g/m^3, 8.8 fixed point) from temperature and relative humidity
+    static uint16_t absoluteHumidity(int16_t temperatureCenti, uint16_t humidityCenti);
+
+    void printStats();
+
+private:
+    static SensorTask* _instance;
+
+    SHT31Sensor sht31;
+    SGP30Sensor sgp30;
+    bool sht31Present;
+    bool sgp30Present;
+    TaskHandle_t taskHandle;
+
+    // Owned by the task
+    int32_t eco2Average;        // EMA state, 8 fractional bits
+    int32_t tvocAverage;
+    uint32_t samples;
+    uint16_t lastHumiditySent;
+    uint32_t lastBaselineTime;
+    SensorSnapshot working;
+
+    // Published copy, guarded by a spinlock
+    SensorSnapshot published;
+
+    // Statistics
+    uint32_t overruns;
+    uint32_t maxCycleUs;
+    uint32_t humidityUpdates;
+    uint32_t baselineSaves;
+
+    SensorTask();
+    void sample();
+    void saveBaseline();
+    static void taskFunction(void* parameter);
+};
+
+#endif // SENSOR_TASK_H
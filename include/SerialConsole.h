@@ -0,0 +1,62 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+
+// Handler for a console command. 'args' points to the text after the command name
+// (leading spaces stripped), or to an empty string.
+typedef void (*ConsoleCommandHandler)(const char* args);
+
+/**
+ * @brief Non-blocking line-based command console on the debug serial ports
+ *
+ * loop() only drains the bytes that are already available on Serial (USB CDC) and
+ * Serial0 (UART bridge), so it never waits for input. Complete lines are matched
+ * against the registered command table; subsystems register their own commands.
+ */
+class SerialConsole {
+public:
+    static const int MAX_COMMANDS = 20;
+    static const size_t MAX_LINE_LENGTH = 96;
+
+    // Delete copy constructor and assignment operator
+    SerialConsole(SerialConsole const&) = delete;
+    void operator=(SerialConsole const&) = delete;
+
+    // Get singleton instance
+    static SerialConsole* getInstance();
+
+    // Register a command; returns false if the table is full
+    bool registerCommand(const char* name, const char* help, ConsoleCommandHandler handler);
+
+    // Poll both serial ports and execute any completed command lines
+    void loop();
+
+    // Print the list of registered commands
+    void printHelp();
+
+private:
+    struct Command {
+        const char* name;
+        const char* help;
+        ConsoleCommandHandler handler;
+    };
+
+    struct LineBuffer {
+        char data[MAX_LINE_LENGTH];
+        size_t length = 0;
+    };
+
+    static SerialConsole* _instance;
+
+    Command commands[MAX_COMMANDS];
+    int commandCount = 0;
+    LineBuffer usbLine;
+    LineBuffer uartLine;
+
+    SerialConsole();
+    void poll(Stream& stream, LineBuffer& line);
+    void dispatch(char* line);
+};
+
+#endif // SERIAL_CONSOLE_H
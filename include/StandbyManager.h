@@ -0,0 +1,88 @@
+#ifndef STANDBY_MANAGER_H
+#define STANDBY_MANAGER_H
+
+#include <Arduino.h>
+#include <time.h>
+#include <vector>
+#include "AlarmManager.h"
+#include "ClockService.h"
+
+// Wake this long before the next alarm so Wi-Fi and the stream are up in time
+#ifndef STANDBY_PREROLL_S
+  #define STANDBY_PREROLL_S 20
+#endif
+
+// Do not bother sleeping for less than this
+#define STANDBY_MIN_SLEEP_S 120
+
+// Automatic standby: no touch for this long at night and nothing playing.
+// 0 disables automatic entry ('standby now' still works).
+#ifndef STANDBY_IDLE_TIMEOUT_MS
+  #define STANDBY_IDLE_TIMEOUT_MS (30UL * 60UL * 1000UL)
+#endif
+#define STANDBY_NIGHT_START_HOUR 22
+#define STANDBY_NIGHT_END_HOUR   6
+
+// RTC-capable GPIO wired to the GT911 INT line, or -1. The current panel
+// configuration does not connect INT (pin_int = GPIO_NUM_NC).
+#ifndef STANDBY_TOUCH_WAKE_PIN
+  #define STANDBY_TOUCH_WAKE_PIN -1
+#endif
+
+/**
+ * @brief Deep-sleep standby between alarms
+ *
+ * enterStandby() stores the essentials in RTC memory (time zone and time
+ * base, next alarm, last station, volume, Wi-Fi channel/BSSID), turns Wi-Fi
+ * off and deep-sleeps until STANDBY_PREROLL_S before the next alarm (or the
+ * end of the night window), optionally also waking on touch.
+ *
+ * resumeFromStandby() runs at the very start of setup(). After a timer wake
+ * for an alarm it reads the Wi-Fi credentials from config.json (they are
+ * never kept in RTC memory), reconnects with the cached channel/BSSID and
+ * starts the alarm stream before the display and UI are initialized. The time from
+ * the planned wake to the first audio bytes is logged and kept for the
+ * 'standby' console command.
+ */
+class StandbyManager {
+public:
+    // Delete copy constructor and assignment operator
+    StandbyManager(StandbyManager const&) = delete;
+    void operator=(StandbyManager const&) = delete;
+
+    // Get singleton instance
+    static StandbyManager* getInstance();
+
+    // Fast path after a deep-sleep wake; call first thing in setup()
+    void resumeFromStandby();
+
+    // Register the 'standby' console command and the clock subscription
+    void begin();
+
+    // Wake latency measurement, call from loop()
+    void loop();
+
+    // Automatic entry check, called by ClockService on minute boundaries
+    void onMinute(const ClockSnapshot& clock);
+
+    // Remember the station to play when waking for an alarm
+    void setLastStation(const char* name, const char* url);
+
+    // Deep-sleep until the next alarm; returns false if sleeping is not worthwhile
+    bool enterStandby();
+
+    void printStatus();
+
+    // Next alarm time strictly after 'now', or 0 if there is none.
+    // 'alarm' receives the matching entry.
+    static time_t nextAlarmTime(const std::vector<Alarm>& alarms, time_t now, const Alarm** alarm);
+
+private:
+    static StandbyManager* _instance;
+
+    bool measuringWake;
+
+    StandbyManager();
+};
+
+#endif // STANDBY_MANAGER_H
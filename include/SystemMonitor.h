@@ -0,0 +1,93 @@
+#ifndef SYSTEM_MONITOR_H
+#define SYSTEM_MONITOR_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Sampling period for task and heap statistics
+#define MONITOR_SAMPLE_INTERVAL_MS 5000
+
+// Warning thresholds
+#define MONITOR_STACK_WARN_BYTES      512     // Remaining stack of any task
+#define MONITOR_INTERNAL_HEAP_WARN    (24 * 1024)
+#define MONITOR_PSRAM_HEAP_WARN       (256 * 1024)
+#define MONITOR_LOOP_PERIOD_WARN_US   100000  // 100 ms between two loop() iterations
+
+/**
+ * @brief Singleton that watches FreeRTOS tasks, heap and loop timing
+ *
+ * loopTick() is called at the start of every loop() iteration. It records the
+ * loop period into a log2 histogram and, every MONITOR_SAMPLE_INTERVAL_MS, samples
+ * per-task run-time counters and stack high-water marks as well as the internal
+ * and PSRAM heaps. Results are available through the 'tasks', 'heap' and 'jitter'
+ * serial console commands; threshold crossings are reported as warnings.
+ *
+ * The per-task CPU share needs configGENERATE_RUN_TIME_STATS. The sdkconfig
+ * of the prebuilt arduino-esp32 2.0.17 libraries leaves it off, so 'tasks'
+ * shows "n/a" there; only a core built with its own sdkconfig has the counters.
+ */
+class SystemMonitor {
+public:
+    static const int MAX_TASKS = 24;
+    static const int JITTER_BUCKETS = 12;   // <1ms, <2ms, <4ms ... <1024ms, >=1024ms
+
+    // Delete copy constructor and assignment operator
+    SystemMonitor(SystemMonitor const&) = delete;
+    void operator=(SystemMonitor const&) = delete;
+
+    // Get singleton instance
+    static SystemMonitor* getInstance();
+
+    // Register console commands
+    void begin();
+
+    // Call once per loop() iteration
+    void loopTick();
+
+    // Report printers (also used by the console commands)
+    void printTasks();
+    void printHeap();
+    void printJitter();
+    void resetJitter();
+
+private:
+    struct TaskSample {
+        char name[configMAX_TASK_NAME_LEN];
+        UBaseType_t number;
+        uint32_t stackFreeBytes;
+        uint32_t runTime;
+        uint8_t cpuPercent;
+        int8_t core;
+        UBaseType_t priority;
+    };
+
+    static SystemMonitor* _instance;
+
+    // Task statistics from the last sample
+    TaskSample tasks[MAX_TASKS];
+    int taskCount = 0;
+    uint32_t lastTotalRunTime = 0;
+
+    // Heap statistics
+    uint32_t minFreeInternal = UINT32_MAX;
+    uint32_t minFreePsram = UINT32_MAX;
+
+    // Loop period histogram
+    uint32_t lastLoopMicros = 0;
+    uint32_t jitterBuckets[JITTER_BUCKETS] = {0};
+    uint32_t jitterCount = 0;
+    uint32_t jitterMaxUs = 0;
+    uint64_t jitterSumUs = 0;
+    uint32_t slowLoopsSinceSample = 0;
+
+    unsigned long lastSampleTime = 0;
+
+    SystemMonitor() {}
+    void sample();
+    void sampleTasks();
+    void sampleHeap();
+    const TaskSample* findPrevious(UBaseType_t number, const TaskSample* previous, int previousCount);
+};
+
+#endif // SYSTEM_MONITOR_H
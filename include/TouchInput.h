@@ -0,0 +1,49 @@
+#ifndef TOUCH_INPUT_H
+#define TOUCH_INPUT_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include "HardwareConfig.h"
+
+#define TOUCH_QUEUE_LENGTH       16
+#define TOUCH_TASK_STACK_SIZE    3072
+#define TOUCH_TASK_PRIORITY      3    // Above the loop task: read as soon as INT fires
+#define TOUCH_PRESSED_POLL_MS    30   // While pressed, in case the release edge is missed
+#define TOUCH_FALLBACK_POLL_MS   20   // Without an INT line
+
+// Sampled touch state; timestampUs is the INT edge (or poll) time
+struct TouchEvent {
+    uint32_t timestampUs;
+    uint16_t x;
+    uint16_t y;
+    bool pressed;
+};
+
+// Reads the controller once; returns true and the point while touched.
+// Called on the I2C bus task.
+typedef bool (*TouchReadFn)(uint16_t* x, uint16_t* y);
+
+/**
+ * @brief GT911 touch input driven by the INT line
+ *
+ * An ISR on TOUCH_INT_PIN wakes the touch task, which reads the controller
+ * once (a top-priority I2CBus transaction), timestamps the sample and queues it if the state
+ * or position changed. The LVGL indev read callback only drains the queue,
+ * so there is no I2C traffic while the screen is not touched. Without an
+ * INT line the task polls instead.
+ *
+ * The 'touch' console command prints event counts, I2C reads and the
+ * latency from INT edge to LVGL delivery.
+ */
+class TouchInput {
+public:
+    // Start the touch task; 'read' is called from that task only
+    static void begin(TouchReadFn read);
+
+    // LVGL indev read callback
+    static void readCallback(lv_indev_t* indev, lv_indev_data_t* data);
+
+    static void printStats();
+};
+
+#endif // TOUCH_INPUT_H
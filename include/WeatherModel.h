@@ -0,0 +1,241 @@
+#ifndef WEATHER_MODEL_H
+#define WEATHER_MODEL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <time.h>
+#include "debug_config.h"
+
+// Define debug flag for weather service
+#ifndef WEATHER_DEBUG
+  #define WEATHER_DEBUG 0
+#endif
+
+#define WEATHER_MAX_HOURLY          48      // Hourly forecasts kept (2 days worth)
+
+// The response is parsed one object at a time through a field filter
+#define WEATHER_READ_BUFFER_SIZE    512     // Bytes buffered from the connection
+#define WEATHER_FILTER_SIZE         384     // Filter document for one current/hourly object
+#define WEATHER_ENTRY_DOC_SIZE      512     // Filtered current or hourly object
+
+// Interned weather descriptions (one table per fetch)
+#define WEATHER_MAX_DESCRIPTIONS    24
+#define WEATHER_DESCRIPTION_POOL    512     // Bytes for all description texts
+#define WEATHER_NO_DESCRIPTION      0xFF
+
+// OpenWeatherMap icon code in one byte: condition << 1 | night.
+// The conditions are in code order ("01" .. "50").
+enum class WeatherIcon : uint8_t {
+    CLEAR_DAY = 0,      CLEAR_NIGHT,        // 01
+    FEW_CLOUDS_DAY,     FEW_CLOUDS_NIGHT,   // 02
+    CLOUDS_DAY,         CLOUDS_NIGHT,       // 03
+    BROKEN_CLOUDS_DAY,  BROKEN_CLOUDS_NIGHT,// 04
+    SHOWERS_DAY,        SHOWERS_NIGHT,      // 09
+    RAIN_DAY,           RAIN_NIGHT,         // 10
+    THUNDERSTORM_DAY,   THUNDERSTORM_NIGHT, // 11
+    SNOW_DAY,           SNOW_NIGHT,         // 13
+    MIST_DAY,           MIST_NIGHT,         // 50
+    COUNT
+};
+
+#define WEATHER_ICON_CONDITIONS     ((int)WeatherIcon::COUNT / 2)
+
+// Parse an icon code such as "10n"; unknown codes become CLEAR_DAY
+WeatherIcon weatherIconFromCode(const char* code);
+
+constexpr WeatherIcon makeWeatherIcon(uint8_t condition, bool night) {
+    return (WeatherIcon)((condition << 1) | (night ? 1u : 0u));
+}
+constexpr uint8_t weatherIconCondition(WeatherIcon icon) { return (uint8_t)icon >> 1; }
+
+// Weather data structures. Temperatures are in 0.01 degrees (the
+// configured unit system), probabilities in percent. All plain data, so
+// they can be copied and stored as they are.
+
+// Morning, afternoon, and night forecast summary
+struct ForecastSummary {
+    int16_t avgTempCenti = 0;
+    uint8_t avgPop = 0;    // Average probability of precipitation
+    WeatherIcon icon = WeatherIcon::CLOUDS_DAY;  // Most frequent condition
+};
+
+struct CurrentWeather {
+    uint32_t dt = 0;       // Unix timestamp
+    uint32_t sunrise = 0;
+    uint32_t sunset = 0;
+    int16_t tempCenti = 0;
+    int16_t feelsLikeCenti = 0;
+    WeatherIcon icon = WeatherIcon::CLEAR_DAY;
+    uint8_t description = WEATHER_NO_DESCRIPTION;
+};
+
+// Hourly forecasts, one array per field; only what the summaries use is kept
+struct HourlyForecasts {
+    uint32_t dt[WEATHER_MAX_HOURLY];          // Unix timestamp for this hour
+    int16_t tempCenti[WEATHER_MAX_HOURLY];
+    uint8_t pop[WEATHER_MAX_HOURLY];          // Probability of precipitation
+    uint8_t icon[WEATHER_MAX_HOURLY];         // WeatherIcon
+    uint8_t description[WEATHER_MAX_HOURLY];
+};
+
+// Each distinct description text of a response is stored once
+struct DescriptionTable {
+    uint8_t count;
+    uint16_t used;
+    uint16_t offset[WEATHER_MAX_DESCRIPTIONS];
+    char pool[WEATHER_DESCRIPTION_POOL];
+};
+
+enum ForecastPeriod {
+    PERIOD_MORNING = 0,
+    PERIOD_AFTERNOON,
+    PERIOD_NIGHT,
+    PERIOD_COUNT
+};
+
+// Running totals over the hours of one period
+struct PeriodAccumulator {
+    int32_t tempSum;
+    uint16_t popSum;
+    uint8_t count;
+    uint8_t conditions[WEATHER_ICON_CONDITIONS];    // Hours per condition
+};
+
+/**
+ * @brief Buffered reader over a response body or a recorded payload
+ *
+ * Serves as the ArduinoJson input and lets the parser skip to the parts
+ * of the response it needs. Works on any Stream (HTTPS body, SD file).
+ */
+class WeatherStreamReader {
+public:
+    explicit WeatherStreamReader(Stream* stream) : stream(stream), position(0), length(0), total(0) {}
+
+    // Start over on another stream
+    void begin(Stream* source) {
+        stream = source;
+        position = 0;
+        length = 0;
+        total = 0;
+    }
+
+    // ArduinoJson reader interface
+    int read() {
+        if (position == length && !fill()) {
+            return -1;
+        }
+        return buffer[position++];
+    }
+    size_t readBytes(char* out, size_t size);
+
+    // Consume input up to and including 'target'
+    bool find(const char* target);
+
+    // Consume input up to and including 'c'; returns c or -1 at the end
+    int skipTo(char c);
+
+    // Next array separator after an element: ',' or ']' (-1 at the end)
+    int skipToSeparator();
+
+    size_t bytesRead() const { return total; }
+
+private:
+    Stream* stream;
+    uint8_t buffer[WEATHER_READ_BUFFER_SIZE];
+    size_t position;
+    size_t length;
+    size_t total;
+
+    bool fill();
+};
+
+// Data of one response while it is parsed; it replaces a model's data
+// only once the response was read completely
+struct WeatherParseScratch {
+    CurrentWeather current;
+    HourlyForecasts hourly;
+    int hourlyCount;
+    DescriptionTable descriptions;
+};
+
+// Everything needed while one response is parsed. Responses are parsed
+// one at a time, so a single set serves all locations.
+struct WeatherParseBuffers {
+    WeatherStreamReader reader;
+    StaticJsonDocument<WEATHER_FILTER_SIZE> filter;
+    StaticJsonDocument<WEATHER_ENTRY_DOC_SIZE> entry;
+    WeatherParseScratch scratch;
+
+    WeatherParseBuffers() : reader(nullptr) {}
+};
+
+/**
+ * @brief Parsed One Call data and the period summaries derived from it
+ *
+ * The parsing and aggregation half of the weather service, with no
+ * network, SD or UI dependencies: parse() reads a One Call response from
+ * any stream and summarize() derives the morning/afternoon/night
+ * summaries for a given time in the local time zone (TZ). WeatherService
+ * feeds it from the API; the 'weather replay' console command feeds it
+ * recorded payloads.
+ *
+ * Each period is a window over the sorted hourly data with running
+ * totals. advance() slides the windows as time passes: within a period
+ * an hour leaving the current window is subtracted, and at sunrise, noon
+ * and sunset the windows move on to their next range. Each hour enters
+ * and leaves a window once, so the summaries follow the clock from the
+ * stored data without a fetch, and without mktime() outside the period
+ * boundaries.
+ */
+class WeatherModel {
+public:
+    CurrentWeather current;
+    HourlyForecasts hourly;
+    int hourlyCount;
+    DescriptionTable descriptions;
+    ForecastSummary summaries[PERIOD_COUNT];
+
+    WeatherModel();
+
+    // Parse "current" and "hourly" from buffers.reader; peakDocument
+    // receives the largest filtered entry. The model keeps its data unless
+    // the whole response up to the end of "hourly" was read without error.
+    bool parse(WeatherParseBuffers& buffers, size_t& peakDocument);
+
+    // Recompute the period summaries relative to 'now' from scratch
+    bool summarize(time_t now);
+
+    // Move the windows forward to 'now'; true if a summary changed.
+    // Cheap when no boundary was crossed, so it can run every minute.
+    bool advance(time_t now);
+
+    // Rebuild on the next advance() (new data, clock or time zone change)
+    void resetWindows();
+
+    // Forget all data, as before the first parse
+    void clear();
+
+    // Text of an interned description ("" for none)
+    const char* getDescription(uint8_t id) const;
+
+private:
+    struct PeriodWindow {
+        uint8_t first;              // Hours [first, last) fall into the window
+        uint8_t last;
+        time_t end;
+        PeriodAccumulator totals;
+    };
+
+    PeriodWindow windows[PERIOD_COUNT];
+    ForecastPeriod currentPeriod;   // The window that starts now
+    time_t layoutUntil;             // End of the current period
+    time_t nextEvent;               // Nothing changes before this
+    time_t lastNow;
+    bool windowsValid;
+
+    void computeLayout(time_t now, time_t start[], time_t end[]);
+    void slideWindow(int period, time_t start, time_t end);
+    void addHour(PeriodAccumulator& totals, int index, int sign);
+};
+
+#endif // WEATHER_MODEL_H
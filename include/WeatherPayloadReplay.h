@@ -0,0 +1,44 @@
+#ifndef WEATHER_PAYLOAD_REPLAY_H
+#define WEATHER_PAYLOAD_REPLAY_H
+
+#include <Arduino.h>
+#include "WeatherModel.h"
+
+#define WEATHER_REPLAY_MINUTES      (36 * 60)   // Incremental summaries followed from "dt"
+#define WEATHER_REPLAY_ZONES        4
+#define WEATHER_REPLAY_HOURS        4
+
+// Zones the summaries are recomputed in (POSIX TZ strings)
+extern const char* const WEATHER_REPLAY_ZONE_NAMES[WEATHER_REPLAY_ZONES];
+
+// Offsets from the payload's "dt" at which the summaries are recomputed
+extern const uint8_t WEATHER_REPLAY_HOUR_OFFSETS[WEATHER_REPLAY_HOURS];
+
+extern const char* const WEATHER_PERIOD_NAMES[PERIOD_COUNT];
+
+struct WeatherReplayResult {
+    bool parsed;
+    size_t bytes;
+    uint32_t parseUs;
+    size_t peakDocument;
+    uint32_t maxSummarizeUs;
+    uint32_t changes;               // Summary changes while following the clock (all zones)
+    uint32_t mismatches;            // Incremental summaries that differ from a recomputation
+};
+
+/**
+ * @brief Replay of one recorded One Call payload
+ *
+ * Shared by the 'weather replay' console command and the host test in
+ * test/test_weather_replay, so both run the same code on the same data.
+ * Parses the payload that buffers.reader was started on into 'model',
+ * then, in each of the WEATHER_REPLAY_ZONE_NAMES, recomputes the period
+ * summaries at the WEATHER_REPLAY_HOUR_OFFSETS after its "dt" and follows
+ * them minute by minute for WEATHER_REPLAY_MINUTES, comparing every
+ * change with a full recomputation in 'check'. Progress is printed with
+ * DEBUG_PRINTF. Changes TZ; the caller restores it.
+ */
+bool replayWeatherPayload(WeatherParseBuffers& buffers, WeatherModel& model, WeatherModel& check,
+                          WeatherReplayResult& result);
+
+#endif // WEATHER_PAYLOAD_REPLAY_H
@@ -0,0 +1,30 @@
+#ifndef WEATHER_REPLAY_H
+#define WEATHER_REPLAY_H
+
+#include <Arduino.h>
+
+// Recorded One Call responses (*.json) replayed by 'weather replay'
+#define WEATHER_REPLAY_DIR          "/weather/replay"
+#define WEATHER_REPLAY_MAX_FILES    16
+
+/**
+ * Weather pipeline replay on the device
+ *
+ * The 'weather' console command prints the state of each configured
+ * location and the memory held by the locations and the shared parse
+ * buffers; 'weather replay' runs every recorded response in
+ * WEATHER_REPLAY_DIR through replayWeatherPayload() with models of its
+ * own, without Wi-Fi or an API key. The same replay runs on the host
+ * with 'pio test -e native' over the payloads in test/weather_payloads;
+ * on the device it shows the timings of the real target.
+ */
+class WeatherReplay {
+public:
+    // Register the 'weather' console command
+    static void begin();
+
+    static void printStatus();
+    static void run();
+};
+
+#endif // WEATHER_REPLAY_H
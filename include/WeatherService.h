@@ -3,116 +3,116 @@
 
 #include <Arduino.h>
 #include <HTTPClient.h>
-#include <ArduinoJson.h>
 #include <WiFi.h>
 #include <time.h>
-#include "debug_config.h"
+#include "WeatherModel.h"
+#include "ConfigManager.h"
 
-// Define debug flag for weather service
-#ifndef WEATHER_DEBUG
-  #define WEATHER_DEBUG 0
-#endif
+#define WEATHER_API_HOST            "api.openweathermap.org"
 
+// Locations: home plus up to three more, each in its own PSRAM slot
+#define WEATHER_MAX_LOCATIONS       4
+#define WEATHER_LOCATION_NAME_LENGTH 24
+#define WEATHER_ROTATE_S            10      // Seconds each location is shown on the card
+#define WEATHER_DEFAULT_TITLE       "Aktuelles Wetter"  // Card title of an unnamed home location
+#define WEATHER_LOCATION_TITLE      "Ort %d"            // ...and of other unnamed locations (1-based)
+
+// Refresh policy: data age against the provider's update cadence
+#define WEATHER_PROVIDER_INTERVAL_S 600     // One Call recomputes current conditions about every 10 min
+#define WEATHER_REFRESH_MARGIN_S    60      // Fetch this long after new data is expected
+#define WEATHER_MIN_REFRESH_S       300     // Never fetch more often than this
+#define WEATHER_RETRY_MIN_S         60      // First retry after a failed fetch, doubling...
+#define WEATHER_RETRY_MAX_S         1800    // ...up to this
+#define WEATHER_CHECK_INTERVAL_MS   5000    // How often the UI timer asks whether a refresh is due
+#define WEATHER_FETCH_GAP_MS        5000    // At least this long between two requests (any locations)
+
+// Snapshot of the parsed state on SD, shown at boot before the first fetch.
+// The home location uses WEATHER_CACHE_FILE, the others WEATHER_CACHE_PATTERN.
+#define WEATHER_CACHE_FILE          "/weather.bin"
+#define WEATHER_CACHE_PATTERN       "/weather%d.bin"
+#define WEATHER_CACHE_TMP           "/weather.tmp"
+#define WEATHER_CACHE_MAGIC         0x52485457u // "WTHR"
+#define WEATHER_CACHE_VERSION       3
+#define WEATHER_CACHE_MAX_AGE_S     (48 * 3600) // Older snapshots are past the hourly horizon
+
+struct ClockSnapshot;
+
+// One configured location: its refresh state and parsed data
+struct WeatherLocation {
+    char name[WEATHER_LOCATION_NAME_LENGTH] = "";
+    float lat = 0.0f;
+    float lon = 0.0f;
+
+    // Refresh state; times are epoch seconds, 0 = no data of known age
+    time_t fetchedAt = 0;
+    time_t nextRefresh = 0;
+    uint32_t lastAttemptMs = 0;
+    uint32_t retryDelay = 0;          // Seconds
+    uint32_t failedAttempts = 0;
+    float cachedLat = 0.0f;           // Location of the data on SD
+    float cachedLon = 0.0f;
+
+    WeatherModel model;
+};
+
+/**
+ * @brief Weather for up to WEATHER_MAX_LOCATIONS locations
+ *
+ * Each location has its own refresh state and model in a PSRAM slot of
+ * sizeof(WeatherLocation) bytes, allocated when it is configured or
+ * restored from SD. The parse buffers exist once and are shared.
+ *
+ * update() fetches at most one location per call: the most overdue one,
+ * at least WEATHER_FETCH_GAP_MS after the previous request and never
+ * while a radio stream is starting. Locations that come due together are
+ * fetched a few seconds apart on the kept-alive HTTPS connection. The
+ * weather card shows one location at a time and moves on to the next one
+ * with data every WEATHER_ROTATE_S seconds.
+ */
 class WeatherService {
-public:
-    // Constants
-    static const int MAX_HOURLY_FORECASTS = 48;  // Maximum number of hourly forecasts (2 days worth)
-    
-    // Weather data structures
-    // Morning, afternoon, and night forecast summary
-    struct ForecastSummary {
-        float avgTemp = 0.0f;
-        float avgPop = 0.0f;   // Average probability of precipitation
-        String iconCode;       // Most frequent icon code
-    };
-    
-    struct CurrentWeather {
-        long dt = 0;           // Unix timestamp
-        long sunrise = 0;
-        long sunset = 0;
-        float temp = 0.0f;
-        float feels_like = 0.0f;
-        int pressure = 0;
-        int humidity = 0;
-        float dew_point = 0.0f;
-        int clouds = 0;
-        float uvi = 0.0f;
-        int visibility = 0;
-        float wind_speed = 0.0f;
-        float wind_gust = 0.0f;
-        int wind_deg = 0;
-        float rain_1h = 0.0f;
-        float snow_1h = 0.0f;
-        int weather_id = 0;
-        String weather_main;
-        String weather_description;
-        String weather_icon;
-    };
-    
-    // Structure for hourly forecast
-    struct HourlyForecast {
-        long dt = 0;         // Unix timestamp for this hour
-        float temp = 0.0f;   // Temperature
-        float feels_like = 0.0f;
-        int pressure = 0;
-        int humidity = 0;
-        float dew_point = 0.0f;
-        int clouds = 0;
-        float uvi = 0.0f;
-        int visibility = 0;
-        float wind_speed = 0.0f;
-        float wind_gust = 0.0f;
-        int wind_deg = 0;
-        float pop = 0.0f;    // Probability of precipitation
-        float rain_1h = 0.0f;
-        float snow_1h = 0.0f;
-        int weather_id = 0;
-        String weather_main;
-        String weather_description;
-        String weather_icon;
-    };
-    
 private:
     static WeatherService* instance;
-    
+
     // Private constructor
-    WeatherService() : appid(""), lat(0.0f), lon(0.0f), units("metric"), lang("de"), lastUpdateTime(0) {}
-    
+    WeatherService();
+
     // Prevent copying and assignment
     WeatherService(const WeatherService&) = delete;
     WeatherService& operator=(const WeatherService&) = delete;
-    
+
     // API call details
     String appid;
-    float lat = 0.0f;
-    float lon = 0.0f;
     String units = "metric";
     String lang = "de";
-    uint32_t lastUpdateTime = 0;
-    uint32_t updateInterval = 300000; // Default 5 minutes (300,000 ms)
-    
-    // Weather data storage
-    CurrentWeather currentWeather;
-    
-    // Store hourly forecasts
-    HourlyForecast hourlyForecasts[MAX_HOURLY_FORECASTS];
-    int hourlyForecastCount = 0;
-    
-    // Storage for morning, afternoon, and night forecast summaries
-    ForecastSummary morningForecast;
-    ForecastSummary afternoonForecast;
-    ForecastSummary nightForecast;
-    
+
+    WeatherLocation* locations[WEATHER_MAX_LOCATIONS];
+    int locationCount = 0;
+    int displayed = 0;                // Location on the weather card
+    uint8_t rotateSeconds = 0;
+    uint32_t lastFetchMs = 0;
+    bool clockSubscribed = false;
+
+    // Shared by all locations, allocated on the first fetch
+    WeatherParseBuffers* parseBuffers = nullptr;
+
+    WeatherLocation* allocateLocation(int index);
+    void releaseLocation(int index);
+
     // Function to make API call
-    bool fetchWeatherData();
-    
-    // Parse different parts of the API response
-    void parseCurrentWeather(const JsonObject& current);
-    void parseHourlyForecast(const JsonArray& hourly);
-    
+    bool fetchWeatherData(WeatherLocation& location);
+
+    int nextDueLocation(const ClockSnapshot& clock) const;
+    void scheduleRefresh(WeatherLocation& location);
+    bool isRefreshDue(const WeatherLocation& location, const ClockSnapshot& clock) const;
+    bool restoreLocation(int index);
+    bool saveCache(int index);
+    void dropLocationData(int index, const ClockSnapshot& clock);
+
+    // Show the next location with data; false if there is none
+    bool showNextLocation();
+
     // Calculate morning, afternoon, and night forecasts based on hourly data
-    void calculateDailyForecasts();
-    String getMostFrequentIcon(const std::vector<String>& icons);
+    void calculateDailyForecasts(WeatherLocation& location);
 
 public:
     // Static method to get the singleton instance
@@ -122,33 +122,43 @@ public:
         }
         return *instance;
     }
-    
-    // Initialize with API key and location
-    bool init(const String& apiKey, float latitude, float longitude, 
+
+    // Initialize with API key and locations (the first is home)
+    bool init(const String& apiKey, const WeatherLocationConfig* configs, int count,
               const String& unitSystem = "metric", const String& language = "de");
-    
-    // Update weather data (will only fetch if updateInterval has passed)
+
+    // Show the snapshots saved by the last successful fetches; call after ui_init()
+    bool restoreCache();
+
+    // Fetch the most overdue location, if any is due and fetching is allowed now
     bool update();
-    
-    // Force update regardless of time interval
-    bool forceUpdate();
-    
-    // Getters for weather data
-    const CurrentWeather& getCurrentWeather() const { return currentWeather; }
-    
-    // Get forecast summaries
-    const ForecastSummary& getMorningForecast() const { return morningForecast; }
-    const ForecastSummary& getAfternoonForecast() const { return afternoonForecast; }
-    const ForecastSummary& getNightForecast() const { return nightForecast; }
-    
+
+    // Fetch one location regardless of its data age
+    bool forceUpdate(int index);
+
+    // Move the forecast summaries along the stored hourly data to the clock
+    // time; 'rebuild' recomputes them from scratch (clock sync, DST) and drops
+    // data older than WEATHER_CACHE_MAX_AGE_S, e.g. restored before the clock was set
+    void refreshForecastSummaries(const ClockSnapshot& clock, bool rebuild);
+
+    // Show the next location with data on the weather card
+    void rotate();
+
     // Update UI with weather data
     void updateWeatherUI();
-    
-    // Helper function to map icon codes to UI image resources
-    const void* getIconForCode(const String& iconCode);
-    
-    // Set update interval (in milliseconds)
-    void setUpdateInterval(uint32_t interval) { updateInterval = interval; }
+
+    // Helper function to map icons to UI image resources
+    const void* getIconImage(WeatherIcon icon);
+
+    // Locations (nullptr for an unused slot)
+    int getLocationCount() const { return locationCount; }
+    const WeatherLocation* getLocation(int index) const {
+        return index >= 0 && index < WEATHER_MAX_LOCATIONS ? locations[index] : nullptr;
+    }
+    int getDisplayedLocation() const { return displayed; }
+
+    // Bytes held by the shared parse buffers (0 before the first fetch)
+    size_t getSharedBytes() const { return parseBuffers ? sizeof(WeatherParseBuffers) : 0; }
 };
 
 #endif // WEATHERSERVICE_H
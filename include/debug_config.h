@@ -72,11 +72,41 @@
   #define ALARM_DEBUG 1
 #endif
 
+// Controls debug output for audio streaming
+#ifndef AUDIO_DEBUG
+  #define AUDIO_DEBUG 0
+#endif
+
 // Controls debug output for the Alarm Manager
 #ifndef ALARM_UI_DEBUG
   #define ALARM_UI_DEBUG 1
 #endif
 
+// Enables scoped profiling zones (PROFILE_ZONE, see Profiler.h)
+#ifndef PROFILING
+  #define PROFILING 0
+#endif
+
+// Enables per-subsystem heap allocation tracing (ALLOC_SCOPE, see AllocTracker.h)
+#ifndef ALLOC_TRACE
+  #define ALLOC_TRACE 0
+#endif
+
+// Enables esp_pm DFS/light sleep with activity locks (see PowerManager.h)
+#ifndef POWER_MANAGEMENT
+  #define POWER_MANAGEMENT 1
+#endif
+
+// Set by the release environment in platformio.ini
+#ifndef RELEASE_BUILD
+  #define RELEASE_BUILD 0
+#endif
+
+// Routes LOG_* output through the deferred logging task (see DeferredLog.h)
+#ifndef DEFERRED_LOG
+  #define DEFERRED_LOG 1
+#endif
+
 // Dual Serial Debug Output Macros
 // These send debug output to both USB CDC (Serial) and UART (Serial0)
 #define DEBUG_PRINT(x) do { \
@@ -22,6 +22,11 @@
 #include "my_include.h"
 #endif
 
+/*IRAM_ATTR for the hot-path attributes below*/
+#if !defined(__ASSEMBLY__)
+#include "esp_attr.h"
+#endif
+
 /*====================
    COLOR SETTINGS
  *====================*/
@@ -43,7 +48,7 @@
  * - LV_STDLIB_RTTHREAD:    RT-Thread implementation
  * - LV_STDLIB_CUSTOM:      Implement the functions externally
  */
-#define LV_USE_STDLIB_MALLOC    LV_STDLIB_CLIB
+#define LV_USE_STDLIB_MALLOC    LV_STDLIB_CUSTOM   /*Two-tier heap in src/LvglHeap.cpp*/
 #define LV_USE_STDLIB_STRING    LV_STDLIB_BUILTIN
 #define LV_USE_STDLIB_SPRINTF   LV_STDLIB_BUILTIN
 
@@ -468,7 +473,14 @@
 #define LV_ATTRIBUTE_LARGE_RAM_ARRAY
 
 /*Place performance critical functions into a faster memory (e.g RAM)*/
+/*IRAM only for the software blend/fill kernels: scripts/hot_path_opt.py defines
+ *LV_FAST_MEM_IRAM for those files. Elsewhere (style lookups, masks, trigo) the
+ *attribute would fill IRAM with code that is not on the per-pixel path.*/
+#ifdef LV_FAST_MEM_IRAM
+#define LV_ATTRIBUTE_FAST_MEM IRAM_ATTR
+#else
 #define LV_ATTRIBUTE_FAST_MEM
+#endif
 
 /*Export integer constant to binding. This macro is used with constants in the form of LV_<CONST> that
  *should also appear on LVGL binding API such as MicroPython.*/
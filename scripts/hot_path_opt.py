@@ -0,0 +1,94 @@
+# PlatformIO pre-script for the device environments.
+#
+# IRAM: only LVGL's software blend/fill kernels get LV_ATTRIBUTE_FAST_MEM as
+# IRAM_ATTR (LV_FAST_MEM_IRAM, see lv_conf.h). They are the leaf loops that
+# touch every pixel; everything they call is inline. After linking, the
+# IRAM the image uses is read from the map file and printed.
+#
+# Release builds keep -Os for everything except the hot modules below,
+# which are compiled with -O2: the display flush path, the audio task
+# and LVGL's software renderer (blend/fill kernels, rasterizer).
+
+import os
+import re
+
+Import("env")
+
+IRAM_SOURCES = (
+    "src/draw/sw/blend/",    # LVGL blend/fill kernels
+)
+
+HOT_PATH_SOURCES = (
+    "src/main.cpp",
+    "src/AudioManager.cpp",
+    "src/draw/sw/",          # LVGL software renderer and blend kernels
+    "src/misc/lv_color",
+    "src/misc/lv_area",
+)
+
+RELEASE = env.GetProjectOption("build_type") == "release"
+
+
+def hot_path_build(env, node):
+    path = node.get_path().replace("\\", "/")
+    overrides = {}
+    if any(hot in path for hot in IRAM_SOURCES):
+        overrides["CPPDEFINES"] = list(env.get("CPPDEFINES", [])) + ["LV_FAST_MEM_IRAM"]
+    if RELEASE and any(hot in path for hot in HOT_PATH_SOURCES):
+        # The last -O option wins, so -O2 overrides the default -Os
+        overrides["CCFLAGS"] = env["CCFLAGS"] + ["-O2"]
+    if not overrides:
+        return node
+    return env.Object(node, **overrides)
+
+
+env.AddBuildMiddleware(hot_path_build)
+
+
+# Input section line of the map: "[name] 0xaddress 0xsize object"; the name
+# is on a line of its own when it is long
+MAP_ENTRY = re.compile(r"^\s+(?:\S+\s+)?0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+MAP_OUTPUT_SECTION = re.compile(r"^(\.\S+)\s*(?:0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+))?")
+REPORT_OBJECTS = 12
+
+
+def iram_usage(map_path):
+    total = 0
+    by_object = {}
+    in_iram = False
+    with open(map_path) as map_file:
+        for line in map_file:
+            section = MAP_OUTPUT_SECTION.match(line)
+            if section:
+                in_iram = section.group(1) == ".iram0.text"
+                if in_iram and section.group(2):
+                    total = int(section.group(2), 16)
+                continue
+            if not in_iram:
+                continue
+            entry = MAP_ENTRY.match(line)
+            if entry:
+                size = int(entry.group(1), 16)
+                name = os.path.basename(entry.group(2).strip())
+                by_object[name] = by_object.get(name, 0) + size
+    return total, by_object
+
+
+def report_iram(source, target, env):
+    map_path = os.path.join(env.subst("$BUILD_DIR"), env.subst("${PROGNAME}.map"))
+    if not os.path.isfile(map_path):
+        print("IRAM report: no map file at %s" % map_path)
+        return
+    total, by_object = iram_usage(map_path)
+    print("IRAM report: .iram0.text %d bytes" % total)
+    largest = sorted(by_object.items(), key=lambda item: item[1], reverse=True)
+    for name, size in largest[:REPORT_OBJECTS]:
+        print("  %7d  %s" % (size, name))
+    project = [(name, size) for name, size in by_object.items()
+               if "(lv_draw_sw_blend" in name or not name.startswith("lib")]
+    print("  LVGL kernels and project objects: %d bytes" % sum(size for _, size in project))
+
+
+if not any("-Map" in str(flag) for flag in env.get("LINKFLAGS", [])):
+    env.Append(LINKFLAGS=["-Wl,-Map=" + os.path.join("$BUILD_DIR", "${PROGNAME}.map")])
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report_iram)
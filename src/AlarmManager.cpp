@@ -3,6 +3,10 @@
 #include <SD.h>
 #include <algorithm> // For std::remove_if
 #include "debug_config.h"
+#include "Profiler.h"
+#include "AllocTracker.h"
+#include "DeferredLog.h"
+#include "PsramAllocator.h"
 #include "ui_helpers_extended.h"
 #include "ui.h"
 #include "HardwareConfig.h"
@@ -34,31 +38,26 @@ AlarmManager::~AlarmManager() {
 
 // Load alarms from JSON file on SD card
 void AlarmManager::loadAlarms() {
+    PROFILE_ZONE("alarm.load");
+    ALLOC_SCOPE(AllocTag::ALARM);
     File file = SD.open("/alarms.json", FILE_READ);
     if (!file) {
-#if ALARM_DEBUG
-        DEBUG_PRINTLN("Error: Failed to open alarms.json for reading");
-#endif
+        LOG_ERROR(ALARM, "Failed to open alarms.json for reading");
         return;
     }
 
-    DynamicJsonDocument doc(2048);
+    PsramJsonDocument doc(2048);
     DeserializationError error = deserializeJson(doc, file);
     file.close();
 
     if (error) {
-#if ALARM_DEBUG
-        DEBUG_PRINT("Error: Failed to parse alarms.json: ");
-        DEBUG_PRINTLN(error.c_str());
-#endif
+        LOG_ERROR(ALARM, "Failed to parse alarms.json: %s", error.c_str());
         return;
     }
 
     JsonArray array = doc.as<JsonArray>();
     if (array.isNull()) {
-#if ALARM_DEBUG
-        DEBUG_PRINTLN("Error: alarms.json is not a valid JSON array.");
-#endif
+        LOG_ERROR(ALARM, "alarms.json is not a valid JSON array");
         return;
     }
 
@@ -85,9 +84,7 @@ void AlarmManager::loadAlarms() {
         m_alarms.push_back(alarm);
     }
 
-#if ALARM_DEBUG
-    DEBUG_PRINTF("Successfully loaded %d alarms from alarms.json\n", m_alarms.size());
-#endif
+    LOG_DEBUG(ALARM, "Successfully loaded %d alarms from alarms.json", m_alarms.size());
 }
 
 const std::vector<Alarm>& AlarmManager::getAlarms() const {
@@ -95,15 +92,15 @@ const std::vector<Alarm>& AlarmManager::getAlarms() const {
 }
 
 bool AlarmManager::saveAlarms() {
+    PROFILE_ZONE("alarm.save");
+    ALLOC_SCOPE(AllocTag::ALARM);
     File file = SD.open("/alarms.json", FILE_WRITE);
     if (!file) {
-#if ALARM_DEBUG
-        DEBUG_PRINTLN("Error: Failed to open alarms.json for writing");
-#endif
+        LOG_ERROR(ALARM, "Failed to open alarms.json for writing");
         return false;
     }
 
-    DynamicJsonDocument doc(2048);
+    PsramJsonDocument doc(2048);
     JsonArray array = doc.to<JsonArray>();
 
     for (const auto& alarm : m_alarms) {
@@ -123,17 +120,13 @@ bool AlarmManager::saveAlarms() {
     }
 
     if (serializeJson(doc, file) == 0) {
-#if ALARM_DEBUG
-        DEBUG_PRINTLN("Error: Failed to write to alarms.json");
-#endif
+        LOG_ERROR(ALARM, "Failed to write to alarms.json");
         file.close();
         return false;
     }
 
     file.close();
-#if ALARM_DEBUG
-    DEBUG_PRINTLN("Successfully saved alarms to alarms.json");
-#endif
+    LOG_DEBUG(ALARM, "Successfully saved alarms to alarms.json");
     return true;
 }
 
@@ -184,13 +177,9 @@ void AlarmManager::deleteAlarm(int alarmId) {
     if (it != m_alarms.end()) {
         m_alarms.erase(it, m_alarms.end());
         saveAlarms();
-        #if ALARM_DEBUG
-        DEBUG_PRINTF("Alarm with ID %d deleted.\n", alarmId);
-        #endif
+        LOG_DEBUG(ALARM, "Alarm with ID %d deleted", alarmId);
     } else {
-        #if ALARM_DEBUG
-        DEBUG_PRINTF("Alarm with ID %d not found for deletion.\n", alarmId);
-        #endif
+        LOG_DEBUG(ALARM, "Alarm with ID %d not found for deletion", alarmId);
     }
 }
 
@@ -207,15 +196,11 @@ int AlarmManager::getNextAlarmId() {
 
 
 void AlarmManager::populateAlarmList() {
-    #if ALARM_DEBUG
-    DEBUG_PRINTLN("Populating alarm list UI...");
-    #endif
+    LOG_DEBUG(ALARM, "Populating alarm list UI...");
 
     lv_obj_t* panel = get_alarms_panel_obj();
     if (!panel) {
-        #if ALARM_DEBUG
-        DEBUG_PRINTLN("Error: alarms_panel object not found!");
-        #endif
+        LOG_ERROR(ALARM, "alarms_panel object not found!");
         return;
     }
 
@@ -266,9 +251,7 @@ void AlarmManager::populateAlarmList() {
         }
     }
 
-    #if ALARM_DEBUG
-    DEBUG_PRINTF("Successfully populated %d alarm entries.\n", m_alarms.size());
-    #endif
+    LOG_DEBUG(ALARM, "Successfully populated %d alarm entries", m_alarms.size());
 }
 
 void AlarmManager::setSelectedAlarm(int alarmId, lv_obj_t* obj) {
@@ -298,9 +281,7 @@ int AlarmManager::getSelectedAlarmId() const {
 
 void AlarmManager::deleteSelectedAlarm() {
     if (m_selectedAlarmId != -1) {
-        #if ALARM_DEBUG
-        DEBUG_PRINTF("Deleting alarm %d.\n", m_selectedAlarmId);
-        #endif
+        LOG_DEBUG(ALARM, "Deleting alarm %d", m_selectedAlarmId);
         deleteAlarm(m_selectedAlarmId);
         populateAlarmList();
     }
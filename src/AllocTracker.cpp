@@ -0,0 +1,291 @@
+#include "AllocTracker.h"
+
+#if ALLOC_TRACE
+
+#include <new>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include "SerialConsole.h"
+#include "AudioManager.h"
+#include "RadioData.h"
+
+#if __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
+
+// Header placed in front of every block handed out by operator new.
+// 8 bytes keeps the payload 8-byte aligned.
+struct AllocHeader {
+    uint32_t size;
+    uint16_t magic;
+    uint8_t tag;
+    uint8_t psram;
+};
+
+static const uint16_t ALLOC_MAGIC = 0xA11C;
+static const int TAG_COUNT = (int)AllocTag::COUNT;
+
+static AllocCounters internalCounters[TAG_COUNT];
+static AllocCounters psramCounters[TAG_COUNT];
+static portMUX_TYPE countersMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Active tag of the running task
+static __thread uint8_t activeTag = (uint8_t)AllocTag::SYSTEM;
+
+static const char* const TAG_NAMES[TAG_COUNT] = {
+    "system", "audio", "weather", "ui", "config", "alarm", "sensor", "network"
+};
+
+const char* AllocTracker::tagName(AllocTag tag) {
+    int index = (int)tag;
+    return (index >= 0 && index < TAG_COUNT) ? TAG_NAMES[index] : "?";
+}
+
+AllocTag AllocTracker::currentTag() {
+    return (AllocTag)activeTag;
+}
+
+AllocTag AllocTracker::exchangeTag(AllocTag tag) {
+    AllocTag previous = (AllocTag)activeTag;
+    activeTag = (uint8_t)tag;
+    return previous;
+}
+
+void AllocTracker::onAlloc(AllocTag tag, bool psram, size_t size) {
+    AllocCounters& c = psram ? psramCounters[(int)tag] : internalCounters[(int)tag];
+    portENTER_CRITICAL(&countersMux);
+    c.liveBytes += (int32_t)size;
+    c.liveCount++;
+    c.totalAllocs++;
+    portEXIT_CRITICAL(&countersMux);
+}
+
+void AllocTracker::onFree(AllocTag tag, bool psram, size_t size) {
+    AllocCounters& c = psram ? psramCounters[(int)tag] : internalCounters[(int)tag];
+    portENTER_CRITICAL(&countersMux);
+    c.liveBytes -= (int32_t)size;
+    c.liveCount--;
+    portEXIT_CRITICAL(&countersMux);
+}
+
+void AllocTracker::onScopeDelta(AllocTag tag, int32_t internalDelta, int32_t psramDelta) {
+    portENTER_CRITICAL(&countersMux);
+    internalCounters[(int)tag].scopeNetBytes += internalDelta;
+    psramCounters[(int)tag].scopeNetBytes += psramDelta;
+    portEXIT_CRITICAL(&countersMux);
+}
+
+void AllocTracker::snapshot(AllocSnapshot& out) {
+    portENTER_CRITICAL(&countersMux);
+    memcpy(out.internal, internalCounters, sizeof(internalCounters));
+    memcpy(out.psram, psramCounters, sizeof(psramCounters));
+    portEXIT_CRITICAL(&countersMux);
+    out.freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    out.freePsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+void AllocTracker::printSnapshot(const AllocSnapshot& snap) {
+    DEBUG_PRINTLN("Tag        | internal: live bytes  count   allocs  scope net | psram: live bytes  count   allocs  scope net");
+    for (int i = 0; i < TAG_COUNT; i++) {
+        const AllocCounters& in = snap.internal[i];
+        const AllocCounters& ps = snap.psram[i];
+        DEBUG_PRINTF("%-10s | %20d %6d %8u %10d | %17d %6d %8u %10d\n", TAG_NAMES[i],
+                     in.liveBytes, in.liveCount, in.totalAllocs, in.scopeNetBytes,
+                     ps.liveBytes, ps.liveCount, ps.totalAllocs, ps.scopeNetBytes);
+    }
+    DEBUG_PRINTF("Free heap: internal %u, PSRAM %u\n", snap.freeInternal, snap.freePsram);
+}
+
+void AllocTracker::printDiff(const AllocSnapshot& before, const AllocSnapshot& after) {
+    bool growth = false;
+    DEBUG_PRINTLN("Allocation growth per tag (new/delete exact, scope net approximate):");
+    for (int i = 0; i < TAG_COUNT; i++) {
+        int32_t inBytes = after.internal[i].liveBytes - before.internal[i].liveBytes;
+        int32_t inCount = after.internal[i].liveCount - before.internal[i].liveCount;
+        int32_t inScope = after.internal[i].scopeNetBytes - before.internal[i].scopeNetBytes;
+        int32_t psBytes = after.psram[i].liveBytes - before.psram[i].liveBytes;
+        int32_t psCount = after.psram[i].liveCount - before.psram[i].liveCount;
+        int32_t psScope = after.psram[i].scopeNetBytes - before.psram[i].scopeNetBytes;
+        if (inBytes || inCount || inScope || psBytes || psCount || psScope) {
+            DEBUG_PRINTF("  %-8s internal %+d bytes / %+d blocks (scope %+d), psram %+d bytes / %+d blocks (scope %+d)\n",
+                         TAG_NAMES[i], inBytes, inCount, inScope, psBytes, psCount, psScope);
+            if (inBytes > 0 || inCount > 0 || psBytes > 0 || psCount > 0) {
+                growth = true;
+            }
+        }
+    }
+    DEBUG_PRINTF("  free heap: internal %+d, PSRAM %+d\n",
+                 (int32_t)after.freeInternal - (int32_t)before.freeInternal,
+                 (int32_t)after.freePsram - (int32_t)before.freePsram);
+    DEBUG_PRINTLN(growth ? "RESULT: live allocations grew" : "RESULT: no growth in tracked allocations");
+}
+
+//##################################################################################################
+// Scope tagging
+
+AllocScope::AllocScope(AllocTag tag) : tag(tag) {
+    previous = AllocTracker::exchangeTag(tag);
+    freeInternalBefore = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    freePsramBefore = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+AllocScope::~AllocScope() {
+    // Heap consumed by this scope (positive = memory still held after the scope).
+    // Allocations by other tasks during the scope are attributed here as well.
+    int32_t internalDelta = (int32_t)freeInternalBefore - (int32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int32_t psramDelta = (int32_t)freePsramBefore - (int32_t)heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    AllocTracker::onScopeDelta(tag, internalDelta, psramDelta);
+    AllocTracker::exchangeTag(previous);
+}
+
+//##################################################################################################
+// Audio play/stop leak check, driven from loop() so the UI keeps running
+
+enum class LeakCheckPhase { IDLE, START, PLAYING };
+
+static const unsigned long LEAK_CHECK_PLAY_MS = 2000;
+
+static LeakCheckPhase leakPhase = LeakCheckPhase::IDLE;
+static int leakCyclesRemaining = 0;
+static int leakCyclesTotal = 0;
+static bool leakBaselineTaken = false;
+static unsigned long leakPhaseTime = 0;
+static AllocSnapshot leakBefore;
+
+static void startLeakCheck(int cycles) {
+    if (g_stations.empty()) {
+        DEBUG_PRINTLN("[ALLOC] Leak check needs at least one station in stations.json");
+        return;
+    }
+    if (cycles <= 0) cycles = 100;
+
+    audioManager.stop();
+    // One extra warm-up cycle so one-time initialization is not reported as growth
+    leakCyclesTotal = cycles;
+    leakCyclesRemaining = cycles + 1;
+    leakBaselineTaken = false;
+    leakPhase = LeakCheckPhase::START;
+    DEBUG_PRINTF("[ALLOC] Leak check: %d play/stop cycles on '%s'\n", cycles, g_stations[0].name.c_str());
+}
+
+void AllocTracker::loop() {
+    unsigned long now = ::millis();
+
+    switch (leakPhase) {
+        case LeakCheckPhase::IDLE:
+            break;
+
+        case LeakCheckPhase::START:
+            audioManager.connecttohost(g_stations[0].url.c_str());
+            leakPhaseTime = now;
+            leakPhase = LeakCheckPhase::PLAYING;
+            break;
+
+        case LeakCheckPhase::PLAYING:
+            if (now - leakPhaseTime < LEAK_CHECK_PLAY_MS) {
+                break;
+            }
+            audioManager.stop();
+            leakCyclesRemaining--;
+
+            if (!leakBaselineTaken) {
+                snapshot(leakBefore);
+                leakBaselineTaken = true;
+            }
+
+            if (leakCyclesRemaining > 0) {
+                leakPhase = LeakCheckPhase::START;
+            } else {
+                AllocSnapshot after;
+                snapshot(after);
+                DEBUG_PRINTF("[ALLOC] Leak check finished after %d cycles\n", leakCyclesTotal);
+                printDiff(leakBefore, after);
+                leakPhase = LeakCheckPhase::IDLE;
+            }
+            break;
+    }
+}
+
+static AllocSnapshot markedSnapshot;
+static bool markedSnapshotValid = false;
+
+static void allocCommand(const char* args) {
+    if (strncmp(args, "leakcheck", 9) == 0) {
+        startLeakCheck(atoi(args + 9));
+    } else if (strcmp(args, "mark") == 0) {
+        AllocTracker::snapshot(markedSnapshot);
+        markedSnapshotValid = true;
+        DEBUG_PRINTLN("[ALLOC] Snapshot stored");
+    } else if (strcmp(args, "diff") == 0) {
+        if (!markedSnapshotValid) {
+            DEBUG_PRINTLN("[ALLOC] No snapshot stored - use 'alloc mark' first");
+            return;
+        }
+        AllocSnapshot now;
+        AllocTracker::snapshot(now);
+        AllocTracker::printDiff(markedSnapshot, now);
+    } else {
+        AllocSnapshot now;
+        AllocTracker::snapshot(now);
+        AllocTracker::printSnapshot(now);
+    }
+}
+
+void AllocTracker::begin() {
+    SerialConsole::getInstance()->registerCommand("alloc", "Heap by subsystem ('alloc mark|diff|leakcheck N')", allocCommand);
+}
+
+//##################################################################################################
+// Global operator new/delete replacements
+
+static void* trackedAlloc(size_t size) {
+    AllocHeader* header = static_cast<AllocHeader*>(malloc(sizeof(AllocHeader) + size));
+    if (!header) {
+        return nullptr;
+    }
+    header->size = (uint32_t)size;
+    header->magic = ALLOC_MAGIC;
+    header->tag = activeTag;
+    header->psram = esp_ptr_external_ram(header) ? 1 : 0;
+    AllocTracker::onAlloc((AllocTag)header->tag, header->psram, size);
+    return header + 1;
+}
+
+static void trackedFree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    AllocHeader* header = static_cast<AllocHeader*>(ptr) - 1;
+    if (header->magic == ALLOC_MAGIC) {
+        header->magic = 0;
+        AllocTracker::onFree((AllocTag)header->tag, header->psram, header->size);
+    }
+    free(header);
+}
+
+static void* trackedAllocOrThrow(size_t size) {
+    void* ptr = trackedAlloc(size);
+    if (!ptr) {
+#if __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+    return ptr;
+}
+
+void* operator new(size_t size) { return trackedAllocOrThrow(size); }
+void* operator new[](size_t size) { return trackedAllocOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+
+#endif // ALLOC_TRACE
@@ -5,6 +5,9 @@
 #include "lvgl.h"
 #include "ui.h"
 #include "debug_config.h"
+#include "AllocTracker.h"
+#include "DeferredLog.h"
+#include "PowerManager.h"
 
 //##################################################################################################
 // Arduino Audio Tools Integration
@@ -24,6 +27,11 @@ AudioManager::AudioManager() {
     lazy_initialized = false;
     pending_start = false;
     pending_url = "";
+    bytes_copied = 0;
+    total_bytes = 0;
+    copy_time_us = 0;
+    last_stats_time = 0;
+    start_time = 0;
 }
 
 AudioManager::~AudioManager() {
@@ -35,16 +43,12 @@ AudioManager::~AudioManager() {
         encoded_stream = nullptr;
     }
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTLN("[AUDIO] AudioManager destroyed and cleaned up");
-#endif
+    LOG_DEBUG(AUDIO, "AudioManager destroyed and cleaned up");
 }
 
 void AudioManager::begin() {
     // Defer heavy initialization until first playback to save memory
-#if AUDIO_DEBUG
-    DEBUG_PRINTLN("[AUDIO] AudioManager ready (lazy initialization)");
-#endif
+    LOG_DEBUG(AUDIO, "AudioManager ready (lazy initialization)");
 }
 
 // Dedicated audio task running on separate core for smooth playbook
@@ -56,16 +60,18 @@ void AudioManager::audioTaskFunction(void* parameter) {
         return;
     }
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTLN("[AUDIO] Audio task started on core " + String(xPortGetCoreID()));
-#endif
+    LOG_DEBUG(AUDIO, "Audio task started on core %d", xPortGetCoreID());
     
     while (audioMgr->task_running) {
         // Check if we have valid resources before processing
         if (audioMgr->playing && audioMgr->copier && audioMgr->encoded_stream) {
             try {
                 // Process audio pipeline - non-blocking
+                uint32_t copy_start = micros();
                 size_t bytes_processed = audioMgr->copier->copy();
+                audioMgr->copy_time_us.fetch_add(micros() - copy_start, std::memory_order_relaxed);
+                audioMgr->bytes_copied.fetch_add(bytes_processed, std::memory_order_relaxed);
+                audioMgr->total_bytes.fetch_add(bytes_processed, std::memory_order_relaxed);
                 
                 if (bytes_processed == 0) {
                     // No data processed, minimal delay to prevent buffer starvation
@@ -83,9 +89,7 @@ void AudioManager::audioTaskFunction(void* parameter) {
                 }
                 
             } catch (...) {
-#if AUDIO_DEBUG
-                DEBUG_PRINTLN("[AUDIO] Exception in audio processing, stopping");
-#endif
+                LOG_ERROR(AUDIO, "Exception in audio processing, stopping");
                 audioMgr->playing = false;
                 break;
             }
@@ -98,9 +102,7 @@ void AudioManager::audioTaskFunction(void* parameter) {
         taskYIELD();
     }
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTLN("[AUDIO] Audio task terminated");
-#endif
+    LOG_DEBUG(AUDIO, "Audio task terminated");
     
     // Clean up task handle before exit
     audioMgr->audio_task_handle = nullptr;
@@ -110,13 +112,14 @@ void AudioManager::audioTaskFunction(void* parameter) {
 void AudioManager::loop() {
     // Handle deferred connection requests from UI callbacks
     if (pending_start && !pending_url.isEmpty()) {
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Processing deferred connection request");
-#endif
+        LOG_DEBUG(AUDIO, "Processing deferred connection request");
         pending_start = false;
         _internal_connecttohost(pending_url.c_str());
         pending_url = "";
     }
+
+    // Full clock and no light sleep while a stream is connecting or playing
+    PowerManager::getInstance()->setActive(PowerSubsystem::AUDIO, playing || pending_start);
     
     // Start audio task if not already running and we have active playback
     if (playing && !task_running && encoded_stream && copier) {
@@ -134,29 +137,29 @@ void AudioManager::loop() {
         );
         
         if (result != pdPASS) {
-#if AUDIO_DEBUG
-            DEBUG_PRINTLN("[AUDIO] ERROR: Failed to create audio task");
-#endif
+            LOG_ERROR(AUDIO, "Failed to create audio task");
             task_running = false;
             audio_task_handle = nullptr;
         }
-#if AUDIO_DEBUG
         else {
-            DEBUG_PRINTLN("[AUDIO] Audio task created successfully");
+            LOG_DEBUG(AUDIO, "Audio task created successfully");
         }
-#endif
     }
     
-    // Update playback info if necessary
+    // Sample stream statistics once per second while playing. They change on
+    // every sample and the UI does not show them, so they are only staged and
+    // go out with the next state or metadata change.
     if (playing && current_host) {
-        // Update playback info to show current playback status
-        strncpy(g_playbackInfo.Album, "", sizeof(g_playbackInfo.Album) - 1);
-        g_playbackInfo.Album[sizeof(g_playbackInfo.Album) - 1] = '\0';
-        strncpy(g_playbackInfo.Title, "Playing...", sizeof(g_playbackInfo.Title) - 1);
-        g_playbackInfo.Title[sizeof(g_playbackInfo.Title) - 1] = '\0';
-        strncpy(g_playbackInfo.Artist, "", sizeof(g_playbackInfo.Artist) - 1);
-        g_playbackInfo.Artist[sizeof(g_playbackInfo.Artist) - 1] = '\0';
-        // AlarmTitle is left blank (only used when radio started from alarm)
+        uint32_t now = millis();
+        uint32_t elapsed = now - last_stats_time;
+        if (elapsed >= 1000) {
+            uint32_t copied = bytes_copied.exchange(0, std::memory_order_relaxed);
+            last_stats_time = now;
+
+            PlaybackSnapshot& info = g_playbackState.edit();
+            info.bitrateKbps = (uint16_t)((copied * 8UL) / elapsed);
+            info.bufferBytes = (uint32_t)url.available();
+        }
     }
 }
 
@@ -165,9 +168,7 @@ bool AudioManager::connecttohost(const char* host) {
     pending_start = true;
     pending_url = String(host);
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTF("[AUDIO] Deferred connection request: %s\n", host);
-#endif
+    LOG_DEBUG(AUDIO, "Deferred connection request: %s", host);
     
     return true;
 }
@@ -175,6 +176,7 @@ bool AudioManager::connecttohost(const char* host) {
 // Internal method for actual connection (called from main loop)
 bool AudioManager::_internal_connecttohost(const char* host) {
     using namespace audio_tools;
+    ALLOC_SCOPE(AllocTag::AUDIO);
     
     // Declare audio parameters at function scope for later I2S configuration
     int detected_sample_rate = 44100;     // Default fallback
@@ -188,23 +190,17 @@ bool AudioManager::_internal_connecttohost(const char* host) {
     
     // Lazy initialization: Only initialize Arduino Audio Tools when needed
     if (!lazy_initialized) {
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Performing lazy initialization of Arduino Audio Tools");
-#endif
+        LOG_DEBUG(AUDIO, "Performing lazy initialization of Arduino Audio Tools");
 
-#if HEAP_DEBUG
-        DEBUG_PRINTF("[HEAP] Before audio init - Free heap: %d, PSRAM: %d\n", 
-                     ESP.getFreeHeap(), ESP.getFreePsram());
-#endif
+        LOG_DEBUG(HEAP, "Before audio init - Free heap: %d, PSRAM: %d",
+                  ESP.getFreeHeap(), ESP.getFreePsram());
         
         // Note: PSRAM allocation will be handled through buffer size reduction and manual allocation
         
         // Ensure any existing I2S is properly cleaned up first
         i2s.end();
         
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Configuring I2S with explicit resource management");
-#endif
+        LOG_DEBUG(AUDIO, "Configuring I2S with explicit resource management");
         
         // Configure I2S output stream with dynamic parameters and PSRAM allocation
         auto i2s_config = i2s.defaultConfig(TX_MODE);
@@ -222,21 +218,15 @@ bool AudioManager::_internal_connecttohost(const char* host) {
         i2s_config.auto_clear = true;
         i2s_config.port_no = 0;
         
-#if AUDIO_DEBUG
-        DEBUG_PRINTF("[AUDIO] Configuring I2S: %d Hz, %d-bit, %d channels\n", 
-                     detected_sample_rate, detected_bits_per_sample, detected_channels);
-#endif
+        LOG_DEBUG(AUDIO, "Configuring I2S: %d Hz, %d-bit, %d channels",
+                  detected_sample_rate, detected_bits_per_sample, detected_channels);
         
         if (!i2s.begin(i2s_config)) {
-#if AUDIO_DEBUG
-            DEBUG_PRINTLN("[AUDIO] ERROR: Failed to initialize I2S stream");
-#endif
+            LOG_ERROR(AUDIO, "Failed to initialize I2S stream");
             return false;
         }
         
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] I2S stream initialized successfully");
-#endif
+        LOG_DEBUG(AUDIO, "I2S stream initialized successfully");
         
         // Setup VolumeStream
         volume_stream.begin();
@@ -247,37 +237,32 @@ bool AudioManager::_internal_connecttohost(const char* host) {
         encoded_stream = new EncodedAudioStream(&volume_stream, &decoder);
         encoded_stream->begin();
         
-#if HEAP_DEBUG
-        DEBUG_PRINTF("[HEAP] After audio init - Free heap: %d, PSRAM: %d\n", 
-                     ESP.getFreeHeap(), ESP.getFreePsram());
-#endif
+        LOG_DEBUG(HEAP, "After audio init - Free heap: %d, PSRAM: %d",
+                  ESP.getFreeHeap(), ESP.getFreePsram());
         
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Lazy initialization completed");
-#endif
+        LOG_DEBUG(AUDIO, "Lazy initialization completed");
     }
     
     current_host = host;
     // Update playback info to show connecting status
-    strncpy(g_playbackInfo.Album, "", sizeof(g_playbackInfo.Album) - 1);
-    g_playbackInfo.Album[sizeof(g_playbackInfo.Album) - 1] = '\0';
-    strncpy(g_playbackInfo.Title, "Connecting...", sizeof(g_playbackInfo.Title) - 1);
-    g_playbackInfo.Title[sizeof(g_playbackInfo.Title) - 1] = '\0';
-    strncpy(g_playbackInfo.Artist, "", sizeof(g_playbackInfo.Artist) - 1);
-    g_playbackInfo.Artist[sizeof(g_playbackInfo.Artist) - 1] = '\0';
+    PlaybackSnapshot& info = g_playbackState.edit();
+    setPlaybackText(info.Album, "");
+    setPlaybackText(info.Title, "Connecting...");
+    setPlaybackText(info.Artist, "");
     // AlarmTitle is left blank (only used when radio started from alarm)
+    info.state = PlaybackStateCode::CONNECTING;
+    info.bitrateKbps = 0;
+    info.bufferBytes = 0;
+    g_playbackState.publish();
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTF("[AUDIO] Connecting to: %s\n", host);
-#endif
+    LOG_DEBUG(AUDIO, "Connecting to: %s", host);
     
     // Configure URLStream for HTTP streaming
     if (!url.begin(host, "audio/mp3")) {
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] ERROR: Failed to connect to URL stream");
-#endif
-        strncpy(g_playbackInfo.Title, "Connection Failed", sizeof(g_playbackInfo.Title) - 1);
-        g_playbackInfo.Title[sizeof(g_playbackInfo.Title) - 1] = '\0';
+        LOG_ERROR(AUDIO, "Failed to connect to URL stream");
+        setPlaybackText(info.Title, "Connection Failed");
+        info.state = PlaybackStateCode::ERROR;
+        g_playbackState.publish();
         return false;
     }
     
@@ -289,79 +274,63 @@ bool AudioManager::_internal_connecttohost(const char* host) {
     
     if (stream_info.sample_rate > 0 && stream_info.sample_rate <= 48000) {
         detected_sample_rate = stream_info.sample_rate;
-#if AUDIO_DEBUG
-        DEBUG_PRINTF("[AUDIO] Detected stream sample rate: %d Hz\n", detected_sample_rate);
-#endif
+        LOG_DEBUG(AUDIO, "Detected stream sample rate: %d Hz", detected_sample_rate);
     } else {
-#if AUDIO_DEBUG
-        DEBUG_PRINTF("[AUDIO] Could not detect sample rate, using default: %d Hz\n", detected_sample_rate);
-#endif
+        LOG_DEBUG(AUDIO, "Could not detect sample rate, using default: %d Hz", detected_sample_rate);
     }
     
     if (stream_info.channels > 0 && stream_info.channels <= 2) {
         detected_channels = stream_info.channels;
-#if AUDIO_DEBUG
-        DEBUG_PRINTF("[AUDIO] Detected stream channels: %d\n", detected_channels);
-#endif
+        LOG_DEBUG(AUDIO, "Detected stream channels: %d", detected_channels);
     } else {
-#if AUDIO_DEBUG
-        DEBUG_PRINTF("[AUDIO] Could not detect channels, using default: %d\n", detected_channels);
-#endif
+        LOG_DEBUG(AUDIO, "Could not detect channels, using default: %d", detected_channels);
     }
     
     if (stream_info.bits_per_sample > 0 && stream_info.bits_per_sample <= 32) {
         detected_bits_per_sample = stream_info.bits_per_sample;
-#if AUDIO_DEBUG
-        DEBUG_PRINTF("[AUDIO] Detected stream bits per sample: %d\n", detected_bits_per_sample);
-#endif
+        LOG_DEBUG(AUDIO, "Detected stream bits per sample: %d", detected_bits_per_sample);
     } else {
-#if AUDIO_DEBUG
-        DEBUG_PRINTF("[AUDIO] Could not detect bits per sample, using default: %d\n", detected_bits_per_sample);
-#endif
+        LOG_DEBUG(AUDIO, "Could not detect bits per sample, using default: %d", detected_bits_per_sample);
     }
     
     // Clean up any existing copier to prevent memory leak
     if (copier) {
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Cleaning up existing StreamCopy");
-#endif
+        LOG_DEBUG(AUDIO, "Cleaning up existing StreamCopy");
         delete copier;
         copier = nullptr;
     }
     
-#if HEAP_DEBUG
-    DEBUG_PRINTF("[HEAP] Before StreamCopy - Free heap: %d, PSRAM: %d\n", 
-                 ESP.getFreeHeap(), ESP.getFreePsram());
-#endif
+    LOG_DEBUG(HEAP, "Before StreamCopy - Free heap: %d, PSRAM: %d",
+              ESP.getFreeHeap(), ESP.getFreePsram());
     
     // Create new StreamCopy to copy from URLStream to EncodedAudioStream
     copier = new StreamCopy(*encoded_stream, url);
     
-#if HEAP_DEBUG
-    DEBUG_PRINTF("[HEAP] After StreamCopy - Free heap: %d, PSRAM: %d\n", 
-                 ESP.getFreeHeap(), ESP.getFreePsram());
-#endif
+    LOG_DEBUG(HEAP, "After StreamCopy - Free heap: %d, PSRAM: %d",
+              ESP.getFreeHeap(), ESP.getFreePsram());
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTLN("[AUDIO] StreamCopy created successfully");
-#endif
+    LOG_DEBUG(AUDIO, "StreamCopy created successfully");
     
     // Start playback - set flag first before creating task
     playing = true;
-    strncpy(g_playbackInfo.Title, "Playing...", sizeof(g_playbackInfo.Title) - 1);
-    g_playbackInfo.Title[sizeof(g_playbackInfo.Title) - 1] = '\0';
+    bytes_copied.store(0, std::memory_order_relaxed);
+    last_stats_time = millis();
+    start_time = last_stats_time;
+    setPlaybackText(info.Title, "Playing...");
+    info.state = PlaybackStateCode::PLAYING;
+    g_playbackState.publish();
     
     // Note: Audio task creation is handled in loop() method via deferred execution pattern
     // This avoids immediate task creation in UI callback context which can cause crashes
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTLN("[AUDIO] Playback started successfully");
-#endif
+    LOG_DEBUG(AUDIO, "Playback started successfully");
     
     return true;
 }
 
 void AudioManager::stop() {
+    ALLOC_SCOPE(AllocTag::AUDIO);
+    
     if (playing) {
         playing = false;
         
@@ -372,9 +341,7 @@ void AudioManager::stop() {
         }
         url.end();
         
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Playback stopped");
-#endif
+        LOG_DEBUG(AUDIO, "Playback stopped");
     }
     
     // Stop audio task
@@ -391,24 +358,18 @@ void AudioManager::stop() {
             
             // Force termination if still running
             if (audio_task_handle) {
-#if AUDIO_DEBUG
-                DEBUG_PRINTLN("[AUDIO] Force terminating audio task");
-#endif
+                LOG_DEBUG(AUDIO, "Force terminating audio task");
                 vTaskDelete(audio_task_handle);
                 audio_task_handle = nullptr;
             }
         }
         
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Audio task stopped");
-#endif
+        LOG_DEBUG(AUDIO, "Audio task stopped");
     }
     
     // Cleanup encoded_stream (critical - prevents freeze on second play)
     if (encoded_stream) {
-#if AUDIO_DEBUG
-        DEBUG_PRINTLN("[AUDIO] Cleaning up encoded_stream");
-#endif
+        LOG_DEBUG(AUDIO, "Cleaning up encoded_stream");
         delete encoded_stream;
         encoded_stream = nullptr;
     }
@@ -417,19 +378,19 @@ void AudioManager::stop() {
     i2s.end();
     volume_stream.end();
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTLN("[AUDIO] All audio resources cleaned up");
-#endif
+    LOG_DEBUG(AUDIO, "All audio resources cleaned up");
     
     current_host = nullptr;
     // Update playback info to show stopped status
-    strncpy(g_playbackInfo.Album, "", sizeof(g_playbackInfo.Album) - 1);
-    g_playbackInfo.Album[sizeof(g_playbackInfo.Album) - 1] = '\0';
-    strncpy(g_playbackInfo.Title, "Stopped", sizeof(g_playbackInfo.Title) - 1);
-    g_playbackInfo.Title[sizeof(g_playbackInfo.Title) - 1] = '\0';
-    strncpy(g_playbackInfo.Artist, "", sizeof(g_playbackInfo.Artist) - 1);
-    g_playbackInfo.Artist[sizeof(g_playbackInfo.Artist) - 1] = '\0';
+    PlaybackSnapshot& info = g_playbackState.edit();
+    setPlaybackText(info.Album, "");
+    setPlaybackText(info.Title, "Stopped");
+    setPlaybackText(info.Artist, "");
     // AlarmTitle is left blank (only used when radio started from alarm)
+    info.state = PlaybackStateCode::STOPPED;
+    info.bitrateKbps = 0;
+    info.bufferBytes = 0;
+    g_playbackState.publish();
 }
 
 void AudioManager::setVolume(uint8_t vol) {
@@ -437,9 +398,7 @@ void AudioManager::setVolume(uint8_t vol) {
     // Update VolumeStream volume
     volume_stream.setVolume((float)volume / 100.0);
     
-#if AUDIO_DEBUG
-    DEBUG_PRINTF("[AUDIO] Volume set to %d%%\n", volume);
-#endif
+    LOG_DEBUG(AUDIO, "Volume set to %d%%", volume);
 }
 
 uint8_t AudioManager::getVolume() {
@@ -449,3 +408,7 @@ uint8_t AudioManager::getVolume() {
 bool AudioManager::isPlaying() {
     return playing && url.available();
 }
+
+bool AudioManager::isStarting() const {
+    return pending_start || (playing && millis() - start_time < AUDIO_START_SETTLE_MS);
+}
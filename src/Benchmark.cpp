@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+#include <lvgl.h>
+#include "AudioManager.h"
+#include "SerialConsole.h"
+#include "debug_config.h"
+
+static void benchCommand(const char* args) {
+    (void)args;
+    Benchmark::run();
+}
+
+void Benchmark::begin() {
+    SerialConsole::getInstance()->registerCommand("bench", "Frame time and audio copy load for this build", benchCommand);
+}
+
+void Benchmark::run() {
+#if RELEASE_BUILD
+    DEBUG_PRINTLN("Build profile: release (-Os, -O2 hot paths)");
+#else
+    DEBUG_PRINTLN("Build profile: debug");
+#endif
+    DEBUG_PRINTF("CPU %u MHz, audio %s\n", ESP.getCpuFreqMHz(), audioManager.isPlaying() ? "playing" : "idle");
+
+    uint32_t minUs = UINT32_MAX;
+    uint32_t maxUs = 0;
+    uint64_t totalUs = 0;
+
+    uint32_t copyStartUs = audioManager.getCopyTimeUs();
+    uint32_t wallStartUs = micros();
+
+    for (int i = 0; i < BENCH_FRAME_COUNT; i++) {
+        lv_obj_invalidate(lv_screen_active());
+        uint32_t start = micros();
+        lv_refr_now(NULL);
+        uint32_t elapsed = micros() - start;
+
+        if (elapsed < minUs) minUs = elapsed;
+        if (elapsed > maxUs) maxUs = elapsed;
+        totalUs += elapsed;
+
+        // Let the audio task and the idle task run between frames
+        delay(1);
+    }
+
+    uint32_t wallUs = micros() - wallStartUs;
+    uint32_t copyUs = audioManager.getCopyTimeUs() - copyStartUs;
+
+    DEBUG_PRINTF("Full-screen frame (render + flush): min %u us, mean %u us, max %u us over %d frames\n",
+                 minUs, (uint32_t)(totalUs / BENCH_FRAME_COUNT), maxUs, BENCH_FRAME_COUNT);
+    DEBUG_PRINTF("Audio copy load: %u.%u%% of one core (%u us in %u us)\n",
+                 (uint32_t)((uint64_t)copyUs * 100 / wallUs),
+                 (uint32_t)((uint64_t)copyUs * 1000 / wallUs % 10), copyUs, wallUs);
+}
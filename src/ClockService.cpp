@@ -0,0 +1,100 @@
+#include "ClockService.h"
+#include "Profiler.h"
+
+// Same validity rule as getLocalTime(): anything before 2016 means "not set"
+#define CLOCK_VALID_YEAR (2016 - 1900)
+
+// Larger steps are treated as a clock change rather than elapsed time
+#define CLOCK_JUMP_S 5
+
+// Initialize static singleton instance to nullptr
+ClockService* ClockService::_instance = nullptr;
+
+ClockService::ClockService() : subscriberCount(0), pendingEvents(0) {
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.epoch = -1;
+}
+
+ClockService* ClockService::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new ClockService();
+    }
+    return _instance;
+}
+
+bool ClockService::subscribe(uint8_t mask, ClockCallback callback, void* context) {
+    if (subscriberCount >= MAX_CLOCK_SUBSCRIBERS || callback == nullptr) {
+        return false;
+    }
+    subscribers[subscriberCount].callback = callback;
+    subscribers[subscriberCount].context = context;
+    subscribers[subscriberCount].mask = mask;
+    subscriberCount++;
+    return true;
+}
+
+uint8_t ClockService::eventsBetween(const ClockSnapshot& previous, const ClockSnapshot& current) {
+    if (!current.valid) {
+        return 0;
+    }
+    if (!previous.valid) {
+        return CLOCK_ALL;
+    }
+    time_t delta = current.epoch - previous.epoch;
+    if (delta < 0 || delta > CLOCK_JUMP_S) {
+        return CLOCK_ALL;
+    }
+    if (delta == 0) {
+        return 0;
+    }
+
+    uint8_t events = CLOCK_SECOND;
+    if (current.local.tm_min != previous.local.tm_min) {
+        events |= CLOCK_MINUTE;
+    }
+    if (current.local.tm_hour != previous.local.tm_hour) {
+        events |= CLOCK_HOUR;
+    }
+    if (current.local.tm_yday != previous.local.tm_yday || current.local.tm_year != previous.local.tm_year) {
+        events |= CLOCK_DAY;
+    }
+    if (current.local.tm_isdst != previous.local.tm_isdst) {
+        events |= CLOCK_DST;
+    }
+    return events;
+}
+
+void ClockService::refresh() {
+    time_t epoch = time(nullptr);
+    if (epoch == snapshot.epoch) {
+        return;
+    }
+
+    ClockSnapshot previous = snapshot;
+    snapshot.epoch = epoch;
+    localtime_r(&epoch, &snapshot.local);
+    snapshot.valid = snapshot.local.tm_year > CLOCK_VALID_YEAR;
+    pendingEvents |= eventsBetween(previous, snapshot);
+}
+
+const ClockSnapshot& ClockService::now() {
+    refresh();
+    return snapshot;
+}
+
+void ClockService::tick() {
+    refresh();
+    if (pendingEvents == 0) {
+        return;
+    }
+
+    PROFILE_ZONE("clock.notify");
+    uint8_t events = pendingEvents;
+    pendingEvents = 0;
+    for (int i = 0; i < subscriberCount; i++) {
+        uint8_t matched = events & subscribers[i].mask;
+        if (matched) {
+            subscribers[i].callback(snapshot, matched | (events & CLOCK_SYNC), subscribers[i].context);
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include "ConfigManager.h"
 #include "debug_config.h"
+#include "Profiler.h"
+#include "AllocTracker.h"
 #include "RadioData.h"
 
 // Initialize static instance pointer
@@ -21,6 +23,9 @@ bool ConfigManager::initConfig() {
 }
 
 bool ConfigManager::loadConfigFromSD() {
+    PROFILE_ZONE("config.load");
+    ALLOC_SCOPE(AllocTag::CONFIG);
+    
     // Check if config file exists
     if (!SD.exists("/config.json")) {
 #if CONFIG_DEBUG
@@ -66,7 +71,7 @@ bool ConfigManager::loadConfigFromSD() {
     }
     
     // Create a temporary document for parsing
-    DynamicJsonDocument tempDoc(4096);
+    PsramJsonDocument tempDoc(4096);
     
     // Deserialize the JSON document
     DeserializationError error = deserializeJson(tempDoc, configFile);
@@ -174,7 +179,7 @@ bool ConfigManager::loadStations() {
         return false;
     }
 
-    DynamicJsonDocument stationsDoc(2048); // Adjust size as needed
+    PsramJsonDocument stationsDoc(2048); // Adjust size as needed
     DeserializationError error = deserializeJson(stationsDoc, stationsFile);
     stationsFile.close();
 
@@ -262,6 +267,42 @@ bool ConfigManager::getWeatherSettings(String& apiKey, float& lat, float& lon, S
     return !apiKey.isEmpty() && lat != 0.0f && lon != 0.0f;
 }
 
+int ConfigManager::getWeatherLocations(WeatherLocationConfig* locations, int maxLocations) {
+    JsonObject weatherConfig = getWeatherConfig();
+    if (weatherConfig.isNull() || maxLocations <= 0) {
+        return 0;
+    }
+    
+    // Home location first
+    int count = 0;
+    locations[count].name = weatherConfig["name"] | "";
+    locations[count].lat = weatherConfig["lat"] | 0.0f;
+    locations[count].lon = weatherConfig["lon"] | 0.0f;
+    if (locations[count].lat == 0.0f || locations[count].lon == 0.0f) {
+        return 0;
+    }
+    count++;
+    
+    for (JsonObject location : weatherConfig["locations"].as<JsonArray>()) {
+        if (count >= maxLocations) {
+#if CONFIG_DEBUG
+            DEBUG_PRINTF("Only %d weather locations are supported, ignoring the rest\n", maxLocations);
+#endif
+            break;
+        }
+        float lat = location["lat"] | 0.0f;
+        float lon = location["lon"] | 0.0f;
+        if (lat == 0.0f || lon == 0.0f) {
+            continue;
+        }
+        locations[count].name = location["name"] | "";
+        locations[count].lat = lat;
+        locations[count].lon = lon;
+        count++;
+    }
+    return count;
+}
+
 bool ConfigManager::saveConfig() {
 #if CONFIG_DEBUG
     DEBUG_PRINTLN("Saving config to SD card...");
@@ -298,7 +339,7 @@ void ConfigManager::setDefaultConfig() {
 #endif
     
     // Create a new empty JSON document to replace any existing config
-    configDoc = DynamicJsonDocument(4096);
+    configDoc = PsramJsonDocument(4096);
     
     // WiFi
     JsonObject wifi = configDoc.createNestedObject("wifi");
@@ -367,13 +408,13 @@ void ConfigManager::setDefaultConfig() {
     configDoc["fallback_audio"] = "/alarm.mp3";
 }
 
-bool ConfigManager::parseConfig(DynamicJsonDocument& doc) {
+bool ConfigManager::parseConfig(JsonDocument& doc) {
 #if CONFIG_DEBUG
     DEBUG_PRINTLN("Parsing configuration with default values...");
 #endif
     
     // Create a new document for our complete config
-    configDoc = DynamicJsonDocument(4096);
+    configDoc = PsramJsonDocument(4096);
     
     // Helper function to check if a key exists in the source
     auto hasValidKey = [](const JsonObject& obj, const char* key) {
@@ -429,6 +470,20 @@ bool ConfigManager::parseConfig(DynamicJsonDocument& doc) {
         weather["units"] = hasValidKey(srcWeather, "units") ? srcWeather["units"].as<String>() : "metric";
         weather["lang"] = hasValidKey(srcWeather, "lang") ? srcWeather["lang"].as<String>() : "de";
         weather["update_interval"] = hasValidKey(srcWeather, "update_interval") ? srcWeather["update_interval"].as<int>() : 30;
+        if (hasValidKey(srcWeather, "name")) {
+            weather["name"] = srcWeather["name"].as<String>();
+        }
+        
+        // Further locations, each with a name and coordinates
+        if (srcWeather["locations"].is<JsonArray>()) {
+            JsonArray locations = weather.createNestedArray("locations");
+            for (JsonObject srcLocation : srcWeather["locations"].as<JsonArray>()) {
+                JsonObject location = locations.createNestedObject();
+                location["name"] = hasValidKey(srcLocation, "name") ? srcLocation["name"].as<String>() : "";
+                location["lat"] = hasValidKey(srcLocation, "lat") ? srcLocation["lat"].as<float>() : 0.0f;
+                location["lon"] = hasValidKey(srcLocation, "lon") ? srcLocation["lon"].as<float>() : 0.0f;
+            }
+        }
     } else {
         weather["appid"] = "";
         weather["lat"] = 0.0f;
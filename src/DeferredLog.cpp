@@ -0,0 +1,338 @@
+#include "DeferredLog.h"
+#include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "SerialConsole.h"
+
+#define LOG_TASK_STACK_SIZE   4096
+#define LOG_TASK_PRIORITY     0       // Idle level: never time-slices with the loop task (priority 1)
+#define LOG_DRAIN_INTERVAL_MS 20
+#define LOG_DRAIN_BATCH       16      // Records per wake, then the task yields again
+#define LOG_SD_FLUSH_MS       1000
+#define LOG_LINE_LENGTH       256
+#define LOG_SD_PATH           "/log.txt"
+
+// Ring slot: the record plus the sequence number of the bounded MPMC queue
+// (Vyukov). A slot is free for producer position p when sequence == p, and
+// holds a committed record for the consumer when sequence == p + 1.
+// The stored value is relative to the slot index so the zero-initialized ring
+// is already valid before any constructor runs.
+struct LogSlot {
+    LogRecord record;
+    uint32_t position;
+    std::atomic<uint32_t> relativeSequence;
+};
+
+static LogSlot ring[LOG_RING_SLOTS];
+static std::atomic<uint32_t> enqueuePosition(0);
+static uint32_t dequeuePosition = 0;           // Only touched by the drain task
+static std::atomic<uint32_t> droppedMessages(0);
+static std::atomic<uint32_t> writtenMessages(0);
+static std::atomic<bool> sdLoggingRequested(false);
+static TaskHandle_t drainTaskHandle = nullptr;
+
+static const char* const MODULE_NAMES[(int)LogModule::COUNT] = {
+    "SYSTEM", "AUDIO", "HEAP", "ALARM", "LVGL", "WEATHER", "SENSOR"
+};
+
+static const char LEVEL_LETTERS[] = {'-', 'E', 'W', 'I', 'D'};
+
+static inline uint32_t loadSequence(const LogSlot& slot) {
+    return slot.relativeSequence.load(std::memory_order_acquire) + (uint32_t)(&slot - ring);
+}
+
+static inline void storeSequence(LogSlot& slot, uint32_t sequence) {
+    slot.relativeSequence.store(sequence - (uint32_t)(&slot - ring), std::memory_order_release);
+}
+
+//##################################################################################################
+// Argument capture
+
+void LogRecordBuilder::addRaw(LogArgType type, const void* data, size_t size) {
+    if (record.argCount >= LOG_MAX_ARGS || record.payloadLength + size > LOG_PAYLOAD_BYTES) {
+        // Out of space - later arguments print as '?'
+        record.payloadLength = LOG_PAYLOAD_BYTES;
+        return;
+    }
+    memcpy(record.payload + record.payloadLength, data, size);
+    record.payloadLength += size;
+    record.argTypes[record.argCount++] = (uint8_t)type;
+}
+
+void LogRecordBuilder::add(const char* v) {
+    if (record.argCount >= LOG_MAX_ARGS || record.payloadLength >= LOG_PAYLOAD_BYTES) {
+        record.payloadLength = LOG_PAYLOAD_BYTES;
+        return;
+    }
+    if (!v) {
+        v = "(null)";
+    }
+
+    // Copy as much of the string as fits; long strings are truncated
+    size_t room = LOG_PAYLOAD_BYTES - record.payloadLength - 1;
+    size_t length = strnlen(v, room < 255 ? room : 255);
+    record.payload[record.payloadLength] = (uint8_t)length;
+    memcpy(record.payload + record.payloadLength + 1, v, length);
+    record.payloadLength += length + 1;
+    record.argTypes[record.argCount++] = (uint8_t)LogArgType::STRING;
+}
+
+//##################################################################################################
+// Lock-free ring
+
+LogRecord* DeferredLog::reserve() {
+    uint32_t position = enqueuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        LogSlot& slot = ring[position & (LOG_RING_SLOTS - 1)];
+        uint32_t sequence = loadSequence(slot);
+        int32_t diff = (int32_t)(sequence - position);
+        if (diff == 0) {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.position = position;
+                return &slot.record;
+            }
+        } else if (diff < 0) {
+            // The drain task is a full lap behind - drop rather than block the caller
+            droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void DeferredLog::commit(LogRecord* record) {
+    LogSlot* slot = reinterpret_cast<LogSlot*>(record);
+    storeSequence(*slot, slot->position + 1);
+}
+
+static LogSlot* peekRecord() {
+    LogSlot& slot = ring[dequeuePosition & (LOG_RING_SLOTS - 1)];
+    uint32_t sequence = loadSequence(slot);
+    return (sequence == dequeuePosition + 1) ? &slot : nullptr;
+}
+
+static void releaseRecord(LogSlot* slot) {
+    storeSequence(*slot, dequeuePosition + LOG_RING_SLOTS);
+    dequeuePosition++;
+}
+
+//##################################################################################################
+// Formatting (drain task only)
+
+// Formats one conversion. 'spec' holds flags/width/precision without length
+// modifiers; the stored argument type decides how it is passed to snprintf.
+static int formatArg(char* out, size_t size, const char* spec, char conversion,
+                     LogArgType type, const uint8_t* data) {
+    char fmt[24];
+    switch (type) {
+        case LogArgType::I32:
+        case LogArgType::U32: {
+            uint32_t v;
+            memcpy(&v, data, sizeof(v));
+            if (!strchr("diouxXc", conversion)) conversion = (type == LogArgType::I32) ? 'd' : 'u';
+            snprintf(fmt, sizeof(fmt), "%%%s%c", spec, conversion);
+            return snprintf(out, size, fmt, v);
+        }
+        case LogArgType::I64:
+        case LogArgType::U64: {
+            uint64_t v;
+            memcpy(&v, data, sizeof(v));
+            if (!strchr("diouxX", conversion)) conversion = (type == LogArgType::I64) ? 'd' : 'u';
+            snprintf(fmt, sizeof(fmt), "%%%sll%c", spec, conversion);
+            return snprintf(out, size, fmt, v);
+        }
+        case LogArgType::DOUBLE: {
+            double v;
+            memcpy(&v, data, sizeof(v));
+            if (!strchr("fFeEgGaA", conversion)) conversion = 'f';
+            snprintf(fmt, sizeof(fmt), "%%%s%c", spec, conversion);
+            return snprintf(out, size, fmt, v);
+        }
+        case LogArgType::POINTER: {
+            const void* v;
+            memcpy(&v, data, sizeof(v));
+            snprintf(fmt, sizeof(fmt), "%%%sp", spec);
+            return snprintf(out, size, fmt, v);
+        }
+        case LogArgType::STRING: {
+            char text[LOG_PAYLOAD_BYTES];
+            uint8_t length = data[0];
+            memcpy(text, data + 1, length);
+            text[length] = '\0';
+            snprintf(fmt, sizeof(fmt), "%%%ss", spec);
+            return snprintf(out, size, fmt, text);
+        }
+    }
+    return 0;
+}
+
+static size_t argSize(LogArgType type, const uint8_t* data) {
+    switch (type) {
+        case LogArgType::I32:
+        case LogArgType::U32:     return 4;
+        case LogArgType::I64:
+        case LogArgType::U64:
+        case LogArgType::DOUBLE:  return 8;
+        case LogArgType::POINTER: return sizeof(void*);
+        case LogArgType::STRING:  return 1 + data[0];
+    }
+    return 0;
+}
+
+static size_t formatRecord(const LogRecord& record, char* out, size_t size) {
+    uint32_t ms = record.timestampMs;
+    int written = snprintf(out, size, "[%6u.%03u] %c %-7s ", ms / 1000, ms % 1000,
+                           LEVEL_LETTERS[record.level < sizeof(LEVEL_LETTERS) ? record.level : 0],
+                           record.module < (uint8_t)LogModule::COUNT ? MODULE_NAMES[record.module] : "?");
+    size_t length = (written > 0) ? (size_t)written : 0;
+
+    const char* p = record.format;
+    uint8_t argIndex = 0;
+    size_t payloadOffset = 0;
+
+    // Reserve room for the newline and terminator
+    while (*p && length < size - 2) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            out[length++] = *p++;
+            continue;
+        }
+
+        // Collect flags, width and precision; skip length modifiers
+        char spec[16];
+        size_t specLength = 0;
+        while (*p && strchr("-+ #0123456789.", *p)) {
+            if (specLength < sizeof(spec) - 1) spec[specLength++] = *p;
+            p++;
+        }
+        spec[specLength] = '\0';
+        while (*p && strchr("hlLqjzt", *p)) p++;
+        if (!*p) break;
+        char conversion = *p++;
+
+        int n;
+        if (argIndex < record.argCount) {
+            LogArgType type = (LogArgType)record.argTypes[argIndex++];
+            const uint8_t* data = record.payload + payloadOffset;
+            n = formatArg(out + length, size - 1 - length, spec, conversion, type, data);
+            payloadOffset += argSize(type, data);
+        } else {
+            n = snprintf(out + length, size - 1 - length, "?");
+        }
+        if (n > 0) {
+            length += (size_t)n;
+            if (length > size - 2) length = size - 2;
+        }
+    }
+
+    // Messages that already end in a newline (e.g. LVGL's) are not doubled
+    if (length == 0 || out[length - 1] != '\n') {
+        out[length++] = '\n';
+    }
+    out[length] = '\0';
+    return length;
+}
+
+//##################################################################################################
+// Drain task
+
+static void writeLine(const char* line, size_t length, File& sdFile) {
+    Serial.write((const uint8_t*)line, length);
+    Serial0.write((const uint8_t*)line, length);
+    if (sdFile) {
+        sdFile.write((const uint8_t*)line, length);
+    }
+}
+
+static void drainTask(void* parameter) {
+    (void)parameter;
+    char line[LOG_LINE_LENGTH];
+    File sdFile;
+    uint32_t reportedDrops = 0;
+    unsigned long lastFlush = 0;
+
+    for (;;) {
+        // SD file is opened/closed here so only this task touches it
+        bool wantSD = sdLoggingRequested.load(std::memory_order_relaxed);
+        if (wantSD && !sdFile) {
+            sdFile = SD.open(LOG_SD_PATH, FILE_APPEND);
+            if (!sdFile) {
+                sdLoggingRequested.store(false);
+                Serial.println("[LOG] Could not open " LOG_SD_PATH);
+            }
+        } else if (!wantSD && sdFile) {
+            sdFile.close();
+        }
+
+        LogSlot* slot;
+        int drained = 0;
+        while (drained < LOG_DRAIN_BATCH && (slot = peekRecord()) != nullptr) {
+            size_t length = formatRecord(slot->record, line, sizeof(line));
+            releaseRecord(slot);
+            writeLine(line, length, sdFile);
+            writtenMessages.fetch_add(1, std::memory_order_relaxed);
+            drained++;
+        }
+
+        uint32_t drops = droppedMessages.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            int length = snprintf(line, sizeof(line), "[LOG] %u messages dropped (ring full)\n", drops - reportedDrops);
+            writeLine(line, length, sdFile);
+            reportedDrops = drops;
+        }
+
+        if (sdFile && millis() - lastFlush >= LOG_SD_FLUSH_MS) {
+            sdFile.flush();
+            lastFlush = millis();
+        }
+
+        // A full batch leaves more behind: come back on the next tick
+        vTaskDelay(drained < LOG_DRAIN_BATCH ? pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS) : 1);
+    }
+}
+
+//##################################################################################################
+// Public interface
+
+static void logCommand(const char* args) {
+    if (strcmp(args, "sd on") == 0) {
+        DeferredLog::setSDLogging(true);
+        DEBUG_PRINTLN("[LOG] Appending to " LOG_SD_PATH);
+    } else if (strcmp(args, "sd off") == 0) {
+        DeferredLog::setSDLogging(false);
+        DEBUG_PRINTLN("[LOG] SD logging off");
+    } else {
+        DeferredLog::printStats();
+    }
+}
+
+void DeferredLog::begin() {
+    if (drainTaskHandle) {
+        return;
+    }
+    xTaskCreate(drainTask, "LogTask", LOG_TASK_STACK_SIZE, nullptr, LOG_TASK_PRIORITY, &drainTaskHandle);
+    SerialConsole::getInstance()->registerCommand("log", "Deferred log stats ('log sd on|off')", logCommand);
+}
+
+void DeferredLog::setSDLogging(bool enabled) {
+    sdLoggingRequested.store(enabled, std::memory_order_relaxed);
+}
+
+uint32_t DeferredLog::droppedCount() {
+    return droppedMessages.load(std::memory_order_relaxed);
+}
+
+void DeferredLog::printStats() {
+    uint32_t queued = enqueuePosition.load(std::memory_order_relaxed) - dequeuePosition;
+    DEBUG_PRINTF("Log: %u written, %u dropped, %u/%u queued, SD %s\n",
+                 writtenMessages.load(std::memory_order_relaxed), droppedCount(),
+                 queued, LOG_RING_SLOTS, sdLoggingRequested.load() ? "on" : "off");
+    DEBUG_PRINTF("Levels: SYSTEM %d AUDIO %d HEAP %d ALARM %d LVGL %d WEATHER %d SENSOR %d\n",
+                 LOG_LEVEL_SYSTEM, LOG_LEVEL_AUDIO, LOG_LEVEL_HEAP, LOG_LEVEL_ALARM,
+                 LOG_LEVEL_LVGL, LOG_LEVEL_WEATHER, LOG_LEVEL_SENSOR);
+}
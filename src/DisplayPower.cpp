@@ -0,0 +1,69 @@
+#include "DisplayPower.h"
+#include <lvgl.h>
+#include "PowerManager.h"
+#include "StandbyManager.h"
+#include "DeferredLog.h"
+
+// Initialize static singleton instance to nullptr
+DisplayPower* DisplayPower::_instance = nullptr;
+
+DisplayPower::DisplayPower() : backlight(nullptr), blanked(false) {
+}
+
+DisplayPower* DisplayPower::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new DisplayPower();
+    }
+    return _instance;
+}
+
+static void displayClockCallback(const ClockSnapshot& snapshot, uint8_t events, void* context) {
+    (void)events;
+    static_cast<DisplayPower*>(context)->onMinute(snapshot);
+}
+
+void DisplayPower::begin(BacklightFn backlightFn) {
+    backlight = backlightFn;
+    blanked = false;
+    PowerManager::getInstance()->setActive(PowerSubsystem::DISPLAY, true);
+    ClockService::getInstance()->subscribe(CLOCK_MINUTE, displayClockCallback, this);
+}
+
+void DisplayPower::blank() {
+    if (blanked) {
+        return;
+    }
+    blanked = true;
+    if (backlight) {
+        backlight(false);
+    }
+    PowerManager::getInstance()->setActive(PowerSubsystem::DISPLAY, false);
+    LOG_INFO(SYSTEM, "Display blanked");
+}
+
+void DisplayPower::wake() {
+    if (!blanked) {
+        return;
+    }
+    blanked = false;
+    // Lock first: the panel must be refreshed steadily before it is lit again
+    PowerManager::getInstance()->setActive(PowerSubsystem::DISPLAY, true);
+    if (backlight) {
+        backlight(true);
+    }
+    LOG_INFO(SYSTEM, "Display on");
+}
+
+void DisplayPower::onMinute(const ClockSnapshot& clock) {
+#if DISPLAY_BLANK_TIMEOUT_MS > 0
+    bool night = clock.valid &&
+                 (clock.local.tm_hour >= STANDBY_NIGHT_START_HOUR || clock.local.tm_hour < STANDBY_NIGHT_END_HOUR);
+    if (!night) {
+        wake();
+    } else if (lv_display_get_inactive_time(NULL) >= DISPLAY_BLANK_TIMEOUT_MS) {
+        blank();
+    }
+#else
+    (void)clock;
+#endif
+}
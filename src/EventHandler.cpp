@@ -2,6 +2,7 @@
 #include "EventHandler.h"
 #include "actions.h" // For objects struct
 #include "debug_config.h"
+#include "ClockService.h"
 #include <Arduino.h>
 #include <screens.h> // For objects struct
 
@@ -298,11 +299,10 @@ void calendar_date_selection_event_handler(lv_event_t *e) {
 static void parse_date_string_to_calendar(const char* date_str, lv_calendar_date_t* date) {
     if (!date_str || strlen(date_str) == 0) {
         // No date set, use today's date
-        time_t now = time(nullptr);
-        struct tm* timeinfo = localtime(&now);
-        date->year = timeinfo->tm_year + 1900;
-        date->month = timeinfo->tm_mon + 1;
-        date->day = timeinfo->tm_mday;
+        const struct tm& today = ClockService::getInstance()->now().local;
+        date->year = today.tm_year + 1900;
+        date->month = today.tm_mon + 1;
+        date->day = today.tm_mday;
     } else {
         // Parse existing date (assuming format: YYYY-MM-DD or DD.MM.YYYY or similar)
         int day, month, year;
@@ -318,11 +318,10 @@ static void parse_date_string_to_calendar(const char* date_str, lv_calendar_date
             date->year = year;
         } else {
             // Fallback to today's date if parsing fails
-            time_t now = time(nullptr);
-            struct tm* timeinfo = localtime(&now);
-            date->year = timeinfo->tm_year + 1900;
-            date->month = timeinfo->tm_mon + 1;
-            date->day = timeinfo->tm_mday;
+            const struct tm& today = ClockService::getInstance()->now().local;
+            date->year = today.tm_year + 1900;
+            date->month = today.tm_mon + 1;
+            date->day = today.tm_mday;
         }
     }
 }
@@ -359,12 +358,11 @@ void show_calendar_button_event_handler(lv_event_t *e) {
         lv_calendar_set_showed_date(objects.calendar_selector, date_to_show.year, date_to_show.month);
         
         // Set today's date (required by LVGL calendar)
-        time_t now = time(nullptr);
-        struct tm* timeinfo = localtime(&now);
+        const struct tm& today = ClockService::getInstance()->now().local;
         lv_calendar_set_today_date(objects.calendar_selector, 
-                                   timeinfo->tm_year + 1900, 
-                                   timeinfo->tm_mon + 1, 
-                                   timeinfo->tm_mday);
+                                   today.tm_year + 1900, 
+                                   today.tm_mon + 1, 
+                                   today.tm_mday);
         
         // Highlight the current alarm date (or today if no date set)
         lv_calendar_set_highlighted_dates(objects.calendar_selector, &date_to_show, 1);
@@ -445,6 +443,7 @@ void calendar_cancel_button_event_handler(lv_event_t *e) {
 #include "AudioManager.h"
 #include "ConfigManager.h"
 #include "RadioData.h"
+#include "StandbyManager.h"
 
 // External reference to global AudioManager instance
 extern AudioManager audioManager;
@@ -494,17 +493,16 @@ void radio_play_button_handler(lv_event_t *e) {
 #if AUDIO_DEBUG
                     DEBUG_PRINTF("[RADIO] Starting playback: %s\n", stationName.c_str());
 #endif
-                    // Update PlaybackInfo struct for UI databinding
-                    strncpy(g_playbackInfo.Title, stationName.c_str(), sizeof(g_playbackInfo.Title) - 1);
-                    g_playbackInfo.Title[sizeof(g_playbackInfo.Title) - 1] = '\0';
-                    strncpy(g_playbackInfo.Album, "Web Radio", sizeof(g_playbackInfo.Album) - 1);
-                    g_playbackInfo.Album[sizeof(g_playbackInfo.Album) - 1] = '\0';
-                    strncpy(g_playbackInfo.Artist, "", sizeof(g_playbackInfo.Artist) - 1);
-                    g_playbackInfo.Artist[sizeof(g_playbackInfo.Artist) - 1] = '\0';
-                    strncpy(g_playbackInfo.AlarmTitle, "", sizeof(g_playbackInfo.AlarmTitle) - 1); // Keep blank unless started from alarm
-                    g_playbackInfo.AlarmTitle[sizeof(g_playbackInfo.AlarmTitle) - 1] = '\0';
+                    // Publish playback info for UI databinding
+                    PlaybackSnapshot& info = g_playbackState.edit();
+                    setPlaybackText(info.Title, stationName.c_str());
+                    setPlaybackText(info.Album, "Web Radio");
+                    setPlaybackText(info.Artist, "");
+                    setPlaybackText(info.AlarmTitle, ""); // Keep blank unless started from alarm
+                    g_playbackState.publish();
                     
-                    // Start audio playback
+                    // Start audio playback; also the station played when waking for an alarm
+                    StandbyManager::getInstance()->setLastStation(stationName.c_str(), stationUrl.c_str());
                     audioManager.connecttohost(stationUrl.c_str());
             } else {
 #if AUDIO_DEBUG
@@ -533,15 +531,13 @@ void radio_stop_button_handler(lv_event_t *e) {
         // Stop audio playback
         audioManager.stop();
         
-        // Clear PlaybackInfo struct
-        strncpy(g_playbackInfo.Title, "", sizeof(g_playbackInfo.Title) - 1);
-        g_playbackInfo.Title[sizeof(g_playbackInfo.Title) - 1] = '\0';
-        strncpy(g_playbackInfo.Album, "", sizeof(g_playbackInfo.Album) - 1);
-        g_playbackInfo.Album[sizeof(g_playbackInfo.Album) - 1] = '\0';
-        strncpy(g_playbackInfo.Artist, "", sizeof(g_playbackInfo.Artist) - 1);
-        g_playbackInfo.Artist[sizeof(g_playbackInfo.Artist) - 1] = '\0';
-        strncpy(g_playbackInfo.AlarmTitle, "", sizeof(g_playbackInfo.AlarmTitle) - 1);
-        g_playbackInfo.AlarmTitle[sizeof(g_playbackInfo.AlarmTitle) - 1] = '\0';
+        // Clear published playback info
+        PlaybackSnapshot& info = g_playbackState.edit();
+        setPlaybackText(info.Title, "");
+        setPlaybackText(info.Album, "");
+        setPlaybackText(info.Artist, "");
+        setPlaybackText(info.AlarmTitle, "");
+        g_playbackState.publish();
     }
 }
 
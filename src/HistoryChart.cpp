@@ -0,0 +1,516 @@
+#include "HistoryChart.h"
+#include <screens.h>  // Include for the objects struct from EEZ Studio UI
+#include "PsramAllocator.h"
+#include "DeferredLog.h"
+#include "Profiler.h"
+
+#define CHART_QUERY_CHUNK   64      // Records per SensorHistory::query() call
+#define CHART_BAR_HEIGHT    46
+#define CHART_TITLE_Y       52
+#define CHART_CANVAS_Y      80
+
+#define CHART_BG_COLOR      0x000000
+#define CHART_GRID_COLOR    0x303030
+#define CHART_TEXT_COLOR    0xA0A0A0
+#define CHART_AVG_COLOR     0xFFFFFF
+
+struct ChannelInfo {
+    const char* name;
+    const char* unit;
+    uint32_t color;
+    int32_t gridStep;       // Smallest grid step in stored units
+    bool centi;             // Stored in hundredths
+};
+
+static const ChannelInfo CHANNELS[] = {
+    {"Temperatur",  "\xC2\xB0" "C", 0xFF9A00, 100, true},   // 1 degree
+    {"Luftfeuchte", "%",            0x00AFFF, 500, true},   // 5 %
+    {"TVOC",        "ppb",          0x00FF00, 50,  false},
+    {"eCO2",        "ppm",          0xFFD700, 100, false},
+};
+
+struct RangeInfo {
+    const char* name;
+    uint32_t span;          // Seconds shown
+    HistoryTier tier;
+    const char* tickFormat; // strftime format of the time axis labels
+};
+
+static const RangeInfo RANGES[] = {
+    {"24 h",   86400UL,     HistoryTier::MINUTE,  "%H:%M"},
+    {"7 Tage", 604800UL,    HistoryTier::QUARTER, "%d.%m. %H:%M"},
+    {"1 Jahr", 31536000UL,  HistoryTier::HOUR,    "%d.%m."},
+};
+
+// Initialize static singleton instance to nullptr
+HistoryChart* HistoryChart::_instance = nullptr;
+
+static void formatValue(HistoryChannel channel, int32_t value, char* buf, size_t size) {
+    const ChannelInfo& info = CHANNELS[(int)channel];
+    if (info.centi) {
+        // One decimal is enough on screen
+        int32_t tenths = (value >= 0 ? value + 5 : value - 5) / 10;
+        snprintf(buf, size, "%s%ld.%ld", tenths < 0 ? "-" : "", labs(tenths) / 10, labs(tenths) % 10);
+    } else {
+        snprintf(buf, size, "%ld", (long)value);
+    }
+}
+
+HistoryChart::HistoryChart()
+    : screen(nullptr), previousScreen(nullptr), canvas(nullptr), titleLabel(nullptr),
+      pixels(nullptr), columns(nullptr), records(nullptr),
+      channel(HistoryChannel::TEMPERATURE), range(ChartRange::DAY), windowStart(0), windowEnd(0),
+      scaleMin(0), scaleMax(1), lastColumn(0), fullRedraws(0), columnRedraws(0) {
+    memset(channelButtons, 0, sizeof(channelButtons));
+    memset(rangeButtons, 0, sizeof(rangeButtons));
+    memset(valueLabels, 0, sizeof(valueLabels));
+}
+
+HistoryChart* HistoryChart::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new HistoryChart();
+    }
+    return _instance;
+}
+
+void HistoryChart::begin() {
+    lv_obj_t* targets[] = {
+        objects.temp_value_container, objects.hum_value_container,
+        objects.tvoc_value_container, objects.co2_value_container
+    };
+    const HistoryChannel channels[] = {
+        HistoryChannel::TEMPERATURE, HistoryChannel::HUMIDITY,
+        HistoryChannel::TVOC, HistoryChannel::ECO2
+    };
+    for (int i = 0; i < 4; i++) {
+        if (targets[i]) {
+            lv_obj_add_flag(targets[i], LV_OBJ_FLAG_CLICKABLE);
+            lv_obj_add_event_cb(targets[i], openEvent, LV_EVENT_CLICKED, (void*)(intptr_t)channels[i]);
+        }
+    }
+    ClockService::getInstance()->subscribe(CLOCK_MINUTE, clockCallback, this);
+}
+
+//##################################################################################################
+// Screen
+
+void HistoryChart::openEvent(lv_event_t* e) {
+    HistoryChannel channel = (HistoryChannel)(intptr_t)lv_event_get_user_data(e);
+    HistoryChart::getInstance()->open(channel);
+}
+
+void HistoryChart::backEvent(lv_event_t* e) {
+    (void)e;
+    HistoryChart::getInstance()->close();
+}
+
+void HistoryChart::channelEvent(lv_event_t* e) {
+    HistoryChart::getInstance()->selectChannel((HistoryChannel)(intptr_t)lv_event_get_user_data(e));
+}
+
+void HistoryChart::rangeEvent(lv_event_t* e) {
+    HistoryChart::getInstance()->selectRange((ChartRange)(intptr_t)lv_event_get_user_data(e));
+}
+
+void HistoryChart::open(HistoryChannel newChannel) {
+    if (screen == nullptr) {
+        createScreen();
+        if (screen == nullptr) {
+            return;
+        }
+    }
+    channel = newChannel;
+    previousScreen = lv_screen_active();
+    lv_screen_load(screen);
+    selectChannel(newChannel);
+}
+
+void HistoryChart::close() {
+    if (screen == nullptr) {
+        return;
+    }
+    LOG_DEBUG(LVGL, "Chart closed: %u full redraws, %u column updates", fullRedraws, columnRedraws);
+    if (previousScreen) {
+        lv_screen_load(previousScreen);
+    }
+    // The canvas is off screen now, so its buffers can go before the objects do
+    lv_obj_delete_async(screen);
+    releaseBuffers();
+    screen = nullptr;
+    canvas = nullptr;
+}
+
+void HistoryChart::createScreen() {
+    size_t stride = lv_draw_buf_width_to_stride(CHART_WIDTH, LV_COLOR_FORMAT_RGB565);
+    size_t bytes = stride * CHART_HEIGHT;
+    pixels = static_cast<uint16_t*>(Psram::allocate(bytes));
+    columns = static_cast<Column*>(Psram::allocate(CHART_WIDTH * sizeof(Column)));
+    records = static_cast<HistoryRecord*>(Psram::allocate(CHART_QUERY_CHUNK * sizeof(HistoryRecord)));
+    if (!pixels || !columns || !records) {
+        LOG_ERROR(LVGL, "Chart: not enough memory for %u byte canvas", (unsigned)bytes);
+        releaseBuffers();
+        return;
+    }
+
+    screen = lv_obj_create(NULL);
+    lv_obj_set_style_bg_color(screen, lv_color_hex(CHART_BG_COLOR), 0);
+    lv_obj_remove_flag(screen, LV_OBJ_FLAG_SCROLLABLE);
+
+    lv_obj_t* bar = lv_obj_create(screen);
+    lv_obj_set_size(bar, CHART_WIDTH, CHART_BAR_HEIGHT);
+    lv_obj_set_pos(bar, 0, 0);
+    lv_obj_set_style_bg_opa(bar, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_border_width(bar, 0, 0);
+    lv_obj_set_style_pad_all(bar, 3, 0);
+    lv_obj_set_style_pad_column(bar, 6, 0);
+    lv_obj_set_flex_flow(bar, LV_FLEX_FLOW_ROW);
+    lv_obj_remove_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
+
+    auto addButton = [bar](const char* text, int32_t width, lv_event_cb_t cb, intptr_t data) {
+        lv_obj_t* button = lv_button_create(bar);
+        lv_obj_set_size(button, width, CHART_BAR_HEIGHT - 6);
+        lv_obj_set_style_bg_color(button, lv_color_hex(0x303030), 0);
+        lv_obj_set_style_bg_color(button, lv_palette_main(LV_PALETTE_BLUE), LV_STATE_CHECKED);
+        lv_obj_add_event_cb(button, cb, LV_EVENT_CLICKED, (void*)data);
+        lv_obj_t* label = lv_label_create(button);
+        lv_label_set_text(label, text);
+        lv_obj_set_style_text_font(label, &lv_font_montserrat_16, 0);
+        lv_obj_center(label);
+        return button;
+    };
+
+    addButton(LV_SYMBOL_LEFT, 60, backEvent, 0);
+    for (int c = 0; c < (int)HistoryChannel::COUNT; c++) {
+        channelButtons[c] = addButton(CHANNELS[c].name, 110, channelEvent, c);
+    }
+    for (int r = 0; r < (int)ChartRange::COUNT; r++) {
+        rangeButtons[r] = addButton(RANGES[r].name, 80, rangeEvent, r);
+    }
+
+    titleLabel = lv_label_create(screen);
+    lv_obj_set_style_text_font(titleLabel, &lv_font_montserrat_16, 0);
+    lv_obj_set_style_text_color(titleLabel, lv_color_hex(0xFFFFFF), 0);
+    lv_obj_set_pos(titleLabel, 8, CHART_TITLE_Y);
+
+    canvas = lv_canvas_create(screen);
+    lv_canvas_set_buffer(canvas, pixels, CHART_WIDTH, CHART_HEIGHT, LV_COLOR_FORMAT_RGB565);
+    lv_obj_set_pos(canvas, 0, CHART_CANVAS_Y);
+
+    // Value axis labels sit on top of the canvas, so restoring a column never has to
+    // know what was under them
+    for (int i = 0; i <= CHART_Y_DIVISIONS; i++) {
+        valueLabels[i] = lv_label_create(screen);
+        lv_obj_set_style_text_font(valueLabels[i], &lv_font_montserrat_12, 0);
+        lv_obj_set_style_text_color(valueLabels[i], lv_color_hex(CHART_TEXT_COLOR), 0);
+    }
+
+    fullRedraws = 0;
+    columnRedraws = 0;
+}
+
+void HistoryChart::releaseBuffers() {
+    Psram::deallocate(pixels);
+    Psram::deallocate(columns);
+    Psram::deallocate(records);
+    pixels = nullptr;
+    columns = nullptr;
+    records = nullptr;
+}
+
+void HistoryChart::selectChannel(HistoryChannel newChannel) {
+    channel = newChannel;
+    for (int c = 0; c < (int)HistoryChannel::COUNT; c++) {
+        if (c == (int)channel) {
+            lv_obj_add_state(channelButtons[c], LV_STATE_CHECKED);
+        } else {
+            lv_obj_remove_state(channelButtons[c], LV_STATE_CHECKED);
+        }
+    }
+    selectRange(range);
+}
+
+void HistoryChart::selectRange(ChartRange newRange) {
+    range = newRange;
+    for (int r = 0; r < (int)ChartRange::COUNT; r++) {
+        if (r == (int)range) {
+            lv_obj_add_state(rangeButtons[r], LV_STATE_CHECKED);
+        } else {
+            lv_obj_remove_state(rangeButtons[r], LV_STATE_CHECKED);
+        }
+    }
+    rebuild();
+}
+
+//##################################################################################################
+// Decimation
+
+int HistoryChart::timeToColumn(time_t t) const {
+    int64_t offset = (int64_t)(t - windowStart) * CHART_WIDTH / (int64_t)RANGES[(int)range].span;
+    return (int)constrain(offset, (int64_t)-1, (int64_t)CHART_WIDTH);
+}
+
+// First second of a column (the smallest t with timeToColumn(t) == column)
+static time_t columnStart(time_t windowStart, uint32_t span, int column) {
+    return windowStart + (time_t)(((int64_t)column * span + CHART_WIDTH - 1) / CHART_WIDTH);
+}
+
+void HistoryChart::collect(int firstColumn, int lastColumn) {
+    for (int c = firstColumn; c <= lastColumn; c++) {
+        columns[c].samples = 0;
+        columns[c].sum = 0;
+    }
+
+    const RangeInfo& info = RANGES[(int)range];
+    uint32_t resolution = SensorHistory::getResolution(info.tier);
+    uint8_t bit = 1 << (int)channel;
+    SensorHistory* history = SensorHistory::getInstance();
+
+    // Buckets longer than a column start before it but still cover it
+    time_t from = columnStart(windowStart, info.span, firstColumn) - (resolution - 1);
+    time_t to = columnStart(windowStart, info.span, lastColumn + 1) - 1;
+
+    while (from <= to) {
+        size_t count = history->query(info.tier, from, to, records, CHART_QUERY_CHUNK);
+        for (size_t i = 0; i < count; i++) {
+            const HistoryRecord& record = records[i];
+            if (!(record.channelMask & bit)) {
+                continue;
+            }
+            const HistoryStat& stat = record.stats[(int)channel];
+            time_t start = (time_t)record.bucket * resolution;
+            int first = max(timeToColumn(start), firstColumn);
+            int last = min(timeToColumn(start + resolution - 1), lastColumn);
+            for (int c = first; c <= last; c++) {
+                Column& column = columns[c];
+                if (column.samples == 0) {
+                    column.min = stat.min;
+                    column.max = stat.max;
+                } else {
+                    column.min = min(column.min, stat.min);
+                    column.max = max(column.max, stat.max);
+                }
+                column.sum += (int32_t)stat.avg * record.samples;
+                column.samples += record.samples;
+            }
+        }
+        if (count < CHART_QUERY_CHUNK) {
+            break;
+        }
+        from = (time_t)(records[count - 1].bucket + 1) * resolution;
+    }
+}
+
+//##################################################################################################
+// Rendering
+
+bool HistoryChart::chooseScale() {
+    int32_t low = INT32_MAX;
+    int32_t high = INT32_MIN;
+    for (int c = 0; c < CHART_WIDTH; c++) {
+        if (columns[c].samples > 0) {
+            low = min(low, (int32_t)columns[c].min);
+            high = max(high, (int32_t)columns[c].max);
+        }
+    }
+    int32_t step = CHANNELS[(int)channel].gridStep;
+    if (low > high) {
+        low = 0;
+        high = step * CHART_Y_DIVISIONS;
+    }
+
+    // Round outwards so every grid line falls on a multiple of the channel step
+    int32_t newMin = (low >= 0 ? low / step : (low - step + 1) / step) * step;
+    int32_t division = step * CHART_Y_DIVISIONS;
+    int32_t span = ((high - newMin) / division + 1) * division;
+    int32_t newMax = newMin + span;
+
+    bool changed = newMin != scaleMin || newMax != scaleMax;
+    scaleMin = newMin;
+    scaleMax = newMax;
+    return changed;
+}
+
+int HistoryChart::valueToRow(int32_t value) const {
+    int32_t row = (CHART_PLOT_HEIGHT - 1) -
+                  (int32_t)((int64_t)(value - scaleMin) * (CHART_PLOT_HEIGHT - 1) / (scaleMax - scaleMin));
+    return constrain(row, (int32_t)0, (int32_t)(CHART_PLOT_HEIGHT - 1));
+}
+
+void HistoryChart::drawBackground() {
+    PROFILE_ZONE("chart.background");
+    size_t stride = lv_draw_buf_width_to_stride(CHART_WIDTH, LV_COLOR_FORMAT_RGB565) / sizeof(uint16_t);
+    uint16_t bg = lv_color_to_u16(lv_color_hex(CHART_BG_COLOR));
+
+    // The plot rows are filled column by column in drawColumn(); only the time axis is left
+    for (int row = CHART_PLOT_HEIGHT; row < CHART_HEIGHT; row++) {
+        uint16_t* line = pixels + row * stride;
+        for (int x = 0; x < CHART_WIDTH; x++) {
+            line[x] = bg;
+        }
+    }
+
+    lv_layer_t layer;
+    lv_canvas_init_layer(canvas, &layer);
+    lv_draw_label_dsc_t label;
+    lv_draw_label_dsc_init(&label);
+    label.color = lv_color_hex(CHART_TEXT_COLOR);
+    label.font = &lv_font_montserrat_12;
+    char text[24];
+
+    const RangeInfo& info = RANGES[(int)range];
+    for (int i = 0; i < CHART_X_DIVISIONS; i++) {
+        int x = CHART_WIDTH * i / CHART_X_DIVISIONS;
+        time_t t = columnStart(windowStart, info.span, x);
+        struct tm local;
+        localtime_r(&t, &local);
+        strftime(text, sizeof(text), info.tickFormat, &local);
+        label.text = text;
+        lv_area_t area = {(int32_t)x + 3, CHART_PLOT_HEIGHT + 6, (int32_t)x + 96, CHART_HEIGHT - 1};
+        lv_draw_label(&layer, &label, &area);
+    }
+    lv_canvas_finish_layer(canvas, &layer);
+
+    for (int i = 0; i <= CHART_Y_DIVISIONS; i++) {
+        int32_t value = scaleMin + (scaleMax - scaleMin) * i / CHART_Y_DIVISIONS;
+        int row = valueToRow(value);
+        formatValue(channel, value, text, sizeof(text));
+        lv_label_set_text(valueLabels[i], text);
+        lv_obj_set_pos(valueLabels[i], 4, CHART_CANVAS_Y + max(row - 15, 0));
+    }
+}
+
+void HistoryChart::drawColumn(int column) {
+    size_t stride = lv_draw_buf_width_to_stride(CHART_WIDTH, LV_COLOR_FORMAT_RGB565) / sizeof(uint16_t);
+    uint16_t* px = pixels + column;
+    uint16_t bg = lv_color_to_u16(lv_color_hex(CHART_BG_COLOR));
+    uint16_t grid = lv_color_to_u16(lv_color_hex(CHART_GRID_COLOR));
+
+    // Background and dotted grid, then the min..max span with the average on top
+    bool gridColumn = (column * CHART_X_DIVISIONS) % CHART_WIDTH == 0;
+    for (int row = 0; row < CHART_PLOT_HEIGHT; row++) {
+        px[row * stride] = gridColumn && !(row & 1) ? grid : bg;
+    }
+    if (!(column & 1)) {
+        for (int i = 0; i <= CHART_Y_DIVISIONS; i++) {
+            px[(CHART_PLOT_HEIGHT - 1) * i / CHART_Y_DIVISIONS * stride] = grid;
+        }
+    }
+    const Column& data = columns[column];
+    if (data.samples == 0) {
+        return;
+    }
+    uint16_t color = lv_color_to_u16(lv_color_hex(CHANNELS[(int)channel].color));
+    int top = valueToRow(data.max);
+    int bottom = valueToRow(data.min);
+    for (int row = top; row <= bottom; row++) {
+        px[row * stride] = color;
+    }
+    int32_t avg = data.sum / (int32_t)data.samples;
+    px[valueToRow(avg) * stride] = lv_color_to_u16(lv_color_hex(CHART_AVG_COLOR));
+}
+
+void HistoryChart::rebuild() {
+    if (canvas == nullptr) {
+        return;
+    }
+    PROFILE_ZONE("chart.rebuild");
+    const ClockSnapshot& clock = ClockService::getInstance()->now();
+    const RangeInfo& info = RANGES[(int)range];
+
+    // Leave CHART_ADVANCE_COLUMNS free on the right so the window moves rarely
+    uint32_t advance = info.span / CHART_WIDTH * CHART_ADVANCE_COLUMNS;
+    windowEnd = ((clock.epoch / advance) + 1) * advance;
+    windowStart = windowEnd - info.span;
+
+    collect(0, CHART_WIDTH - 1);
+    chooseScale();
+    drawBackground();
+    for (int c = 0; c < CHART_WIDTH; c++) {
+        drawColumn(c);
+    }
+    lastColumn = timeToColumn(clock.epoch);
+    lv_obj_invalidate(canvas);
+    updateTitle();
+    fullRedraws++;
+}
+
+void HistoryChart::updateNewest(time_t now) {
+    if (now >= windowEnd) {
+        rebuild();
+        return;
+    }
+    PROFILE_ZONE("chart.column");
+    const RangeInfo& info = RANGES[(int)range];
+    uint32_t resolution = SensorHistory::getResolution(info.tier);
+
+    // Columns touched since the last update, including the whole open bucket
+    int newest = min(timeToColumn(now), CHART_WIDTH - 1);
+    int first = min(lastColumn, timeToColumn(now - (now % resolution)));
+    first = max(first, 0);
+    collect(first, newest);
+
+    for (int c = first; c <= newest; c++) {
+        if (columns[c].samples > 0 &&
+            (columns[c].min < scaleMin || columns[c].max > scaleMax)) {
+            // Out of scale: everything moves
+            chooseScale();
+            drawBackground();
+            for (int all = 0; all < CHART_WIDTH; all++) {
+                drawColumn(all);
+            }
+            lv_obj_invalidate(canvas);
+            lastColumn = newest;
+            updateTitle();
+            fullRedraws++;
+            return;
+        }
+    }
+
+    for (int c = first; c <= newest; c++) {
+        drawColumn(c);
+    }
+    lv_area_t coords;
+    lv_obj_get_coords(canvas, &coords);
+    lv_area_t dirty = {coords.x1 + first, coords.y1, coords.x1 + newest, coords.y1 + CHART_PLOT_HEIGHT - 1};
+    lv_obj_invalidate_area(canvas, &dirty);
+    lastColumn = newest;
+    updateTitle();
+    columnRedraws += newest - first + 1;
+}
+
+void HistoryChart::updateTitle() {
+    int32_t low = INT32_MAX;
+    int32_t high = INT32_MIN;
+    int latest = -1;
+    for (int c = 0; c < CHART_WIDTH; c++) {
+        if (columns[c].samples > 0) {
+            low = min(low, (int32_t)columns[c].min);
+            high = max(high, (int32_t)columns[c].max);
+            latest = c;
+        }
+    }
+
+    const ChannelInfo& info = CHANNELS[(int)channel];
+    if (latest < 0) {
+        lv_label_set_text_fmt(titleLabel, "%s, %s: keine Daten", info.name, RANGES[(int)range].name);
+        return;
+    }
+    char now[16], lowText[16], highText[16];
+    formatValue(channel, columns[latest].sum / (int32_t)columns[latest].samples, now, sizeof(now));
+    formatValue(channel, low, lowText, sizeof(lowText));
+    formatValue(channel, high, highText, sizeof(highText));
+    lv_label_set_text_fmt(titleLabel, "%s, %s: aktuell %s %s  (min %s, max %s)",
+                          info.name, RANGES[(int)range].name, now, info.unit, lowText, highText);
+}
+
+void HistoryChart::clockCallback(const ClockSnapshot& clock, uint8_t events, void* context) {
+    HistoryChart* self = static_cast<HistoryChart*>(context);
+    if (self->canvas == nullptr || !clock.valid) {
+        return;
+    }
+    if (events & CLOCK_SYNC) {
+        self->rebuild();
+    } else {
+        self->updateNewest(clock.epoch);
+    }
+}
@@ -0,0 +1,170 @@
+#include "HttpsBody.h"
+
+void HttpsBody::start(Stream* stream, int contentLength, bool chunked) {
+    client = stream;
+    firstChunk = true;
+    finished = false;
+    if (chunked) {
+        mode = CHUNKED;
+        remaining = 0;
+    } else if (contentLength >= 0) {
+        mode = LENGTH;
+        remaining = contentLength;
+        finished = contentLength == 0;
+    } else {
+        mode = UNTIL_CLOSE;
+        remaining = 0;
+    }
+}
+
+int HttpsBody::timedRead() {
+    uint32_t start = ::millis();
+    do {
+        int c = client->read();
+        if (c >= 0) {
+            return c;
+        }
+        delay(1);
+    } while (::millis() - start < HTTPS_READ_TIMEOUT_MS);
+    return -1;
+}
+
+// "<hex size>[;extension]\r\n", preceded by the CRLF ending the previous chunk
+bool HttpsBody::readChunkHeader() {
+    if (!firstChunk && (timedRead() != '\r' || timedRead() != '\n')) {
+        return false;
+    }
+    firstChunk = false;
+
+    uint32_t size = 0;
+    bool digits = false;
+    int c;
+    while ((c = timedRead()) >= 0 && c != '\n') {
+        if (c >= '0' && c <= '9') {
+            size = (size << 4) | (c - '0');
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            size = (size << 4) | ((c | 0x20) - 'a' + 10);
+        } else {
+            // Extension or '\r': the size is complete
+            while (c >= 0 && c != '\n') {
+                c = timedRead();
+            }
+            break;
+        }
+        digits = true;
+    }
+    if (c < 0 || !digits) {
+        return false;
+    }
+
+    if (size == 0) {
+        // Last chunk: skip trailers up to the empty line
+        int lineLength = 0;
+        while ((c = timedRead()) >= 0) {
+            if (c == '\n') {
+                if (lineLength == 0) {
+                    break;
+                }
+                lineLength = 0;
+            } else if (c != '\r') {
+                lineLength++;
+            }
+        }
+        finished = true;
+        return c >= 0;
+    }
+    remaining = size;
+    return true;
+}
+
+bool HttpsBody::ensureData() {
+    if (finished || client == nullptr) {
+        return false;
+    }
+    switch (mode) {
+        case LENGTH:
+            finished = remaining == 0;
+            return !finished;
+        case CHUNKED:
+            if (remaining == 0 && !readChunkHeader()) {
+                // Malformed or cut off; the connection is not reusable
+                finished = true;
+                client = nullptr;
+                return false;
+            }
+            return !finished;
+        default:
+            return true;
+    }
+}
+
+int HttpsBody::available() {
+    if (client == nullptr || finished) {
+        return 0;
+    }
+    int buffered = client->available();
+    if (mode == UNTIL_CLOSE) {
+        return buffered;
+    }
+    // A chunk header is still to be read: report nothing so the caller reads byte-wise
+    return (int)min((uint32_t)max(buffered, 0), remaining);
+}
+
+int HttpsBody::read() {
+    if (!ensureData()) {
+        return -1;
+    }
+    int c = timedRead();
+    if (c < 0) {
+        finished = true;
+        return -1;
+    }
+    if (mode != UNTIL_CLOSE) {
+        remaining--;
+    }
+    return c;
+}
+
+int HttpsBody::peek() {
+    if (!ensureData()) {
+        return -1;
+    }
+    return client->peek();
+}
+
+size_t HttpsBody::readBytes(char* buffer, size_t length) {
+    size_t copied = 0;
+    while (copied < length && ensureData()) {
+        size_t wanted = length - copied;
+        if (mode != UNTIL_CLOSE) {
+            wanted = min(wanted, (size_t)remaining);
+        }
+        size_t got = client->readBytes((uint8_t*)buffer + copied, wanted);
+        if (got == 0) {
+            finished = true;
+            break;
+        }
+        copied += got;
+        if (mode != UNTIL_CLOSE) {
+            remaining -= got;
+        }
+    }
+    return copied;
+}
+
+bool HttpsBody::drain() {
+    if (client == nullptr) {
+        return false;
+    }
+    uint8_t scratch[64];
+    while (ensureData()) {
+        if (readBytes((char*)scratch, sizeof(scratch)) == 0) {
+            break;
+        }
+    }
+    // Complete only if the framing said so, not because the peer went away
+    bool complete = client != nullptr && mode != UNTIL_CLOSE && remaining == 0;
+    client = nullptr;
+    finished = true;
+    return complete;
+}
@@ -0,0 +1,186 @@
+#include "HttpsConnection.h"
+#include <WiFi.h>
+#include "SerialConsole.h"
+#include "DeferredLog.h"
+#include "Profiler.h"
+#include "debug_config.h"
+
+// Initialize static singleton instance to nullptr
+HttpsConnectionManager* HttpsConnectionManager::_instance = nullptr;
+
+static const char* COLLECTED_HEADERS[] = {"Transfer-Encoding", "Connection"};
+
+static void httpsCommand(const char* args) {
+    (void)args;
+    HttpsConnectionManager::getInstance()->printStats();
+}
+
+//##################################################################################################
+// HttpsConnectionManager
+
+HttpsConnectionManager::HttpsConnectionManager()
+    : keepAlive(false), requestOpen(false), requestStartMs(0), lastUseMs(0), resolvedAtMs(0) {
+    host[0] = '\0';
+    resolvedHost[0] = '\0';
+    memset(&stats, 0, sizeof(stats));
+    // Same trust model as HTTPClient::begin(url) before: no CA bundle on the device
+    client.setInsecure();
+    client.setHandshakeTimeout(HTTPS_HANDSHAKE_TIMEOUT_S);
+    http.setReuse(true);
+    http.setTimeout(HTTPS_READ_TIMEOUT_MS);
+    http.collectHeaders(COLLECTED_HEADERS, sizeof(COLLECTED_HEADERS) / sizeof(COLLECTED_HEADERS[0]));
+}
+
+HttpsConnectionManager* HttpsConnectionManager::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new HttpsConnectionManager();
+    }
+    return _instance;
+}
+
+void HttpsConnectionManager::begin() {
+    ClockService::getInstance()->subscribe(CLOCK_SECOND, clockCallback, this);
+    SerialConsole::getInstance()->registerCommand("https", "HTTPS handshakes, connection reuse and latency", httpsCommand);
+}
+
+void HttpsConnectionManager::clockCallback(const ClockSnapshot& clock, uint8_t events, void* context) {
+    (void)clock;
+    (void)events;
+    HttpsConnectionManager* self = static_cast<HttpsConnectionManager*>(context);
+    if (!self->requestOpen && self->host[0] != '\0' && ::millis() - self->lastUseMs >= HTTPS_KEEPALIVE_MS) {
+        self->stats.idleCloses++;
+        self->close();
+    }
+}
+
+bool HttpsConnectionManager::resolve(const char* targetHost, IPAddress& address) {
+    if (resolvedAtMs != 0 && strcmp(resolvedHost, targetHost) == 0 &&
+        ::millis() - resolvedAtMs < HTTPS_DNS_TTL_MS) {
+        stats.dnsHits++;
+        address = resolvedAddress;
+        return true;
+    }
+    stats.dnsLookups++;
+    if (!WiFi.hostByName(targetHost, address)) {
+        resolvedAtMs = 0;
+        return false;
+    }
+    strncpy(resolvedHost, targetHost, sizeof(resolvedHost) - 1);
+    resolvedHost[sizeof(resolvedHost) - 1] = '\0';
+    resolvedAddress = address;
+    resolvedAtMs = ::millis();
+    return true;
+}
+
+bool HttpsConnectionManager::connect(const char* targetHost) {
+    PROFILE_ZONE("https.handshake");
+    close();
+
+    IPAddress address;
+    if (!resolve(targetHost, address)) {
+        LOG_WARN(SYSTEM, "HTTPS: cannot resolve %s", targetHost);
+        return false;
+    }
+
+    // Connect to the cached address; the host name is still used for SNI
+    uint32_t start = ::millis();
+    if (!client.connect(address, HTTPS_PORT, targetHost, nullptr, nullptr, nullptr)) {
+        // The address may have moved: resolve again next time
+        resolvedAtMs = 0;
+        LOG_WARN(SYSTEM, "HTTPS: connection to %s failed", targetHost);
+        return false;
+    }
+    stats.handshakes++;
+    stats.lastHandshakeMs = ::millis() - start;
+    stats.totalHandshakeMs += stats.lastHandshakeMs;
+
+    strncpy(host, targetHost, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    return true;
+}
+
+int HttpsConnectionManager::get(const char* targetHost, const String& uri) {
+    PROFILE_ZONE("https.get");
+    requestStartMs = ::millis();
+    requestOpen = true;
+    stats.requests++;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reuse = host[0] != '\0' && strcmp(host, targetHost) == 0 && client.connected();
+        if (!reuse && !connect(targetHost)) {
+            break;
+        }
+
+        // HTTPClient sees the connected client and sends on it as is
+        http.begin(client, targetHost, HTTPS_PORT, uri, true);
+        int code = http.GET();
+        if (code > 0) {
+            if (reuse) {
+                stats.keptAliveReuses++;
+            }
+            String connection = http.header("Connection");
+            connection.toLowerCase();
+            keepAlive = connection.indexOf("close") < 0;
+            String encoding = http.header("Transfer-Encoding");
+            encoding.toLowerCase();
+            body.start(&client, http.getSize(), encoding.indexOf("chunked") >= 0);
+            return code;
+        }
+
+        http.end();
+        close();
+        if (!reuse) {
+            LOG_WARN(SYSTEM, "HTTPS: GET %s failed: %d", targetHost, code);
+            stats.failures++;
+            body.start(nullptr, 0, false);
+            return code;
+        }
+        // The server dropped the idle connection; once more on a new one
+        stats.staleRetries++;
+    }
+
+    stats.failures++;
+    body.start(nullptr, 0, false);
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+}
+
+void HttpsConnectionManager::end() {
+    if (!requestOpen) {
+        return;
+    }
+    requestOpen = false;
+
+    // Only a fully consumed body leaves the connection usable for the next request
+    bool reusable = body.drain() && keepAlive;
+    http.end();
+    if (!reusable) {
+        close();
+    }
+
+    lastUseMs = ::millis();
+    stats.lastLatencyMs = lastUseMs - requestStartMs;
+    stats.totalLatencyMs += stats.lastLatencyMs;
+    if (stats.lastLatencyMs > stats.maxLatencyMs) {
+        stats.maxLatencyMs = stats.lastLatencyMs;
+    }
+}
+
+void HttpsConnectionManager::close() {
+    if (host[0] != '\0') {
+        client.stop();
+        host[0] = '\0';
+    }
+}
+
+void HttpsConnectionManager::printStats() {
+    DEBUG_PRINTF("HTTPS: %u requests, %u failed, connection %s\n", stats.requests, stats.failures,
+                 host[0] != '\0' ? host : "closed");
+    DEBUG_PRINTF("  Handshakes: %u (last %u ms, avg %u ms)\n", stats.handshakes, stats.lastHandshakeMs,
+                 stats.handshakes ? stats.totalHandshakeMs / stats.handshakes : 0);
+    DEBUG_PRINTF("  Kept-alive reuses: %u (%u%% of requests), stale retries %u, idle closes %u\n",
+                 stats.keptAliveReuses, stats.requests ? stats.keptAliveReuses * 100 / stats.requests : 0,
+                 stats.staleRetries, stats.idleCloses);
+    DEBUG_PRINTF("  DNS: %u lookups, %u cache hits\n", stats.dnsLookups, stats.dnsHits);
+    DEBUG_PRINTF("  Latency: last %u ms, avg %u ms, max %u ms\n", stats.lastLatencyMs,
+                 stats.requests ? stats.totalLatencyMs / stats.requests : 0, stats.maxLatencyMs);
+}
@@ -0,0 +1,256 @@
+#include "I2CBus.h"
+#include <freertos/task.h>
+#include "SerialConsole.h"
+#include "DeferredLog.h"
+
+// Guards the device table (devices are added by their constructors)
+static portMUX_TYPE deviceTableMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Initialize static singleton instance to nullptr
+I2CBus* I2CBus::_instance = nullptr;
+
+static void i2cCommand(const char* args) {
+    (void)args;
+    I2CBus::getInstance()->printStats();
+}
+
+// Wire endTransmission() codes: 0 ok, 2/3 NACK, 5 timeout, others bus errors
+static I2CResult resultFromCode(uint8_t code) {
+    switch (code) {
+        case 0:  return I2CResult::OK;
+        case 2:
+        case 3:  return I2CResult::NACK;
+        case 5:  return I2CResult::TIMEOUT;
+        default: return I2CResult::BUS_ERROR;
+    }
+}
+
+I2CDevice::I2CDevice(const char* name, uint8_t address, uint32_t clockHz, uint16_t timeoutMs, I2CPriority priority)
+    : name(name), address(address), clockHz(clockHz), timeoutMs(timeoutMs), priority(priority), done(nullptr) {
+    memset(&stats, 0, sizeof(stats));
+    I2CBus::getInstance()->addDevice(this);
+}
+
+I2CResult I2CDevice::write(const uint8_t* data, size_t length) {
+    I2CBus::Transaction t = {this, I2CBus::Operation::WRITE, data, length, nullptr, 0, nullptr, nullptr, 0, I2CResult::OK};
+    return I2CBus::getInstance()->submit(t);
+}
+
+I2CResult I2CDevice::read(uint8_t* data, size_t length) {
+    I2CBus::Transaction t = {this, I2CBus::Operation::READ, nullptr, 0, data, length, nullptr, nullptr, 0, I2CResult::OK};
+    return I2CBus::getInstance()->submit(t);
+}
+
+I2CResult I2CDevice::writeRead(const uint8_t* tx, size_t txLength, uint8_t* rx, size_t rxLength) {
+    I2CBus::Transaction t = {this, I2CBus::Operation::WRITE_READ, tx, txLength, rx, rxLength, nullptr, nullptr, 0, I2CResult::OK};
+    return I2CBus::getInstance()->submit(t);
+}
+
+I2CResult I2CDevice::run(I2CCallback callback, void* context) {
+    I2CBus::Transaction t = {this, I2CBus::Operation::CALLBACK, nullptr, 0, nullptr, 0, callback, context, 0, I2CResult::OK};
+    return I2CBus::getInstance()->submit(t);
+}
+
+I2CBus::I2CBus()
+    : pending(nullptr), taskHandle(nullptr), sda(-1), scl(-1), defaultClock(100000),
+      currentClock(0), currentTimeout(0), consecutiveFailures(0), recoveries(0), deviceCount(0) {
+    for (int i = 0; i < (int)I2CPriority::COUNT; i++) {
+        queues[i] = nullptr;
+    }
+}
+
+I2CBus* I2CBus::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new I2CBus();
+    }
+    return _instance;
+}
+
+void I2CBus::begin(int sdaPin, int sclPin, uint32_t defaultClockHz) {
+    sda = sdaPin;
+    scl = sclPin;
+    defaultClock = defaultClockHz;
+    currentClock = defaultClockHz;
+
+    for (int i = 0; i < (int)I2CPriority::COUNT; i++) {
+        queues[i] = xQueueCreate(I2C_QUEUE_LENGTH, sizeof(Transaction*));
+    }
+    pending = xSemaphoreCreateCounting(I2C_QUEUE_LENGTH * (int)I2CPriority::COUNT, 0);
+    // Completion semaphores of the devices constructed so far; later ones get theirs in addDevice()
+    for (int i = 0; i < deviceCount; i++) {
+        devices[i]->done = xSemaphoreCreateBinary();
+    }
+    xTaskCreate(taskFunction, "I2CTask", I2C_TASK_STACK_SIZE, this, I2C_TASK_PRIORITY, &taskHandle);
+
+    SerialConsole::getInstance()->registerCommand("i2c", "I2C bus statistics per device", i2cCommand);
+}
+
+void I2CBus::addDevice(I2CDevice* device) {
+    // Created here only once the bus runs; static devices are constructed
+    // before the scheduler and get theirs in begin()
+    if (taskHandle != nullptr) {
+        device->done = xSemaphoreCreateBinary();
+    }
+    bool added = false;
+    portENTER_CRITICAL(&deviceTableMux);
+    if (deviceCount < MAX_I2C_DEVICES) {
+        devices[deviceCount++] = device;
+        added = true;
+    }
+    portEXIT_CRITICAL(&deviceTableMux);
+    if (!added) {
+        LOG_ERROR(SYSTEM, "I2C device table full, %s is not served by the bus task", device->name);
+    }
+}
+
+I2CResult I2CBus::submit(Transaction& transaction) {
+    I2CDevice* device = transaction.device;
+    transaction.queuedUs = micros();
+
+    // Before begin(), or nested inside a callback on the bus task
+    if (taskHandle == nullptr || xTaskGetCurrentTaskHandle() == taskHandle) {
+        execute(transaction);
+        return transaction.result;
+    }
+    if (device->done == nullptr) {
+        // Not in the device table (see addDevice())
+        transaction.result = I2CResult::BUS_ERROR;
+        return transaction.result;
+    }
+
+    Transaction* queued = &transaction;
+    xQueueSend(queues[(int)device->priority], &queued, portMAX_DELAY);
+    xSemaphoreGive(pending);
+    xSemaphoreTake(device->done, portMAX_DELAY);
+    return transaction.result;
+}
+
+void I2CBus::taskFunction(void* parameter) {
+    I2CBus* bus = static_cast<I2CBus*>(parameter);
+    for (;;) {
+        xSemaphoreTake(bus->pending, portMAX_DELAY);
+
+        // Highest priority first
+        Transaction* transaction = nullptr;
+        for (int i = 0; i < (int)I2CPriority::COUNT; i++) {
+            if (xQueueReceive(bus->queues[i], &transaction, 0) == pdTRUE) {
+                break;
+            }
+        }
+        if (transaction == nullptr) {
+            continue;
+        }
+        bus->execute(*transaction);
+        xSemaphoreGive(transaction->device->done);
+    }
+}
+
+void I2CBus::execute(Transaction& t) {
+    I2CDevice* device = t.device;
+    uint32_t waitUs = micros() - t.queuedUs;
+    if (waitUs > device->stats.maxWaitUs) {
+        device->stats.maxWaitUs = waitUs;
+    }
+
+    // Callbacks using Wire1 (the LovyanGFX touch driver) get the device settings too
+    if (currentClock != device->clockHz) {
+        Wire1.setClock(device->clockHz);
+        currentClock = device->clockHz;
+    }
+    if (currentTimeout != device->timeoutMs) {
+        Wire1.setTimeOut(device->timeoutMs);
+        currentTimeout = device->timeoutMs;
+    }
+
+    I2CResult result = I2CResult::OK;
+    switch (t.operation) {
+        case Operation::WRITE:
+        case Operation::WRITE_READ:
+            Wire1.beginTransmission(device->address);
+            Wire1.write(t.tx, t.txLength);
+            // Repeated start for write-then-read
+            result = resultFromCode(Wire1.endTransmission(t.operation == Operation::WRITE));
+            if (result != I2CResult::OK || t.operation == Operation::WRITE) {
+                break;
+            }
+            // Fall through to the read phase
+        case Operation::READ: {
+            size_t received = Wire1.requestFrom((uint16_t)device->address, t.rxLength, true);
+            for (size_t i = 0; i < received && i < t.rxLength; i++) {
+                t.rx[i] = (uint8_t)Wire1.read();
+            }
+            if (received != t.rxLength) {
+                result = received == 0 ? I2CResult::NACK : I2CResult::BUS_ERROR;
+            }
+            break;
+        }
+        case Operation::CALLBACK:
+            result = t.callback(t.context);
+            // Library drivers may have changed the bus settings
+            currentClock = 0;
+            currentTimeout = 0;
+            break;
+    }
+    t.result = result;
+
+    device->stats.transactions++;
+    switch (result) {
+        case I2CResult::NACK:      device->stats.nacks++; break;
+        case I2CResult::TIMEOUT:   device->stats.timeouts++; break;
+        case I2CResult::BUS_ERROR: device->stats.busErrors++; break;
+        default: break;
+    }
+
+    // A NACK means the bus itself works; only timeouts and bus errors count
+    if (result == I2CResult::TIMEOUT || result == I2CResult::BUS_ERROR) {
+        if (++consecutiveFailures >= I2C_RECOVERY_THRESHOLD) {
+            recoverBus();
+        }
+    } else {
+        consecutiveFailures = 0;
+    }
+}
+
+void I2CBus::recoverBus() {
+    LOG_WARN(SYSTEM, "I2C: %u consecutive bus failures, recovering", consecutiveFailures);
+    consecutiveFailures = 0;
+    recoveries++;
+
+    Wire1.end();
+
+    // Clock out a slave that is holding SDA low in the middle of a byte
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(scl, HIGH);
+    for (int i = 0; i < 9 && digitalRead(sda) == LOW; i++) {
+        digitalWrite(scl, LOW);
+        delayMicroseconds(5);
+        digitalWrite(scl, HIGH);
+        delayMicroseconds(5);
+    }
+
+    // STOP condition: SDA rises while SCL is high
+    pinMode(sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(sda, LOW);
+    delayMicroseconds(5);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(sda, HIGH);
+    delayMicroseconds(5);
+
+    Wire1.begin(sda, scl, defaultClock);
+    currentClock = defaultClock;
+    currentTimeout = 0;
+}
+
+void I2CBus::printStats() {
+    DEBUG_PRINTF("I2C bus: %s, %u recoveries\n", taskHandle ? "task running" : "direct (not started)", recoveries);
+    DEBUG_PRINTLN("Device    Addr  Clock   Prio  Transactions  NACK  Timeout  BusErr  MaxWait(us)");
+    for (int i = 0; i < deviceCount; i++) {
+        const I2CDevice* device = devices[i];
+        const I2CDeviceStats& s = device->stats;
+        DEBUG_PRINTF("%-8s  0x%02X  %4uk  %4d  %12u  %4u  %7u  %6u  %11u\n",
+                     device->name, device->address, device->clockHz / 1000, (int)device->priority,
+                     s.transactions, s.nacks, s.timeouts, s.busErrors, s.maxWaitUs);
+    }
+}
@@ -0,0 +1,328 @@
+#include "LvglHeap.h"
+#include <lvgl.h>
+#include <esp_heap_caps.h>
+#include <multi_heap.h>
+#include <freertos/FreeRTOS.h>
+#include "SerialConsole.h"
+#include "debug_config.h"
+
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM
+
+//##################################################################################################
+// Internal-RAM size-class pools
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct PoolClass {
+    uint8_t* begin;
+    uint8_t* end;
+    uint16_t blockSize;
+    uint16_t blockCount;
+    FreeBlock* freeList;
+    uint16_t used;
+    uint16_t peakUsed;
+    uint32_t allocations;
+};
+
+alignas(16) static uint8_t pool16[16 * LVGL_POOL_16_BLOCKS];
+alignas(16) static uint8_t pool32[32 * LVGL_POOL_32_BLOCKS];
+alignas(16) static uint8_t pool64[64 * LVGL_POOL_64_BLOCKS];
+alignas(16) static uint8_t pool128[128 * LVGL_POOL_128_BLOCKS];
+
+static PoolClass pools[LVGL_POOL_CLASS_COUNT];
+
+// Bounds of all pool memory, for a quick "is this a pool block" check
+static uint8_t* poolsBegin = nullptr;
+static uint8_t* poolsEnd = nullptr;
+
+// PSRAM tier
+static multi_heap_handle_t psramHeap = nullptr;
+static void* psramRegion = nullptr;
+static uint32_t psramAllocations = 0;
+static size_t psramPeakUsed = 0;
+
+// Fallback counters
+static uint32_t poolFallbacks = 0;      // Size class full -> PSRAM region
+static uint32_t systemFallbacks = 0;    // PSRAM region full or missing -> system heap
+static uint32_t systemLive = 0;
+
+// Free lists and counters. LVGL runs on the loop task, but nothing stops
+// another task from reaching lv_malloc(), and the sections are a few instructions.
+static portMUX_TYPE poolMux = portMUX_INITIALIZER_UNLOCKED;
+
+// A region registered with multi_heap_register() has no lock of its own
+static portMUX_TYPE psramMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void initPool(PoolClass& pool, uint8_t* memory, uint16_t blockSize, uint16_t blockCount) {
+    pool.begin = memory;
+    pool.end = memory + (size_t)blockSize * blockCount;
+    pool.blockSize = blockSize;
+    pool.blockCount = blockCount;
+    pool.used = 0;
+    pool.peakUsed = 0;
+    pool.allocations = 0;
+
+    // Thread the free list through the blocks, lowest address first
+    pool.freeList = nullptr;
+    for (int i = blockCount - 1; i >= 0; i--) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(memory + (size_t)i * blockSize);
+        block->next = pool.freeList;
+        pool.freeList = block;
+    }
+
+    if (!poolsBegin || pool.begin < poolsBegin) poolsBegin = pool.begin;
+    if (!poolsEnd || pool.end > poolsEnd) poolsEnd = pool.end;
+}
+
+static PoolClass* poolForSize(size_t size) {
+    for (int i = 0; i < LVGL_POOL_CLASS_COUNT; i++) {
+        if (size <= pools[i].blockSize) {
+            return &pools[i];
+        }
+    }
+    return nullptr;
+}
+
+static PoolClass* poolForPointer(void* p) {
+    uint8_t* address = static_cast<uint8_t*>(p);
+    if (address < poolsBegin || address >= poolsEnd) {
+        return nullptr;
+    }
+    for (int i = 0; i < LVGL_POOL_CLASS_COUNT; i++) {
+        if (address >= pools[i].begin && address < pools[i].end) {
+            return &pools[i];
+        }
+    }
+    return nullptr;
+}
+
+static bool inPsramRegion(void* p) {
+    uint8_t* address = static_cast<uint8_t*>(p);
+    uint8_t* region = static_cast<uint8_t*>(psramRegion);
+    return psramHeap && address >= region && address < region + LVGL_PSRAM_HEAP_SIZE;
+}
+
+static void* allocatePsram(size_t size) {
+    if (psramHeap) {
+        void* p = multi_heap_malloc(psramHeap, size);
+        if (p) {
+            size_t used = LVGL_PSRAM_HEAP_SIZE - multi_heap_free_size(psramHeap);
+            portENTER_CRITICAL(&poolMux);
+            psramAllocations++;
+            if (used > psramPeakUsed) psramPeakUsed = used;
+            portEXIT_CRITICAL(&poolMux);
+            return p;
+        }
+    }
+    void* p = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    portENTER_CRITICAL(&poolMux);
+    systemFallbacks++;
+    if (p) systemLive++;
+    portEXIT_CRITICAL(&poolMux);
+    return p;
+}
+
+static size_t allocatedSize(void* p) {
+    PoolClass* pool = poolForPointer(p);
+    if (pool) {
+        return pool->blockSize;
+    }
+    if (inPsramRegion(p)) {
+        return multi_heap_get_allocated_size(psramHeap, p);
+    }
+    return heap_caps_get_allocated_size(p);
+}
+
+//##################################################################################################
+// LVGL custom stdlib hooks
+
+void lv_mem_init(void) {
+    initPool(pools[0], pool16, 16, LVGL_POOL_16_BLOCKS);
+    initPool(pools[1], pool32, 32, LVGL_POOL_32_BLOCKS);
+    initPool(pools[2], pool64, 64, LVGL_POOL_64_BLOCKS);
+    initPool(pools[3], pool128, 128, LVGL_POOL_128_BLOCKS);
+
+    psramRegion = heap_caps_malloc(LVGL_PSRAM_HEAP_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (psramRegion) {
+        psramHeap = multi_heap_register(psramRegion, LVGL_PSRAM_HEAP_SIZE);
+        if (psramHeap) {
+            multi_heap_set_lock(psramHeap, &psramMux);
+        }
+    }
+}
+
+void lv_mem_deinit(void) {
+    // The pools are static and LVGL is never torn down at runtime
+}
+
+lv_mem_pool_t lv_mem_add_pool(void* mem, size_t bytes) {
+    LV_UNUSED(mem);
+    LV_UNUSED(bytes);
+    return NULL;
+}
+
+void lv_mem_remove_pool(lv_mem_pool_t pool) {
+    LV_UNUSED(pool);
+}
+
+void* lv_malloc_core(size_t size) {
+    PoolClass* pool = poolForSize(size);
+    if (pool) {
+        portENTER_CRITICAL(&poolMux);
+        FreeBlock* block = pool->freeList;
+        if (block) {
+            pool->freeList = block->next;
+            pool->used++;
+            pool->allocations++;
+            if (pool->used > pool->peakUsed) pool->peakUsed = pool->used;
+            portEXIT_CRITICAL(&poolMux);
+            return block;
+        }
+        poolFallbacks++;
+        portEXIT_CRITICAL(&poolMux);
+    }
+    return allocatePsram(size);
+}
+
+void lv_free_core(void* p) {
+    PoolClass* pool = poolForPointer(p);
+    if (pool) {
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        portENTER_CRITICAL(&poolMux);
+        block->next = pool->freeList;
+        pool->freeList = block;
+        pool->used--;
+        portEXIT_CRITICAL(&poolMux);
+    } else if (inPsramRegion(p)) {
+        multi_heap_free(psramHeap, p);
+    } else if (p) {
+        portENTER_CRITICAL(&poolMux);
+        systemLive--;
+        portEXIT_CRITICAL(&poolMux);
+        heap_caps_free(p);
+    }
+}
+
+void* lv_realloc_core(void* p, size_t new_size) {
+    if (!p) {
+        return lv_malloc_core(new_size);
+    }
+
+    PoolClass* pool = poolForPointer(p);
+    if (pool && new_size <= pool->blockSize) {
+        return p;
+    }
+    if (!pool && inPsramRegion(p) && !poolForSize(new_size)) {
+        // Large stays large: let the region allocator grow in place if it can
+        void* result = multi_heap_realloc(psramHeap, p, new_size);
+        if (result) {
+            return result;
+        }
+    }
+
+    // Moving between tiers
+    void* result = lv_malloc_core(new_size);
+    if (!result) {
+        return NULL;
+    }
+    size_t oldSize = allocatedSize(p);
+    memcpy(result, p, oldSize < new_size ? oldSize : new_size);
+    lv_free_core(p);
+    return result;
+}
+
+void lv_mem_monitor_core(lv_mem_monitor_t* mon_p) {
+    size_t poolTotal = 0;
+    size_t poolFree = 0;
+    uint32_t poolUsedCount = 0;
+    uint32_t poolFreeCount = 0;
+    for (int i = 0; i < LVGL_POOL_CLASS_COUNT; i++) {
+        const PoolClass& pool = pools[i];
+        poolTotal += (size_t)pool.blockSize * pool.blockCount;
+        poolFree += (size_t)pool.blockSize * (pool.blockCount - pool.used);
+        poolUsedCount += pool.used;
+        poolFreeCount += pool.blockCount - pool.used;
+    }
+
+    size_t psramTotal = 0;
+    size_t psramFree = 0;
+    size_t psramLargest = 0;
+    uint32_t psramUsedCount = 0;
+    uint32_t psramFreeCount = 0;
+    if (psramHeap) {
+        multi_heap_info_t info;
+        multi_heap_get_info(psramHeap, &info);
+        psramTotal = LVGL_PSRAM_HEAP_SIZE;
+        psramFree = info.total_free_bytes;
+        psramLargest = info.largest_free_block;
+        psramUsedCount = info.allocated_blocks;
+        psramFreeCount = info.free_blocks;
+    }
+
+    mon_p->total_size = poolTotal + psramTotal;
+    mon_p->free_size = poolFree + psramFree;
+    mon_p->free_biggest_size = psramLargest;
+    mon_p->free_cnt = poolFreeCount + psramFreeCount;
+    mon_p->used_cnt = poolUsedCount + psramUsedCount + systemLive;
+    mon_p->max_used = psramPeakUsed;
+    for (int i = 0; i < LVGL_POOL_CLASS_COUNT; i++) {
+        mon_p->max_used += (size_t)pools[i].blockSize * pools[i].peakUsed;
+    }
+    mon_p->used_pct = mon_p->total_size
+        ? (uint8_t)(100 - (uint64_t)mon_p->free_size * 100 / mon_p->total_size) : 0;
+    // Fragmentation of the PSRAM region; the size-class pools do not fragment
+    mon_p->frag_pct = psramFree ? (uint8_t)(100 - (uint64_t)psramLargest * 100 / psramFree) : 0;
+}
+
+lv_result_t lv_mem_test_core(void) {
+    if (psramHeap && !multi_heap_check(psramHeap, true)) {
+        return LV_RESULT_INVALID;
+    }
+    return LV_RESULT_OK;
+}
+
+//##################################################################################################
+// Reporting
+
+void LvglHeap::printStats() {
+    DEBUG_PRINTLN("LVGL internal pools: class  used/blocks  peak  allocations");
+    for (int i = 0; i < LVGL_POOL_CLASS_COUNT; i++) {
+        const PoolClass& pool = pools[i];
+        DEBUG_PRINTF("                     %5u  %4u/%-6u  %4u  %u\n", pool.blockSize,
+                     pool.used, pool.blockCount, pool.peakUsed, pool.allocations);
+    }
+
+    if (psramHeap) {
+        multi_heap_info_t info;
+        multi_heap_get_info(psramHeap, &info);
+        size_t used = LVGL_PSRAM_HEAP_SIZE - info.total_free_bytes;
+        uint32_t frag = info.total_free_bytes
+            ? 100 - (uint32_t)((uint64_t)info.largest_free_block * 100 / info.total_free_bytes) : 0;
+        DEBUG_PRINTF("LVGL PSRAM region: %u/%u bytes used, %u peak, %u blocks, largest free %u, frag %u%%, %u allocations\n",
+                     used, LVGL_PSRAM_HEAP_SIZE, psramPeakUsed, info.allocated_blocks,
+                     info.largest_free_block, frag, psramAllocations);
+    } else {
+        DEBUG_PRINTLN("LVGL PSRAM region: not available, large allocations use the system heap");
+    }
+    DEBUG_PRINTF("Fallbacks: %u pool->PSRAM, %u ->system heap (%u live)\n",
+                 poolFallbacks, systemFallbacks, systemLive);
+}
+
+#else
+
+void LvglHeap::printStats() {
+    DEBUG_PRINTLN("LVGL uses its configured stdlib allocator (LV_USE_STDLIB_MALLOC != LV_STDLIB_CUSTOM)");
+}
+
+#endif // LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM
+
+static void lvheapCommand(const char* args) {
+    (void)args;
+    LvglHeap::printStats();
+}
+
+void LvglHeap::begin() {
+    SerialConsole::getInstance()->registerCommand("lvheap", "LVGL heap tiers, fragmentation and fallbacks", lvheapCommand);
+}
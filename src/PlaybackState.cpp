@@ -0,0 +1,36 @@
+#include "PlaybackState.h"
+
+PlaybackStateChannel::PlaybackStateChannel()
+    : middle(2), back(0), front(1), sequence(0) {
+    memset(slots, 0, sizeof(slots));
+    memset(&staging, 0, sizeof(staging));
+    staging.state = PlaybackStateCode::STOPPED;
+    published = staging;
+}
+
+bool PlaybackStateChannel::publish() {
+    // The text fields are zero-filled by setPlaybackText, so equal content compares equal
+    staging.sequence = sequence;
+    if (memcmp(&staging, &published, sizeof(staging)) == 0) {
+        return false;
+    }
+    staging.sequence = ++sequence;
+    published = staging;
+    slots[back] = staging;
+
+    // Hand the filled slot to the consumer and take back whichever slot was parked
+    uint8_t previous = middle.exchange(back | FRESH_FLAG, std::memory_order_acq_rel);
+    back = previous & SLOT_MASK;
+    return true;
+}
+
+bool PlaybackStateChannel::consume() {
+    // Fast path: nothing new was published, keep reading the current front slot
+    if (!(middle.load(std::memory_order_acquire) & FRESH_FLAG)) {
+        return false;
+    }
+
+    uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+    front = previous & SLOT_MASK;
+    return true;
+}
@@ -0,0 +1,157 @@
+#include "PowerManager.h"
+#include <esp_pm.h>
+#include "SerialConsole.h"
+#include "DeferredLog.h"
+
+#if POWER_MANAGEMENT && CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t cpuMaxLock = nullptr;
+static esp_pm_lock_handle_t apbMaxLock = nullptr;
+static esp_pm_lock_handle_t noLightSleepLock = nullptr;
+
+static void updateLock(esp_pm_lock_handle_t lock, bool held, bool wanted) {
+    if (!lock || held == wanted) {
+        return;
+    }
+    if (wanted) {
+        esp_pm_lock_acquire(lock);
+    } else {
+        esp_pm_lock_release(lock);
+    }
+}
+#endif
+
+// Initialize static singleton instance to nullptr
+PowerManager* PowerManager::_instance = nullptr;
+
+static void powerCommand(const char* args) {
+    (void)args;
+    PowerManager::getInstance()->printStatus();
+}
+
+PowerManager::PowerManager()
+    : pmEnabled(false), lightSleepEnabled(false), lastAccountMs(0),
+      timeAtMaxMs(0), timeAtMinMs(0), timeSleepAllowedMs(0) {
+    applied.cpuMax = false;
+    applied.apbMax = false;
+    applied.noLightSleep = false;
+}
+
+PowerManager* PowerManager::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new PowerManager();
+    }
+    return _instance;
+}
+
+void PowerManager::begin() {
+    lastAccountMs = millis();
+    SerialConsole::getInstance()->registerCommand("power", "Power locks and time per CPU clock level", powerCommand);
+
+#if POWER_MANAGEMENT && CONFIG_PM_ENABLE
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "cpu_max", &cpuMaxLock);
+    esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "apb_max", &apbMaxLock);
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "no_sleep", &noLightSleepLock);
+
+    // Apply the current policy before DFS is enabled so active subsystems
+    // never see the lower clock
+    apply(millis());
+
+    esp_pm_config_esp32s3_t config;
+    config.max_freq_mhz = POWER_MAX_CPU_FREQ_MHZ;
+    config.min_freq_mhz = POWER_MIN_CPU_FREQ_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    config.light_sleep_enable = true;
+#else
+    config.light_sleep_enable = false;
+#endif
+    esp_err_t err = esp_pm_configure(&config);
+    if (err == ESP_OK) {
+        pmEnabled = true;
+        lightSleepEnabled = config.light_sleep_enable;
+        LOG_INFO(SYSTEM, "Power management: DFS %d-%d MHz, light sleep %s",
+                 POWER_MIN_CPU_FREQ_MHZ, POWER_MAX_CPU_FREQ_MHZ, lightSleepEnabled ? "on" : "off");
+    } else {
+        LOG_WARN(SYSTEM, "Power management: esp_pm_configure failed (%d)", (int)err);
+    }
+#else
+    LOG_INFO(SYSTEM, "Power management not available (CONFIG_PM_ENABLE=0 or POWER_MANAGEMENT=0)");
+#endif
+}
+
+void PowerManager::setActive(PowerSubsystem subsystem, bool active) {
+    uint32_t now = millis();
+    policy.setActive(subsystem, active, now);
+    apply(now);
+}
+
+void PowerManager::pulse(PowerSubsystem subsystem) {
+    uint32_t now = millis();
+    policy.pulse(subsystem, now);
+    apply(now);
+}
+
+void PowerManager::loop() {
+    apply(millis());
+}
+
+void PowerManager::account(uint32_t nowMs) {
+    uint32_t elapsed = nowMs - lastAccountMs;
+    lastAccountMs = nowMs;
+    if (applied.cpuMax || !pmEnabled) {
+        timeAtMaxMs += elapsed;
+    } else {
+        timeAtMinMs += elapsed;
+    }
+    if (lightSleepEnabled && !applied.noLightSleep) {
+        timeSleepAllowedMs += elapsed;
+    }
+}
+
+void PowerManager::apply(uint32_t nowMs) {
+    PowerLocks wanted = policy.evaluate(nowMs);
+    if (wanted == applied) {
+        return;
+    }
+
+    // Close the accounting interval under the old lock state
+    account(nowMs);
+
+#if POWER_MANAGEMENT && CONFIG_PM_ENABLE
+    updateLock(cpuMaxLock, applied.cpuMax, wanted.cpuMax);
+    updateLock(apbMaxLock, applied.apbMax, wanted.apbMax);
+    updateLock(noLightSleepLock, applied.noLightSleep, wanted.noLightSleep);
+#endif
+    applied = wanted;
+}
+
+void PowerManager::printStatus() {
+    uint32_t now = millis();
+    account(now);
+
+    DEBUG_PRINTF("Power management: %s, DFS %d-%d MHz, light sleep %s, current CPU %u MHz\n",
+                 pmEnabled ? "enabled" : "disabled", POWER_MIN_CPU_FREQ_MHZ, POWER_MAX_CPU_FREQ_MHZ,
+                 lightSleepEnabled ? "on" : "off", getCpuFrequencyMhz());
+    DEBUG_PRINT("Active:");
+    for (int i = 0; i < (int)PowerSubsystem::COUNT; i++) {
+        if (policy.isActive((PowerSubsystem)i, now)) {
+            DEBUG_PRINTF(" %s", PowerPolicy::subsystemName((PowerSubsystem)i));
+        }
+    }
+    DEBUG_PRINTLN();
+    DEBUG_PRINTF("Locks held: cpu_max %d, apb_max %d, no_light_sleep %d\n",
+                 applied.cpuMax, applied.apbMax, applied.noLightSleep);
+
+    uint64_t total = timeAtMaxMs + timeAtMinMs;
+    if (total > 0) {
+        DEBUG_PRINTF("Time at %d MHz: %u s (%u%%), at %d MHz or below: %u s (%u%%), light sleep allowed: %u s\n",
+                     POWER_MAX_CPU_FREQ_MHZ, (uint32_t)(timeAtMaxMs / 1000), (uint32_t)(timeAtMaxMs * 100 / total),
+                     POWER_MIN_CPU_FREQ_MHZ, (uint32_t)(timeAtMinMs / 1000), (uint32_t)(timeAtMinMs * 100 / total),
+                     (uint32_t)(timeSleepAllowedMs / 1000));
+    }
+
+#if POWER_MANAGEMENT && CONFIG_PM_ENABLE
+    // Includes locks held by drivers (WiFi, etc.) and, with CONFIG_PM_PROFILING,
+    // the measured time per power mode
+    esp_pm_dump_locks(stdout);
+#endif
+}
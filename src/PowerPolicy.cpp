@@ -0,0 +1,99 @@
+#include "PowerPolicy.h"
+
+static const char* const SUBSYSTEM_NAMES[(int)PowerSubsystem::COUNT] = {
+    "display", "render", "audio", "network", "touch"
+};
+
+PowerPolicy::PowerPolicy() {
+    for (int i = 0; i < (int)PowerSubsystem::COUNT; i++) {
+        states[i].held = false;
+        states[i].lastActivityMs = 0;
+        states[i].everActive = false;
+    }
+}
+
+uint32_t PowerPolicy::lingerMs(PowerSubsystem subsystem) {
+    switch (subsystem) {
+        case PowerSubsystem::RENDER:  return 100;    // Covers the frames of an animation
+        case PowerSubsystem::TOUCH:   return 3000;   // Stay responsive while the user interacts
+        case PowerSubsystem::AUDIO:   return 500;
+        case PowerSubsystem::NETWORK: return 200;
+        case PowerSubsystem::DISPLAY: return 0;
+        default:                      return 0;
+    }
+}
+
+PowerLocks PowerPolicy::locksFor(PowerSubsystem subsystem) {
+    PowerLocks locks = {false, false, false};
+    switch (subsystem) {
+        case PowerSubsystem::DISPLAY:
+            // The RGB panel is refreshed continuously by DMA from PSRAM
+            locks.noLightSleep = true;
+            break;
+        case PowerSubsystem::RENDER:
+        case PowerSubsystem::TOUCH:
+            locks.cpuMax = true;
+            break;
+        case PowerSubsystem::AUDIO:
+            // MP3 decoding needs the full clock; I2S DMA must not pause
+            locks.cpuMax = true;
+            locks.apbMax = true;
+            locks.noLightSleep = true;
+            break;
+        case PowerSubsystem::NETWORK:
+            // TLS handshakes are CPU bound; the WiFi driver holds its own locks
+            locks.cpuMax = true;
+            locks.noLightSleep = true;
+            break;
+        default:
+            break;
+    }
+    return locks;
+}
+
+void PowerPolicy::setActive(PowerSubsystem subsystem, bool active, uint32_t nowMs) {
+    SubsystemState& state = states[(int)subsystem];
+    if (state.held && !active) {
+        // Linger starts when the subsystem goes idle
+        state.lastActivityMs = nowMs;
+    }
+    if (active) {
+        state.everActive = true;
+        state.lastActivityMs = nowMs;
+    }
+    state.held = active;
+}
+
+void PowerPolicy::pulse(PowerSubsystem subsystem, uint32_t nowMs) {
+    SubsystemState& state = states[(int)subsystem];
+    state.everActive = true;
+    state.lastActivityMs = nowMs;
+}
+
+bool PowerPolicy::isActive(PowerSubsystem subsystem, uint32_t nowMs) const {
+    const SubsystemState& state = states[(int)subsystem];
+    if (state.held) {
+        return true;
+    }
+    return state.everActive && (uint32_t)(nowMs - state.lastActivityMs) < lingerMs(subsystem);
+}
+
+PowerLocks PowerPolicy::evaluate(uint32_t nowMs) const {
+    PowerLocks result = {false, false, false};
+    for (int i = 0; i < (int)PowerSubsystem::COUNT; i++) {
+        PowerSubsystem subsystem = (PowerSubsystem)i;
+        if (!isActive(subsystem, nowMs)) {
+            continue;
+        }
+        PowerLocks locks = locksFor(subsystem);
+        result.cpuMax = result.cpuMax || locks.cpuMax;
+        result.apbMax = result.apbMax || locks.apbMax;
+        result.noLightSleep = result.noLightSleep || locks.noLightSleep;
+    }
+    return result;
+}
+
+const char* PowerPolicy::subsystemName(PowerSubsystem subsystem) {
+    int index = (int)subsystem;
+    return (index >= 0 && index < (int)PowerSubsystem::COUNT) ? SUBSYSTEM_NAMES[index] : "?";
+}
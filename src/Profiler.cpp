@@ -0,0 +1,111 @@
+#include "Profiler.h"
+
+#if PROFILING
+
+#include "SerialConsole.h"
+
+// Fixed zone table - zones are registered once from function-local statics
+static ProfileZone zones[Profiler::MAX_ZONES];
+static int zoneCount = 0;
+
+static void profileCommand(const char* args) {
+    if (strcmp(args, "json") == 0) {
+        Profiler::printJson();
+    } else if (strcmp(args, "reset") == 0) {
+        Profiler::reset();
+        DEBUG_PRINTLN("Profiling zones reset");
+    } else {
+        Profiler::printReport();
+    }
+}
+
+ProfileZone* Profiler::registerZone(const char* name) {
+    // Reuse an existing slot so the same name in several places aggregates together
+    for (int i = 0; i < zoneCount; i++) {
+        if (strcmp(zones[i].name, name) == 0) {
+            return &zones[i];
+        }
+    }
+
+    if (zoneCount >= MAX_ZONES) {
+        DEBUG_PRINTF("[PROF] Zone table full, '%s' not profiled\n", name);
+        return nullptr;
+    }
+
+    ProfileZone* zone = &zones[zoneCount++];
+    memset(zone, 0, sizeof(ProfileZone));
+    zone->name = name;
+    zone->minCycles = UINT32_MAX;
+    return zone;
+}
+
+void Profiler::record(ProfileZone* zone, uint32_t cycles) {
+    if (!zone) {
+        return;
+    }
+
+    zone->count++;
+    zone->totalCycles += cycles;
+    if (cycles < zone->minCycles) zone->minCycles = cycles;
+    if (cycles > zone->maxCycles) zone->maxCycles = cycles;
+
+    int bucket = (cycles == 0) ? 0 : (31 - __builtin_clz(cycles));
+    zone->histogram[bucket]++;
+}
+
+void Profiler::begin() {
+    SerialConsole::getInstance()->registerCommand("profile", "Profiling zones ('profile json', 'profile reset')", profileCommand);
+}
+
+void Profiler::printReport() {
+    uint32_t cyclesPerUs = ESP.getCpuFreqMHz();
+
+    DEBUG_PRINTLN("Zone                       Count     Min us    Mean us     Max us");
+    for (int i = 0; i < zoneCount; i++) {
+        const ProfileZone& zone = zones[i];
+        if (zone.count == 0) {
+            DEBUG_PRINTF("%-24s %7u          -          -          -\n", zone.name, 0U);
+            continue;
+        }
+        DEBUG_PRINTF("%-24s %7u %10u %10u %10u\n", zone.name, zone.count,
+                     zone.minCycles / cyclesPerUs,
+                     (uint32_t)(zone.totalCycles / zone.count) / cyclesPerUs,
+                     zone.maxCycles / cyclesPerUs);
+
+        // Histogram: only non-empty buckets, expressed as cycle ranges
+        DEBUG_PRINT("    hist:");
+        for (int b = 0; b < ProfileZone::HISTOGRAM_BUCKETS; b++) {
+            if (zone.histogram[b] > 0) {
+                DEBUG_PRINTF(" 2^%d:%u", b, zone.histogram[b]);
+            }
+        }
+        DEBUG_PRINTLN();
+    }
+}
+
+void Profiler::printJson() {
+    DEBUG_PRINTF("{\"cpu_mhz\":%u,\"zones\":[", ESP.getCpuFreqMHz());
+    for (int i = 0; i < zoneCount; i++) {
+        const ProfileZone& zone = zones[i];
+        DEBUG_PRINTF("%s{\"name\":\"%s\",\"count\":%u,\"min\":%u,\"max\":%u,\"mean\":%u,\"hist\":[",
+                     i > 0 ? "," : "", zone.name, zone.count,
+                     zone.count ? zone.minCycles : 0, zone.maxCycles,
+                     zone.count ? (uint32_t)(zone.totalCycles / zone.count) : 0);
+        for (int b = 0; b < ProfileZone::HISTOGRAM_BUCKETS; b++) {
+            DEBUG_PRINTF("%s%u", b > 0 ? "," : "", zone.histogram[b]);
+        }
+        DEBUG_PRINT("]}");
+    }
+    DEBUG_PRINTLN("]}");
+}
+
+void Profiler::reset() {
+    for (int i = 0; i < zoneCount; i++) {
+        const char* name = zones[i].name;
+        memset(&zones[i], 0, sizeof(ProfileZone));
+        zones[i].name = name;
+        zones[i].minCycles = UINT32_MAX;
+    }
+}
+
+#endif // PROFILING
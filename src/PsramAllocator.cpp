@@ -0,0 +1,114 @@
+#include "PsramAllocator.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include "debug_config.h"
+
+#if __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
+
+static PsramStats stats = {0, 0, 0, 0};
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void trackAlloc(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    if (!esp_ptr_external_ram(ptr)) {
+        portENTER_CRITICAL(&statsMux);
+        stats.internalFallbacks++;
+        portEXIT_CRITICAL(&statsMux);
+        return;
+    }
+    size_t size = heap_caps_get_allocated_size(ptr);
+    portENTER_CRITICAL(&statsMux);
+    stats.allocations++;
+    stats.liveBytes += size;
+    if (stats.liveBytes > stats.peakBytes) stats.peakBytes = stats.liveBytes;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+static void trackFree(void* ptr) {
+    if (!ptr || !esp_ptr_external_ram(ptr)) {
+        return;
+    }
+    size_t size = heap_caps_get_allocated_size(ptr);
+    portENTER_CRITICAL(&statsMux);
+    stats.liveBytes -= size;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void* Psram::allocate(size_t size) {
+    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ptr) {
+        // No PSRAM or PSRAM exhausted - the internal heap is better than failing
+        ptr = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    trackAlloc(ptr);
+    return ptr;
+}
+
+void* Psram::reallocate(void* ptr, size_t size) {
+    if (!ptr) {
+        return allocate(size);
+    }
+    trackFree(ptr);
+    void* result = heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!result) {
+        result = heap_caps_realloc(ptr, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    // On failure the original block is still allocated
+    trackAlloc(result ? result : ptr);
+    return result;
+}
+
+void Psram::deallocate(void* ptr) {
+    trackFree(ptr);
+    heap_caps_free(ptr);
+}
+
+void Psram::getStats(PsramStats& out) {
+    portENTER_CRITICAL(&statsMux);
+    out = stats;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void Psram::printStats() {
+    PsramStats s;
+    getStats(s);
+    DEBUG_PRINTF("PSRAM-first buffers: %u bytes live, %u peak, %u allocations, %u internal fallbacks\n",
+                 s.liveBytes, s.peakBytes, s.allocations, s.internalFallbacks);
+}
+
+//##################################################################################################
+// PsramBuffer
+
+bool PsramBuffer::reserve(size_t size) {
+    if (size + 1 <= capacity) {
+        return true;
+    }
+    // Grow geometrically so streamed bodies of unknown length are not copied per chunk
+    size_t newCapacity = capacity ? capacity : 1024;
+    while (newCapacity < size + 1) {
+        newCapacity *= 2;
+    }
+    char* newData = static_cast<char*>(Psram::reallocate(data, newCapacity));
+    if (!newData) {
+        return false;
+    }
+    data = newData;
+    capacity = newCapacity;
+    return true;
+}
+
+size_t PsramBuffer::write(const uint8_t* buffer, size_t size) {
+    if (!reserve(length + size)) {
+        return 0;
+    }
+    memcpy(data + length, buffer, size);
+    length += size;
+    data[length] = '\0';
+    return size;
+}
@@ -2,9 +2,9 @@
 #include "ui.h"
 #include <vector>
 
-// Define the global station vector and playback info struct
+// Define the global station vector and playback info channel
 std::vector<Station> g_stations;
-PlaybackInfo g_playbackInfo;
+PlaybackStateChannel g_playbackState;
 
 // Populates the LVGL dropdown with station names
 void populate_station_list_for_ui(lv_obj_t *dropdown) {
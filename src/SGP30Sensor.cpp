@@ -0,0 +1,95 @@
+#include "SGP30Sensor.h"
+#include <freertos/task.h>
+#include "HardwareConfig.h"
+#include "SHT31Sensor.h"
+
+#define SGP30_CMD_IAQ_INIT      0x2003
+#define SGP30_CMD_MEASURE_IAQ   0x2008
+#define SGP30_CMD_GET_BASELINE  0x2015
+#define SGP30_CMD_SET_BASELINE  0x201E
+#define SGP30_CMD_SET_HUMIDITY  0x2061
+#define SGP30_CMD_GET_SERIAL    0x3682
+
+SGP30Sensor::SGP30Sensor(uint8_t address)
+    : device("SGP30", address, I2C_CLOCK_SGP30, I2C_TIMEOUT_MS, I2CPriority::SENSOR) {
+    memset(serial, 0, sizeof(serial));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SGP30Sensor::command(uint16_t cmd, const uint16_t* args, uint8_t argCount,
+                          uint16_t* result, uint8_t resultCount, uint16_t durationMs) {
+    // Command word followed by argument words, each with its CRC
+    uint8_t tx[2 + 2 * 3];
+    size_t txLength = 0;
+    tx[txLength++] = (uint8_t)(cmd >> 8);
+    tx[txLength++] = (uint8_t)(cmd & 0xFF);
+    for (uint8_t i = 0; i < argCount; i++) {
+        tx[txLength++] = (uint8_t)(args[i] >> 8);
+        tx[txLength++] = (uint8_t)(args[i] & 0xFF);
+        tx[txLength] = SHT31Sensor::crc8(&tx[txLength - 2], 2);   // Same Sensirion CRC
+        txLength++;
+    }
+    if (device.write(tx, txLength) != I2CResult::OK) {
+        stats.i2cErrors++;
+        return false;
+    }
+    if (durationMs > 0) {
+        vTaskDelay(pdMS_TO_TICKS(durationMs));
+    }
+    if (resultCount == 0) {
+        return true;
+    }
+
+    uint8_t rx[3 * 3];
+    if (device.read(rx, resultCount * 3) != I2CResult::OK) {
+        stats.i2cErrors++;
+        return false;
+    }
+    for (uint8_t i = 0; i < resultCount; i++) {
+        const uint8_t* word = &rx[i * 3];
+        if (SHT31Sensor::crc8(word, 2) != word[2]) {
+            stats.crcErrors++;
+            return false;
+        }
+        result[i] = ((uint16_t)word[0] << 8) | word[1];
+    }
+    return true;
+}
+
+bool SGP30Sensor::begin() {
+    if (!command(SGP30_CMD_GET_SERIAL, nullptr, 0, serial, 3, 1)) {
+        return false;
+    }
+    return command(SGP30_CMD_IAQ_INIT, nullptr, 0, nullptr, 0, 10);
+}
+
+bool SGP30Sensor::measureIAQ(uint16_t* eco2, uint16_t* tvoc) {
+    uint16_t words[2];
+    if (!command(SGP30_CMD_MEASURE_IAQ, nullptr, 0, words, 2, 12)) {
+        return false;
+    }
+    *eco2 = words[0];
+    *tvoc = words[1];
+    stats.measurements++;
+    return true;
+}
+
+bool SGP30Sensor::setHumidity(uint16_t absoluteHumidity) {
+    return command(SGP30_CMD_SET_HUMIDITY, &absoluteHumidity, 1, nullptr, 0, 10);
+}
+
+bool SGP30Sensor::getBaseline(uint16_t* eco2Baseline, uint16_t* tvocBaseline) {
+    uint16_t words[2];
+    if (!command(SGP30_CMD_GET_BASELINE, nullptr, 0, words, 2, 10)) {
+        return false;
+    }
+    *eco2Baseline = words[0];
+    *tvocBaseline = words[1];
+    return true;
+}
+
+bool SGP30Sensor::setBaseline(uint16_t eco2Baseline, uint16_t tvocBaseline) {
+    // The sensor expects the words in reverse order of get_iaq_baseline
+    uint16_t words[2] = {tvocBaseline, eco2Baseline};
+    return command(SGP30_CMD_SET_BASELINE, words, 2, nullptr, 0, 10);
+}
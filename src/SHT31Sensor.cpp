@@ -0,0 +1,96 @@
+#include "SHT31Sensor.h"
+#include <freertos/task.h>
+#include "HardwareConfig.h"
+
+#define SHT31_CMD_SINGLE_SHOT_HIGH 0x2400   // High repeatability, clock stretching disabled
+#define SHT31_CMD_SOFT_RESET       0x30A2
+#define SHT31_CMD_READ_STATUS      0xF32D
+
+SHT31Sensor::SHT31Sensor(uint8_t address)
+    : device("SHT31", address, I2C_CLOCK_SHT31, I2C_TIMEOUT_MS, I2CPriority::SENSOR),
+      measuring(false), startMs(0), temperatureCenti(0), humidityCenti(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint8_t SHT31Sensor::crc8(const uint8_t* data, size_t length) {
+    uint8_t crc = 0xFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+I2CResult SHT31Sensor::command(uint16_t cmd) {
+    uint8_t buffer[2] = {(uint8_t)(cmd >> 8), (uint8_t)(cmd & 0xFF)};
+    return device.write(buffer, sizeof(buffer));
+}
+
+bool SHT31Sensor::begin() {
+    if (command(SHT31_CMD_SOFT_RESET) != I2CResult::OK) {
+        return false;
+    }
+    // The reset takes at most 1.5 ms; the status read below NACKs until done
+    uint8_t cmd[2] = {(uint8_t)(SHT31_CMD_READ_STATUS >> 8), (uint8_t)(SHT31_CMD_READ_STATUS & 0xFF)};
+    uint8_t status[3];
+    for (int attempt = 0; attempt < 5; attempt++) {
+        if (device.writeRead(cmd, sizeof(cmd), status, sizeof(status)) == I2CResult::OK) {
+            return crc8(status, 2) == status[2];
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return false;
+}
+
+bool SHT31Sensor::startMeasurement(uint32_t nowMs) {
+    if (measuring) {
+        return false;
+    }
+    if (command(SHT31_CMD_SINGLE_SHOT_HIGH) != I2CResult::OK) {
+        stats.i2cErrors++;
+        return false;
+    }
+    measuring = true;
+    startMs = nowMs;
+    return true;
+}
+
+bool SHT31Sensor::poll(uint32_t nowMs) {
+    uint32_t elapsed = nowMs - startMs;
+    if (!measuring || elapsed < SHT31_CONVERSION_MS) {
+        return false;
+    }
+
+    uint8_t data[6];
+    I2CResult result = device.read(data, sizeof(data));
+    if (result == I2CResult::NACK) {
+        // Still converting; try again on a later tick
+        stats.notReady++;
+        if (elapsed >= SHT31_MEASURE_TIMEOUT_MS) {
+            stats.timeouts++;
+            measuring = false;
+        }
+        return false;
+    }
+    measuring = false;
+    if (result != I2CResult::OK) {
+        stats.i2cErrors++;
+        return false;
+    }
+    if (crc8(&data[0], 2) != data[2] || crc8(&data[3], 2) != data[5]) {
+        stats.crcErrors++;
+        return false;
+    }
+
+    // T = -45 + 175 * raw / 65535, RH = 100 * raw / 65535
+    uint32_t rawT = ((uint32_t)data[0] << 8) | data[1];
+    uint32_t rawRH = ((uint32_t)data[3] << 8) | data[4];
+    temperatureCenti = (int16_t)((int32_t)((17500UL * rawT) / 65535UL) - 4500);
+    humidityCenti = (uint16_t)((10000UL * rawRH) / 65535UL);
+
+    stats.measurements++;
+    stats.lastConversionMs = elapsed;
+    return true;
+}
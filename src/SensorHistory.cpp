@@ -0,0 +1,501 @@
+#include "SensorHistory.h"
+#include <SD.h>
+#include <freertos/task.h>
+#include "SensorTask.h"
+#include "PsramAllocator.h"
+#include "SerialConsole.h"
+#include "DeferredLog.h"
+#include "Profiler.h"
+
+static_assert(sizeof(HistoryRecord) == 32, "HistoryRecord is stored on SD as-is");
+
+static const uint32_t TIER_RESOLUTION[] = {60, 900, 3600};
+static const uint32_t TIER_CAPACITY[] = {24 * 60, 7 * 24 * 4, 365 * 24};
+static const char* const TIER_FILE[] = {
+    HISTORY_DIRECTORY "/minute.bin",
+    HISTORY_DIRECTORY "/quarter.bin",
+    HISTORY_DIRECTORY "/hour.bin"
+};
+static const char* const TIER_NAME[] = {"1 min", "15 min", "1 h"};
+
+#define HISTORY_COMPACT_TMP     HISTORY_DIRECTORY "/compact.tmp"
+#define HISTORY_READ_CHUNK      32      // Records per SD read while loading
+
+struct HistoryFileHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t tier;
+    uint16_t recordSize;
+};
+
+// Ring slots: written by the loop task, copied by the writer while compacting
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Initialize static singleton instance to nullptr
+SensorHistory* SensorHistory::_instance = nullptr;
+
+static void historyCommand(const char* args) {
+    if (strcmp(args, "flush") == 0) {
+        SensorHistory::getInstance()->flush();
+    }
+    SensorHistory::getInstance()->printStats();
+}
+
+static int16_t saturate(int32_t value) {
+    return (int16_t)constrain(value, (int32_t)-32768, (int32_t)32767);
+}
+
+SensorHistory::SensorHistory()
+    : lastSensorSequence(0), queue(nullptr), syncDone(nullptr), taskHandle(nullptr),
+      samplesAdded(0), recordsLoaded(0), recordsWritten(0),
+      writeErrors(0), compactions(0), discardedBuckets(0), queueFull(0) {
+    memset(tiers, 0, sizeof(tiers));
+}
+
+SensorHistory* SensorHistory::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new SensorHistory();
+    }
+    return _instance;
+}
+
+uint32_t SensorHistory::getResolution(HistoryTier tier) {
+    return TIER_RESOLUTION[(int)tier];
+}
+
+uint32_t SensorHistory::getCapacity(HistoryTier tier) {
+    return TIER_CAPACITY[(int)tier];
+}
+
+bool SensorHistory::begin() {
+    bool ok = true;
+    if (!SD.exists(HISTORY_DIRECTORY)) {
+        SD.mkdir(HISTORY_DIRECTORY);
+    }
+    for (int t = 0; t < (int)HistoryTier::COUNT; t++) {
+        size_t bytes = TIER_CAPACITY[t] * sizeof(HistoryRecord);
+        tiers[t].ring = static_cast<HistoryRecord*>(Psram::allocate(bytes));
+        if (tiers[t].ring == nullptr) {
+            LOG_ERROR(SENSOR, "History: no memory for %s ring (%u bytes)", TIER_NAME[t], (unsigned)bytes);
+            ok = false;
+            continue;
+        }
+        memset(tiers[t].ring, 0, bytes);
+        loadTier(t);
+    }
+    LOG_INFO(SENSOR, "History: %u records reloaded from SD", recordsLoaded);
+
+    // From here on the files belong to the writer task
+    queue = xQueueCreate(HISTORY_QUEUE_LENGTH, sizeof(Batch));
+    syncDone = xSemaphoreCreateBinary();
+    if (queue == nullptr || syncDone == nullptr ||
+        xTaskCreate(taskFunction, "HistoryTask", HISTORY_TASK_STACK_SIZE, this, HISTORY_TASK_PRIORITY,
+                    &taskHandle) != pdPASS) {
+        LOG_ERROR(SENSOR, "History: writer task not started, records stay in RAM");
+        ok = false;
+    }
+
+    ClockService::getInstance()->subscribe(CLOCK_SECOND, clockCallback, this);
+    SerialConsole::getInstance()->registerCommand("history", "Sensor history rings ('history flush')", historyCommand);
+    return ok;
+}
+
+void SensorHistory::clockCallback(const ClockSnapshot& clock, uint8_t events, void* context) {
+    (void)events;
+    SensorHistory* self = static_cast<SensorHistory*>(context);
+    if (!clock.valid) {
+        return;
+    }
+
+    // Only new sensor data; a stalled or missing sensor adds nothing
+    SensorSnapshot snapshot;
+    SensorTask::getInstance()->getSnapshot(snapshot);
+    if (snapshot.sequence == self->lastSensorSequence) {
+        return;
+    }
+    self->lastSensorSequence = snapshot.sequence;
+
+    int16_t values[(int)HistoryChannel::COUNT];
+    values[(int)HistoryChannel::TEMPERATURE] = snapshot.temperatureCenti;
+    values[(int)HistoryChannel::HUMIDITY] = saturate(snapshot.humidityCenti);
+    values[(int)HistoryChannel::TVOC] = saturate(snapshot.tvoc);
+    values[(int)HistoryChannel::ECO2] = saturate(snapshot.eco2);
+
+    uint8_t mask = 0;
+    if (snapshot.climateValid) {
+        mask |= (1 << (int)HistoryChannel::TEMPERATURE) | (1 << (int)HistoryChannel::HUMIDITY);
+    }
+    if (snapshot.airValid) {
+        mask |= (1 << (int)HistoryChannel::TVOC) | (1 << (int)HistoryChannel::ECO2);
+    }
+    if (mask != 0) {
+        self->addSample(clock.epoch, values, mask);
+    }
+}
+
+void SensorHistory::addSample(time_t epoch, const int16_t* values, uint8_t channelMask) {
+    samplesAdded++;
+    bool batchFull = false;
+
+    for (int t = 0; t < (int)HistoryTier::COUNT; t++) {
+        if (tiers[t].ring == nullptr) {
+            continue;
+        }
+        Accumulator& open = tiers[t].open;
+        uint32_t bucket = (uint32_t)epoch / TIER_RESOLUTION[t];
+
+        if (bucket != open.bucket) {
+            if (bucket < open.bucket) {
+                // Clock went backwards: the open bucket no longer fits anywhere
+                discardedBuckets++;
+            } else if (open.samples > 0) {
+                closeBucket(t);
+            }
+            memset(&open, 0, sizeof(open));
+            open.bucket = bucket;
+        }
+
+        open.samples++;
+        for (int c = 0; c < (int)HistoryChannel::COUNT; c++) {
+            if (!(channelMask & (1 << c))) {
+                continue;
+            }
+            int16_t v = values[c];
+            if (open.counts[c] == 0 || v < open.min[c]) {
+                open.min[c] = v;
+            }
+            if (open.counts[c] == 0 || v > open.max[c]) {
+                open.max[c] = v;
+            }
+            open.sum[c] += v;
+            open.counts[c]++;
+        }
+
+        if (tiers[t].pendingCount >= HISTORY_FLUSH_BATCH) {
+            batchFull = true;
+        }
+    }
+
+    // A full minute batch takes the coarser tiers along. If the writer is
+    // behind, the records stay pending and go with the next sample.
+    if (batchFull) {
+        for (int t = 0; t < (int)HistoryTier::COUNT; t++) {
+            queuePending(t, 0);
+        }
+    }
+}
+
+void SensorHistory::toRecord(const Accumulator& open, HistoryRecord& record) {
+    memset(&record, 0, sizeof(record));
+    record.bucket = open.bucket;
+    record.samples = open.samples;
+    for (int c = 0; c < (int)HistoryChannel::COUNT; c++) {
+        if (open.counts[c] == 0) {
+            continue;
+        }
+        record.channelMask |= 1 << c;
+        record.stats[c].min = open.min[c];
+        record.stats[c].max = open.max[c];
+        // Rounded to nearest
+        int32_t half = open.sum[c] >= 0 ? open.counts[c] / 2 : -(open.counts[c] / 2);
+        record.stats[c].avg = saturate((open.sum[c] + half) / open.counts[c]);
+    }
+}
+
+void SensorHistory::store(int t, const HistoryRecord& record) {
+    HistoryRecord& slot = tiers[t].ring[record.bucket % TIER_CAPACITY[t]];
+    portENTER_CRITICAL(&ringMux);
+    if (slot.bucket == 0) {
+        tiers[t].stored++;
+    }
+    slot = record;
+    portEXIT_CRITICAL(&ringMux);
+}
+
+void SensorHistory::closeBucket(int t) {
+    HistoryRecord record;
+    toRecord(tiers[t].open, record);
+    store(t, record);
+
+    Tier& tier = tiers[t];
+    if (tier.pendingCount < HISTORY_FLUSH_BATCH) {
+        tier.pending[tier.pendingCount++] = record;
+    }
+}
+
+void SensorHistory::closeOpenBuckets() {
+    for (int t = 0; t < (int)HistoryTier::COUNT; t++) {
+        Accumulator& open = tiers[t].open;
+        if (tiers[t].ring == nullptr || open.samples == 0) {
+            continue;
+        }
+        closeBucket(t);
+        // Later samples of the same bucket would start it over
+        uint32_t bucket = open.bucket;
+        memset(&open, 0, sizeof(open));
+        open.bucket = bucket;
+    }
+}
+
+size_t SensorHistory::query(HistoryTier tier, time_t from, time_t to, HistoryRecord* out, size_t maxRecords) {
+    int t = (int)tier;
+    const Tier& ring = tiers[t];
+    if (ring.ring == nullptr || to < from || maxRecords == 0) {
+        return 0;
+    }
+
+    uint32_t first = (uint32_t)from / TIER_RESOLUTION[t];
+    uint32_t last = (uint32_t)to / TIER_RESOLUTION[t];
+    // Buckets older than one ring length have been overwritten
+    uint32_t newest = ring.open.bucket > last ? ring.open.bucket : last;
+    if (newest >= TIER_CAPACITY[t] && first <= newest - TIER_CAPACITY[t]) {
+        first = newest - TIER_CAPACITY[t] + 1;
+    }
+
+    size_t count = 0;
+    for (uint32_t bucket = first; bucket <= last && count < maxRecords; bucket++) {
+        if (bucket == ring.open.bucket) {
+            if (ring.open.samples > 0) {
+                toRecord(ring.open, out[count++]);
+            }
+            continue;
+        }
+        const HistoryRecord& slot = ring.ring[bucket % TIER_CAPACITY[t]];
+        if (slot.bucket == bucket) {
+            out[count++] = slot;
+        }
+    }
+    return count;
+}
+
+//##################################################################################################
+// SD persistence
+
+bool SensorHistory::loadTier(int t) {
+    File file = SD.open(TIER_FILE[t], FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    HistoryFileHeader header;
+    size_t size = file.size();
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != HISTORY_FILE_MAGIC || header.version != HISTORY_FILE_VERSION ||
+        header.tier != t || header.recordSize != sizeof(HistoryRecord)) {
+        file.close();
+        LOG_WARN(SENSOR, "History: %s has an unknown format, starting over", TIER_FILE[t]);
+        SD.remove(TIER_FILE[t]);
+        return false;
+    }
+
+    // A torn record at the end (power loss or a failed append) is ignored, and
+    // the file is rewritten below so later appends start on a record boundary
+    uint32_t available = (size - sizeof(header)) / sizeof(HistoryRecord);
+    tiers[t].misaligned = (size - sizeof(header)) % sizeof(HistoryRecord) != 0;
+    uint32_t skip = available > TIER_CAPACITY[t] ? available - TIER_CAPACITY[t] : 0;
+    file.seek(sizeof(header) + skip * sizeof(HistoryRecord));
+    tiers[t].fileRecords = available;
+
+    HistoryRecord chunk[HISTORY_READ_CHUNK];
+    uint32_t remaining = available - skip;
+    while (remaining > 0) {
+        uint32_t n = remaining < HISTORY_READ_CHUNK ? remaining : HISTORY_READ_CHUNK;
+        size_t bytes = n * sizeof(HistoryRecord);
+        if (file.read((uint8_t*)chunk, bytes) != bytes) {
+            break;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i].bucket == 0) {
+                continue;
+            }
+            // Keep the newer record if the clock was ever set back
+            const HistoryRecord& slot = tiers[t].ring[chunk[i].bucket % TIER_CAPACITY[t]];
+            if (chunk[i].bucket >= slot.bucket) {
+                store(t, chunk[i]);
+                recordsLoaded++;
+            }
+        }
+        remaining -= n;
+    }
+    file.close();
+
+    if (tiers[t].misaligned) {
+        LOG_WARN(SENSOR, "History: %s ends with a partial record", TIER_FILE[t]);
+        uint32_t newest = 0;
+        for (uint32_t i = 0; i < TIER_CAPACITY[t]; i++) {
+            if (tiers[t].ring[i].bucket > newest) {
+                newest = tiers[t].ring[i].bucket;
+            }
+        }
+        compactTier(t, newest);
+    }
+    return true;
+}
+
+bool SensorHistory::queuePending(int t, TickType_t wait) {
+    Tier& tier = tiers[t];
+    if (tier.pendingCount == 0) {
+        return true;
+    }
+    if (queue == nullptr) {
+        return false;
+    }
+    Batch batch;
+    batch.tier = (uint8_t)t;
+    batch.count = tier.pendingCount;
+    batch.sync = false;
+    memcpy(batch.records, tier.pending, tier.pendingCount * sizeof(HistoryRecord));
+    if (xQueueSend(queue, &batch, wait) != pdTRUE) {
+        queueFull++;
+        return false;
+    }
+    tier.pendingCount = 0;
+    return true;
+}
+
+void SensorHistory::taskFunction(void* parameter) {
+    SensorHistory* self = static_cast<SensorHistory*>(parameter);
+    Batch batch;
+    for (;;) {
+        if (xQueueReceive(self->queue, &batch, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (batch.count > 0) {
+            self->appendTier(batch);
+        }
+        if (batch.sync) {
+            xSemaphoreGive(self->syncDone);
+        }
+    }
+}
+
+// Writer task
+bool SensorHistory::appendTier(const Batch& batch) {
+    int t = batch.tier;
+    Tier& tier = tiers[t];
+    uint32_t newest = batch.records[batch.count - 1].bucket;
+
+    // Appending to a file with a partial record would shift every later
+    // record; the batch is already in the ring, so rewrite instead
+    if (tier.misaligned) {
+        return compactTier(t, newest);
+    }
+
+    File file = SD.open(TIER_FILE[t], FILE_APPEND);
+    bool opened = (bool)file;
+    bool ok = opened;
+    if (ok && file.size() == 0) {
+        HistoryFileHeader header = {HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, (uint8_t)t, sizeof(HistoryRecord)};
+        ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    }
+    if (ok) {
+        size_t bytes = batch.count * sizeof(HistoryRecord);
+        ok = file.write((const uint8_t*)batch.records, bytes) == bytes;
+    }
+    if (file) {
+        file.close();
+    }
+
+    // The records stay in the ring either way; a failed batch is not retried
+    if (ok) {
+        recordsWritten += batch.count;
+        tier.fileRecords += batch.count;
+    } else {
+        writeErrors++;
+        if (opened) {
+            // A short write may have left part of the batch behind: rewrite the
+            // file from the ring (retried with the next batch if that fails too)
+            tier.misaligned = true;
+            compactTier(t, newest);
+            return false;
+        }
+    }
+
+    if (ok && tier.fileRecords >= 2 * TIER_CAPACITY[t]) {
+        compactTier(t, newest);
+    }
+    return ok;
+}
+
+// Writer task, or the loop task while loading. 'newest' is the newest bucket
+// to keep; newer slots are still queued and get appended afterwards.
+bool SensorHistory::compactTier(int t, uint32_t newest) {
+    const Tier& tier = tiers[t];
+    File file = SD.open(HISTORY_COMPACT_TMP, FILE_WRITE);
+    if (!file) {
+        writeErrors++;
+        return false;
+    }
+    HistoryFileHeader header = {HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, (uint8_t)t, sizeof(HistoryRecord)};
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+    // Oldest first, copied out of the ring a chunk at a time so the loop
+    // task is never held up by the SD card
+    HistoryRecord chunk[HISTORY_READ_CHUNK];
+    uint32_t oldest = newest - TIER_CAPACITY[t] + 1;
+    uint32_t written = 0;
+    for (uint32_t base = 0; ok && base < TIER_CAPACITY[t]; base += HISTORY_READ_CHUNK) {
+        uint32_t n = min((uint32_t)HISTORY_READ_CHUNK, TIER_CAPACITY[t] - base);
+        portENTER_CRITICAL(&ringMux);
+        for (uint32_t i = 0; i < n; i++) {
+            chunk[i] = tier.ring[(oldest + base + i) % TIER_CAPACITY[t]];
+        }
+        portEXIT_CRITICAL(&ringMux);
+
+        for (uint32_t i = 0; ok && i < n; i++) {
+            uint32_t bucket = oldest + base + i;
+            if (chunk[i].bucket == bucket && bucket != 0) {
+                ok = file.write((const uint8_t*)&chunk[i], sizeof(chunk[i])) == sizeof(chunk[i]);
+                written++;
+            }
+        }
+    }
+    file.close();
+
+    if (!ok || !SD.remove(TIER_FILE[t]) || !SD.rename(HISTORY_COMPACT_TMP, TIER_FILE[t])) {
+        writeErrors++;
+        SD.remove(HISTORY_COMPACT_TMP);
+        return false;
+    }
+    tiers[t].fileRecords = written;
+    tiers[t].misaligned = false;
+    compactions++;
+    LOG_INFO(SENSOR, "History: %s compacted to %u records", TIER_FILE[t], written);
+    return true;
+}
+
+bool SensorHistory::flush() {
+    PROFILE_ZONE("history.flush");
+    if (queue == nullptr || syncDone == nullptr) {
+        return false;
+    }
+    TickType_t timeout = pdMS_TO_TICKS(HISTORY_SYNC_TIMEOUT_MS);
+    bool queued = true;
+    for (int t = 0; t < (int)HistoryTier::COUNT; t++) {
+        queued = queuePending(t, timeout) && queued;
+    }
+
+    // Everything queued so far is written once the marker comes back
+    Batch marker;
+    marker.tier = 0;
+    marker.count = 0;
+    marker.sync = true;
+    xSemaphoreTake(syncDone, 0);    // Left over from a flush that timed out
+    if (xQueueSend(queue, &marker, timeout) != pdTRUE || xSemaphoreTake(syncDone, timeout) != pdTRUE) {
+        LOG_WARN(SENSOR, "History: SD writer did not finish within %u ms", HISTORY_SYNC_TIMEOUT_MS);
+        return false;
+    }
+    return queued;
+}
+
+void SensorHistory::printStats() {
+    DEBUG_PRINTF("History: %u samples, %u records loaded, %u written, %u write errors, %u compactions, %u discarded, %u writer busy\n",
+                 samplesAdded, recordsLoaded, recordsWritten, writeErrors, compactions, discardedBuckets, queueFull);
+    DEBUG_PRINTLN("Tier    Slots  Stored  Pending  File  Open samples");
+    for (int t = 0; t < (int)HistoryTier::COUNT; t++) {
+        const Tier& tier = tiers[t];
+        DEBUG_PRINTF("%-6s  %5u  %6u  %7u  %4u  %12u%s\n", TIER_NAME[t], TIER_CAPACITY[t], tier.stored,
+                     tier.pendingCount, tier.fileRecords, tier.open.samples,
+                     tier.ring ? "" : "  (no memory)");
+    }
+}
@@ -0,0 +1,224 @@
+#include "SensorTask.h"
+#include <Preferences.h>
+#include "SerialConsole.h"
+#include "DeferredLog.h"
+
+// Saturation vapour density from -20 to 60 degrees Celsius in 2 degree steps,
+// in units of 0.01 g/m^3 (Magnus formula). Linear interpolation stays within 0.5 %.
+static const uint16_t SATURATION_TABLE[] = {
+    108, 127, 149, 174, 203, 236, 274, 317, 366, 422, 485, 556, 636, 725,
+    826, 938, 1064, 1204, 1360, 1533, 1724, 1936, 2171, 2429, 2714, 3026, 3370,
+    3746, 4158, 4607, 5098, 5633, 6215, 6848, 7534, 8278, 9084, 9955, 10896,
+    11911, 13005
+};
+static const int16_t SATURATION_MIN_CENTI = -2000;
+static const int16_t SATURATION_STEP_CENTI = 200;
+static const int SATURATION_ENTRIES = sizeof(SATURATION_TABLE) / sizeof(SATURATION_TABLE[0]);
+
+// Guards the published snapshot
+static portMUX_TYPE snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Initialize static singleton instance to nullptr
+SensorTask* SensorTask::_instance = nullptr;
+
+static void sensorsCommand(const char* args) {
+    (void)args;
+    SensorTask::getInstance()->printStats();
+}
+
+// Exponential moving average with 8 fractional bits
+static uint16_t emaUpdate(int32_t& average, uint16_t sample) {
+    average += (((int32_t)sample << 8) - average) >> SENSOR_EMA_SHIFT;
+    return (uint16_t)((average + 128) >> 8);
+}
+
+SensorTask::SensorTask()
+    : sht31Present(false), sgp30Present(false), taskHandle(nullptr),
+      eco2Average(0), tvocAverage(0), samples(0), lastHumiditySent(0), lastBaselineTime(0),
+      overruns(0), maxCycleUs(0), humidityUpdates(0), baselineSaves(0) {
+    memset(&working, 0, sizeof(working));
+    memset(&published, 0, sizeof(published));
+}
+
+SensorTask* SensorTask::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new SensorTask();
+    }
+    return _instance;
+}
+
+uint16_t SensorTask::absoluteHumidity(int16_t temperatureCenti, uint16_t humidityCenti) {
+    int32_t offset = (int32_t)temperatureCenti - SATURATION_MIN_CENTI;
+    int32_t maxOffset = (int32_t)(SATURATION_ENTRIES - 1) * SATURATION_STEP_CENTI;
+    offset = constrain(offset, (int32_t)0, maxOffset);
+    int index = offset / SATURATION_STEP_CENTI;
+    int32_t fraction = offset % SATURATION_STEP_CENTI;
+    if (index == SATURATION_ENTRIES - 1) {
+        index--;
+        fraction = SATURATION_STEP_CENTI;
+    }
+
+    // Saturation density in 0.01 g/m^3 scaled by the step (200)
+    uint32_t saturation = (uint32_t)SATURATION_TABLE[index] * (SATURATION_STEP_CENTI - fraction) +
+                          (uint32_t)SATURATION_TABLE[index + 1] * fraction;
+
+    // saturation * RH[0.1 %] / (100 * 200 * 1000) g/m^3, times 256 for 8.8
+    uint32_t scaled = saturation * (humidityCenti / 10);
+    uint32_t result = (scaled + 39062) / 78125;
+    return result > 0xFFFF ? 0xFFFF : (uint16_t)result;
+}
+
+bool SensorTask::begin() {
+    sht31Present = sht31.begin();
+    if (!sht31Present) {
+        LOG_WARN(SENSOR, "SHT31 not found, humidity compensation disabled");
+    }
+
+    sgp30Present = sgp30.begin();
+    if (!sgp30Present) {
+        LOG_WARN(SENSOR, "SGP30 not found");
+    } else {
+        const uint16_t* serial = sgp30.getSerial();
+        LOG_INFO(SENSOR, "SGP30 serial %04X%04X%04X", serial[0], serial[1], serial[2]);
+
+        // Restore the IAQ baseline from non-volatile storage
+        Preferences preferences;
+        preferences.begin("sgp30", false);
+        uint16_t eco2Baseline = preferences.getUInt("eco2_base", 0);
+        uint16_t tvocBaseline = preferences.getUInt("tvoc_base", 0);
+        preferences.end();
+        if (eco2Baseline > 0 && tvocBaseline > 0) {
+            LOG_INFO(SENSOR, "Setting SGP30 baselines: eCO2=0x%X, TVOC=0x%X", eco2Baseline, tvocBaseline);
+            sgp30.setBaseline(eco2Baseline, tvocBaseline);
+        }
+    }
+    lastBaselineTime = ::millis();
+
+    if (sht31Present || sgp30Present) {
+        xTaskCreate(taskFunction, "SensorTask", SENSOR_TASK_STACK_SIZE, this, SENSOR_TASK_PRIORITY, &taskHandle);
+    }
+    SerialConsole::getInstance()->registerCommand("sensors", "Sensor sampling statistics", sensorsCommand);
+    return sht31Present && sgp30Present;
+}
+
+void SensorTask::getSnapshot(SensorSnapshot& snapshot) {
+    portENTER_CRITICAL(&snapshotMux);
+    snapshot = published;
+    portEXIT_CRITICAL(&snapshotMux);
+}
+
+void SensorTask::taskFunction(void* parameter) {
+    SensorTask* self = static_cast<SensorTask*>(parameter);
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        uint32_t startUs = micros();
+        self->sample();
+        uint32_t cycleUs = micros() - startUs;
+        if (cycleUs > self->maxCycleUs) {
+            self->maxCycleUs = cycleUs;
+        }
+
+        // Fixed-rate schedule. After an overrun the period restarts from now,
+        // so the next sample still waits a full period and lower-priority
+        // tasks get the CPU instead of a back-to-back catch-up burst.
+        TickType_t period = pdMS_TO_TICKS(SENSOR_SAMPLE_PERIOD_MS);
+        if (xTaskGetTickCount() - lastWake >= period) {
+            self->overruns++;
+            lastWake = xTaskGetTickCount();
+        }
+        vTaskDelayUntil(&lastWake, period);
+    }
+}
+
+void SensorTask::sample() {
+    // The SHT31 converts while the SGP30 IAQ step runs
+    if (sht31Present) {
+        sht31.startMeasurement(::millis());
+    }
+
+    uint16_t eco2 = 0;
+    uint16_t tvoc = 0;
+    bool measured = sgp30Present && sgp30.measureIAQ(&eco2, &tvoc);
+    if (measured) {
+        samples++;
+        if (samples <= SGP30_WARMUP_SAMPLES) {
+            // Start the averages from the first real output
+            eco2Average = (int32_t)eco2 << 8;
+            tvocAverage = (int32_t)tvoc << 8;
+        } else {
+            working.eco2 = emaUpdate(eco2Average, eco2);
+            working.tvoc = emaUpdate(tvocAverage, tvoc);
+            working.airValid = true;
+        }
+    }
+
+    while (sht31.isBusy()) {
+        if (sht31.poll(::millis())) {
+            working.temperatureCenti = sht31.getTemperatureCenti();
+            working.humidityCenti = sht31.getHumidityCenti();
+            working.absoluteHumidity = absoluteHumidity(working.temperatureCenti, working.humidityCenti);
+            working.climateValid = true;
+
+            // Compensation applies from the next IAQ step
+            uint16_t ah = working.absoluteHumidity;
+            uint16_t change = ah > lastHumiditySent ? ah - lastHumiditySent : lastHumiditySent - ah;
+            if (sgp30Present && ah > 0 && change >= SENSOR_AH_HYSTERESIS && sgp30.setHumidity(ah)) {
+                lastHumiditySent = ah;
+                humidityUpdates++;
+            }
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+
+    working.sequence++;
+    portENTER_CRITICAL(&snapshotMux);
+    published = working;
+    portEXIT_CRITICAL(&snapshotMux);
+
+    if (measured && (::millis() - lastBaselineTime) >= SGP30_BASELINE_INTERVAL_MS) {
+        lastBaselineTime = ::millis();
+        saveBaseline();
+    }
+}
+
+void SensorTask::saveBaseline() {
+    uint16_t eco2Baseline;
+    uint16_t tvocBaseline;
+    if (!sgp30.getBaseline(&eco2Baseline, &tvocBaseline)) {
+        LOG_WARN(SENSOR, "Failed to get SGP30 baseline values");
+        return;
+    }
+
+    // Store the baseline values in non-volatile storage
+    Preferences preferences;
+    preferences.begin("sgp30", false);
+    preferences.putUInt("eco2_base", eco2Baseline);
+    preferences.putUInt("tvoc_base", tvocBaseline);
+    preferences.end();
+    baselineSaves++;
+    LOG_INFO(SENSOR, "SGP30 baselines saved: eCO2=0x%X, TVOC=0x%X", eco2Baseline, tvocBaseline);
+}
+
+void SensorTask::printStats() {
+    SensorSnapshot s;
+    getSnapshot(s);
+    DEBUG_PRINTF("Sensor task: %s, %u samples, %u overruns, max cycle %u us\n",
+                 taskHandle ? "running" : "not started", samples, overruns, maxCycleUs);
+    DEBUG_PRINTF("Climate: %d.%02d C, %u.%02u %%RH, AH %u.%02u g/m3%s\n",
+                 s.temperatureCenti / 100, abs(s.temperatureCenti % 100),
+                 s.humidityCenti / 100, s.humidityCenti % 100,
+                 s.absoluteHumidity >> 8, ((s.absoluteHumidity & 0xFF) * 100) >> 8,
+                 s.climateValid ? "" : " (no data)");
+    DEBUG_PRINTF("Air (EMA 1/%d): eCO2 %u ppm, TVOC %u ppb%s\n", 1 << SENSOR_EMA_SHIFT,
+                 s.eco2, s.tvoc, s.airValid ? "" : " (warming up)");
+
+    const SHT31Stats& t = sht31.getStats();
+    DEBUG_PRINTF("SHT31 %s: %u measurements, %u not ready, %u CRC, %u I2C errors, %u timeouts, last %u ms\n",
+                 sht31Present ? "ok" : "missing", t.measurements, t.notReady, t.crcErrors,
+                 t.i2cErrors, t.timeouts, t.lastConversionMs);
+    const SGP30Stats& g = sgp30.getStats();
+    DEBUG_PRINTF("SGP30 %s: %u measurements, %u CRC, %u I2C errors, %u humidity updates, %u baseline saves\n",
+                 sgp30Present ? "ok" : "missing", g.measurements, g.crcErrors, g.i2cErrors,
+                 humidityUpdates, baselineSaves);
+}
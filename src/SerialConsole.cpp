@@ -0,0 +1,90 @@
+#include "SerialConsole.h"
+#include "debug_config.h"
+
+// Initialize static singleton instance to nullptr
+SerialConsole* SerialConsole::_instance = nullptr;
+
+static void helpCommand(const char* args) {
+    (void)args;
+    SerialConsole::getInstance()->printHelp();
+}
+
+SerialConsole::SerialConsole() {
+    registerCommand("help", "List available commands", helpCommand);
+}
+
+SerialConsole* SerialConsole::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new SerialConsole();
+    }
+    return _instance;
+}
+
+bool SerialConsole::registerCommand(const char* name, const char* help, ConsoleCommandHandler handler) {
+    if (commandCount >= MAX_COMMANDS || !name || !handler) {
+        return false;
+    }
+    commands[commandCount].name = name;
+    commands[commandCount].help = help;
+    commands[commandCount].handler = handler;
+    commandCount++;
+    return true;
+}
+
+void SerialConsole::loop() {
+    poll(Serial, usbLine);
+    poll(Serial0, uartLine);
+}
+
+void SerialConsole::poll(Stream& stream, LineBuffer& line) {
+    // Only consume what is already buffered - never block the loop task
+    int pending = stream.available();
+    while (pending-- > 0) {
+        int c = stream.read();
+        if (c < 0) {
+            break;
+        }
+
+        if (c == '\r' || c == '\n') {
+            if (line.length > 0) {
+                line.data[line.length] = '\0';
+                line.length = 0;
+                dispatch(line.data);
+            }
+        } else if (line.length < MAX_LINE_LENGTH - 1) {
+            line.data[line.length++] = (char)c;
+        }
+        // Characters beyond the line limit are dropped until the next newline
+    }
+}
+
+void SerialConsole::dispatch(char* line) {
+    // Split "name args..." in place
+    while (*line == ' ') line++;
+    char* args = line;
+    while (*args && *args != ' ') args++;
+    if (*args) {
+        *args++ = '\0';
+        while (*args == ' ') args++;
+    }
+
+    if (*line == '\0') {
+        return;
+    }
+
+    for (int i = 0; i < commandCount; i++) {
+        if (strcmp(commands[i].name, line) == 0) {
+            commands[i].handler(args);
+            return;
+        }
+    }
+
+    DEBUG_PRINTF("Unknown command '%s' - type 'help'\n", line);
+}
+
+void SerialConsole::printHelp() {
+    DEBUG_PRINTLN("Available commands:");
+    for (int i = 0; i < commandCount; i++) {
+        DEBUG_PRINTF("  %-10s %s\n", commands[i].name, commands[i].help ? commands[i].help : "");
+    }
+}
@@ -0,0 +1,366 @@
+#include "StandbyManager.h"
+#include <WiFi.h>
+#include <esp_sleep.h>
+#include <sys/time.h>
+#include <lvgl.h>
+#include <SD.h>
+#include <SPI.h>
+#include "HardwareConfig.h"
+#include "AudioManager.h"
+#include "ConfigManager.h"
+#include "RadioData.h"
+#include "SerialConsole.h"
+#include "DeferredLog.h"
+#include "ClockService.h"
+#include "SensorHistory.h"
+
+#if STANDBY_TOUCH_WAKE_PIN >= 0
+#include <driver/rtc_io.h>
+#endif
+
+#define STANDBY_STATE_MAGIC 0x53544259u   // "STBY"
+
+// Fast-path Wi-Fi wait before giving up and leaving it to connectToWiFi()
+#define STANDBY_WIFI_TIMEOUT_MS 8000
+
+// Survives deep sleep; invalid (magic mismatch) after power-on or reset
+struct StandbyState {
+    uint32_t magic;
+    char timezone[64];
+    int64_t sleepEpochUs;        // Wall clock when sleep started
+    int64_t wakeTargetUs;        // Planned timer wake (wall clock)
+    int64_t alarmEpoch;          // 0 if the wake is only the end of the night window
+    char alarmTitle[32];
+    char stationName[48];
+    char stationUrl[192];
+    uint8_t volume;
+    uint8_t bssid[6];            // Credentials are not kept here; they are reread from config.json
+    int32_t channel;
+    uint32_t wakeCount;
+    uint32_t lastWakeToAudioMs;  // 0 = not measured yet
+};
+
+RTC_DATA_ATTR static StandbyState rtcState;
+
+// Not RTC: recorded at runtime, copied into rtcState before sleeping
+static String lastStationName;
+static String lastStationUrl;
+
+// Set by the fast path when it started the alarm stream
+static bool fastPathStarted = false;
+static uint32_t fastPathAudioBytes = 0;
+
+// Initialize static singleton instance to nullptr
+StandbyManager* StandbyManager::_instance = nullptr;
+
+static int64_t wallClockUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void copyText(char* dst, size_t size, const char* src) {
+    strncpy(dst, src ? src : "", size - 1);
+    dst[size - 1] = '\0';
+}
+
+static void standbyCommand(const char* args) {
+    if (args && strcmp(args, "now") == 0) {
+        if (!StandbyManager::getInstance()->enterStandby()) {
+            DEBUG_PRINTLN("Standby not entered (see log)");
+        }
+        return;
+    }
+    StandbyManager::getInstance()->printStatus();
+}
+
+StandbyManager::StandbyManager() : measuringWake(false) {
+}
+
+StandbyManager* StandbyManager::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new StandbyManager();
+    }
+    return _instance;
+}
+
+time_t StandbyManager::nextAlarmTime(const std::vector<Alarm>& alarms, time_t now, const Alarm** alarm) {
+    time_t best = 0;
+    struct tm today;
+    localtime_r(&now, &today);
+
+    for (const Alarm& a : alarms) {
+        if (!a.active) {
+            continue;
+        }
+        time_t candidate = 0;
+
+        if (!a.repeat && a.date.length() > 0) {
+            // One-off alarm on a fixed date (YYYY-MM-DD)
+            struct tm t = {};
+            if (sscanf(a.date.c_str(), "%d-%d-%d", &t.tm_year, &t.tm_mon, &t.tm_mday) != 3) {
+                continue;
+            }
+            t.tm_year -= 1900;
+            t.tm_mon -= 1;
+            t.tm_hour = a.hour;
+            t.tm_min = a.minute;
+            t.tm_isdst = -1;
+            candidate = mktime(&t);
+            if (candidate <= now) {
+                continue;
+            }
+        } else {
+            // Today or one of the next seven days; weekdays[] is Monday-first
+            bool anyWeekday = false;
+            for (int d = 0; d < 7; d++) {
+                anyWeekday = anyWeekday || a.weekdays[d];
+            }
+            for (int offset = 0; offset <= 7; offset++) {
+                struct tm t = today;
+                t.tm_mday += offset;
+                t.tm_hour = a.hour;
+                t.tm_min = a.minute;
+                t.tm_sec = 0;
+                t.tm_isdst = -1;
+                time_t when = mktime(&t);   // Normalizes tm_wday as well
+                if (when <= now) {
+                    continue;
+                }
+                if (a.repeat && anyWeekday && !a.weekdays[(t.tm_wday + 6) % 7]) {
+                    continue;
+                }
+                candidate = when;
+                break;
+            }
+        }
+
+        if (candidate > 0 && (best == 0 || candidate < best)) {
+            best = candidate;
+            if (alarm) {
+                *alarm = &a;
+            }
+        }
+    }
+    return best;
+}
+
+void StandbyManager::resumeFromStandby() {
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause == ESP_SLEEP_WAKEUP_UNDEFINED || rtcState.magic != STANDBY_STATE_MAGIC) {
+        // Cold boot: whatever is in RTC memory is garbage
+        memset(&rtcState, 0, sizeof(rtcState));
+        return;
+    }
+    rtcState.wakeCount++;
+
+    // The RTC keeps the wall clock through deep sleep, but the time zone
+    // lives in the environment and has to be restored
+    if (rtcState.timezone[0]) {
+        setenv("TZ", rtcState.timezone, 1);
+        tzset();
+    }
+
+    int64_t now = wallClockUs();
+    if (now < rtcState.sleepEpochUs) {
+        // Clock lost (should not happen without a reset); advance from the sleep epoch
+        struct timeval tv;
+        int64_t restored = rtcState.wakeTargetUs > rtcState.sleepEpochUs ? rtcState.wakeTargetUs : rtcState.sleepEpochUs;
+        tv.tv_sec = (time_t)(restored / 1000000LL);
+        tv.tv_usec = (suseconds_t)(restored % 1000000LL);
+        settimeofday(&tv, nullptr);
+        now = restored;
+    }
+
+    bool alarmWake = cause == ESP_SLEEP_WAKEUP_TIMER && rtcState.alarmEpoch > 0 && rtcState.stationUrl[0] &&
+                     now / 1000000LL >= rtcState.alarmEpoch - 2 * STANDBY_PREROLL_S;
+    LOG_INFO(SYSTEM, "Standby: wake #%u (%s)%s", rtcState.wakeCount,
+             cause == ESP_SLEEP_WAKEUP_TIMER ? "timer" : "touch", alarmWake ? ", starting alarm stream" : "");
+    if (!alarmWake) {
+        return;
+    }
+
+    // Credentials come from config.json, so the SD card is needed this early.
+    // setup() mounts it again later, which is a no-op once mounted.
+    uint32_t start = millis();
+    SPI.begin(SD_SCK, SD_MISO, SD_MOSI);
+    String ssid, password;
+    if (!SD.begin(SD_CS) || !ConfigManager::getInstance()->initConfig() ||
+        !ConfigManager::getInstance()->getWiFiCredentials(ssid, password)) {
+        LOG_WARN(SYSTEM, "Standby: no Wi-Fi credentials, leaving the alarm to the normal start");
+        return;
+    }
+    LOG_INFO(SYSTEM, "Standby: config read in %u ms", (unsigned)(millis() - start));
+
+    // Reconnect with the cached channel/BSSID: skips the scan
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(ssid.c_str(), password.c_str(), rtcState.channel, rtcState.bssid, true);
+    start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < STANDBY_WIFI_TIMEOUT_MS) {
+        delay(20);
+    }
+    if (WiFi.status() != WL_CONNECTED) {
+        LOG_WARN(SYSTEM, "Standby: fast Wi-Fi reconnect failed after %u ms", (unsigned)(millis() - start));
+        return;
+    }
+    LOG_INFO(SYSTEM, "Standby: Wi-Fi up in %u ms", (unsigned)(millis() - start));
+
+    PlaybackSnapshot& info = g_playbackState.edit();
+    setPlaybackText(info.Title, rtcState.stationName);
+    setPlaybackText(info.Album, "Web Radio");
+    setPlaybackText(info.Artist, "");
+    setPlaybackText(info.AlarmTitle, rtcState.alarmTitle);
+    g_playbackState.publish();
+
+    // Start the stream now instead of after display and UI init: one loop()
+    // connects and creates the audio task
+    audioManager.setVolume(rtcState.volume);
+    audioManager.connecttohost(rtcState.stationUrl);
+    audioManager.loop();
+
+    fastPathStarted = true;
+    fastPathAudioBytes = audioManager.getTotalBytes();
+    measuringWake = true;
+    lastStationName = rtcState.stationName;
+    lastStationUrl = rtcState.stationUrl;
+}
+
+static void standbyClockCallback(const ClockSnapshot& snapshot, uint8_t events, void* context) {
+    (void)events;
+    static_cast<StandbyManager*>(context)->onMinute(snapshot);
+}
+
+void StandbyManager::begin() {
+    SerialConsole::getInstance()->registerCommand("standby", "Standby status, 'standby now' to deep-sleep", standbyCommand);
+    ClockService::getInstance()->subscribe(CLOCK_MINUTE, standbyClockCallback, this);
+}
+
+void StandbyManager::setLastStation(const char* name, const char* url) {
+    lastStationName = name;
+    lastStationUrl = url;
+}
+
+void StandbyManager::loop() {
+    // Wake-to-audio latency: from the planned timer wake (so boot ROM and
+    // bootloader time are included) to the first decoded bytes
+    if (measuringWake && audioManager.getTotalBytes() != fastPathAudioBytes) {
+        measuringWake = false;
+        int64_t latencyUs = wallClockUs() - rtcState.wakeTargetUs;
+        rtcState.lastWakeToAudioMs = latencyUs > 0 ? (uint32_t)(latencyUs / 1000) : 0;
+        LOG_INFO(SYSTEM, "Standby: audio %u ms after wake, %d s before alarm",
+                 rtcState.lastWakeToAudioMs, (int)(rtcState.alarmEpoch - wallClockUs() / 1000000LL));
+    }
+}
+
+void StandbyManager::onMinute(const ClockSnapshot& clock) {
+#if STANDBY_IDLE_TIMEOUT_MS > 0
+    // No touch for the timeout, nothing playing, and inside the night window
+    if (lv_display_get_inactive_time(NULL) < STANDBY_IDLE_TIMEOUT_MS || audioManager.isPlaying()) {
+        return;
+    }
+    if (clock.local.tm_hour >= STANDBY_NIGHT_START_HOUR || clock.local.tm_hour < STANDBY_NIGHT_END_HOUR) {
+        enterStandby();
+    }
+#else
+    (void)clock;
+#endif
+}
+
+bool StandbyManager::enterStandby() {
+    const ClockSnapshot& clock = ClockService::getInstance()->now();
+    time_t now = clock.epoch;
+    if (!clock.valid) {
+        LOG_WARN(SYSTEM, "Standby: clock not set, cannot schedule wake");
+        return false;
+    }
+
+    const Alarm* alarm = nullptr;
+    time_t alarmTime = nextAlarmTime(AlarmManager::getInstance()->getAlarms(), now, &alarm);
+
+    // Always wake at the end of the night window so the clock is back in the morning
+    struct tm end = clock.local;
+    if (end.tm_hour >= STANDBY_NIGHT_END_HOUR) {
+        end.tm_mday += 1;
+    }
+    end.tm_hour = STANDBY_NIGHT_END_HOUR;
+    end.tm_min = 0;
+    end.tm_sec = 0;
+    end.tm_isdst = -1;
+    time_t wakeTime = mktime(&end);
+
+    bool forAlarm = alarmTime > 0 && alarmTime - STANDBY_PREROLL_S <= wakeTime;
+    if (forAlarm) {
+        wakeTime = alarmTime - STANDBY_PREROLL_S;
+    }
+    if (wakeTime - now < STANDBY_MIN_SLEEP_S) {
+        LOG_INFO(SYSTEM, "Standby: next wake in %d s, not worth sleeping", (int)(wakeTime - now));
+        return false;
+    }
+
+    // Persist what the fast path needs
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcState.magic = STANDBY_STATE_MAGIC;
+    const char* tz = getenv("TZ");
+    copyText(rtcState.timezone, sizeof(rtcState.timezone), tz);
+    rtcState.sleepEpochUs = wallClockUs();
+    rtcState.wakeTargetUs = (int64_t)wakeTime * 1000000LL;
+    rtcState.alarmEpoch = forAlarm ? alarmTime : 0;
+    copyText(rtcState.alarmTitle, sizeof(rtcState.alarmTitle), forAlarm ? alarm->title.c_str() : "");
+    copyText(rtcState.stationName, sizeof(rtcState.stationName), lastStationName.c_str());
+    copyText(rtcState.stationUrl, sizeof(rtcState.stationUrl), lastStationUrl.c_str());
+    rtcState.volume = ConfigManager::getInstance()->getRadioVolume();
+    if (WiFi.status() == WL_CONNECTED) {
+        memcpy(rtcState.bssid, WiFi.BSSID(), sizeof(rtcState.bssid));
+        rtcState.channel = WiFi.channel();
+    }
+
+    uint64_t sleepUs = (uint64_t)(rtcState.wakeTargetUs - rtcState.sleepEpochUs);
+    LOG_INFO(SYSTEM, "Standby: sleeping %u s%s%s", (unsigned)(sleepUs / 1000000ULL),
+             forAlarm ? " until alarm " : "", forAlarm ? rtcState.alarmTitle : "");
+
+    // The open buckets and queued history records would be lost with RAM
+    SensorHistory::getInstance()->closeOpenBuckets();
+    if (!SensorHistory::getInstance()->flush()) {
+        LOG_WARN(SYSTEM, "Standby: sensor history not fully written");
+    }
+
+    audioManager.stop();
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+
+    esp_sleep_enable_timer_wakeup(sleepUs);
+#if STANDBY_TOUCH_WAKE_PIN >= 0
+    // GT911 INT is active low
+    rtc_gpio_pullup_en((gpio_num_t)STANDBY_TOUCH_WAKE_PIN);
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)STANDBY_TOUCH_WAKE_PIN, 0);
+#endif
+
+    // Let the log task drain before power goes away
+    delay(200);
+    Serial.flush();
+    esp_deep_sleep_start();
+    return true;   // Not reached
+}
+
+void StandbyManager::printStatus() {
+    time_t now = ClockService::getInstance()->now().epoch;
+    const Alarm* alarm = nullptr;
+    time_t alarmTime = nextAlarmTime(AlarmManager::getInstance()->getAlarms(), now, &alarm);
+    if (alarmTime > 0) {
+        struct tm local;
+        localtime_r(&alarmTime, &local);
+        char buf[32];
+        strftime(buf, sizeof(buf), "%a %Y-%m-%d %H:%M", &local);
+        DEBUG_PRINTF("Next alarm: %s (%s), in %ld s\n", buf, alarm->title.c_str(), (long)(alarmTime - now));
+    } else {
+        DEBUG_PRINTLN("Next alarm: none");
+    }
+    DEBUG_PRINTF("Wake station: %s\n", lastStationUrl.length() ? lastStationName.c_str() : "(none, play a station first)");
+    DEBUG_PRINTF("Pre-roll %d s, idle timeout %lu s, night %02d:00-%02d:00, touch wake pin %d\n",
+                 STANDBY_PREROLL_S, (unsigned long)(STANDBY_IDLE_TIMEOUT_MS / 1000),
+                 STANDBY_NIGHT_START_HOUR, STANDBY_NIGHT_END_HOUR, STANDBY_TOUCH_WAKE_PIN);
+    if (rtcState.magic == STANDBY_STATE_MAGIC) {
+        DEBUG_PRINTF("Wakes: %u, fast path %s, last wake-to-audio %u ms\n", rtcState.wakeCount,
+                     fastPathStarted ? "used" : "not used", rtcState.lastWakeToAudioMs);
+    }
+}
@@ -0,0 +1,237 @@
+#include "SystemMonitor.h"
+#include <esp_heap_caps.h>
+#include "SerialConsole.h"
+#include "PsramAllocator.h"
+#include "debug_config.h"
+
+// Initialize static singleton instance to nullptr
+SystemMonitor* SystemMonitor::_instance = nullptr;
+
+#if configUSE_TRACE_FACILITY
+// Kept off the loop task stack
+static TaskStatus_t statusBuffer[SystemMonitor::MAX_TASKS];
+#endif
+
+// Console command bridges
+static void tasksCommand(const char* args) {
+    (void)args;
+    SystemMonitor::getInstance()->printTasks();
+}
+
+static void heapCommand(const char* args) {
+    (void)args;
+    SystemMonitor::getInstance()->printHeap();
+}
+
+static void jitterCommand(const char* args) {
+    if (strcmp(args, "reset") == 0) {
+        SystemMonitor::getInstance()->resetJitter();
+        DEBUG_PRINTLN("Loop jitter statistics reset");
+        return;
+    }
+    SystemMonitor::getInstance()->printJitter();
+}
+
+SystemMonitor* SystemMonitor::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new SystemMonitor();
+    }
+    return _instance;
+}
+
+void SystemMonitor::begin() {
+    SerialConsole* console = SerialConsole::getInstance();
+    console->registerCommand("tasks", "Per-task CPU load and stack high-water marks", tasksCommand);
+    console->registerCommand("heap", "Free internal/PSRAM heap and low-water marks", heapCommand);
+    console->registerCommand("jitter", "Loop period histogram ('jitter reset' clears it)", jitterCommand);
+
+    lastSampleTime = ::millis();
+    sample();
+}
+
+void SystemMonitor::loopTick() {
+    uint32_t nowUs = micros();
+
+    if (lastLoopMicros != 0) {
+        uint32_t periodUs = nowUs - lastLoopMicros;
+        uint32_t periodMs = periodUs / 1000;
+
+        int bucket = (periodMs == 0) ? 0 : (32 - __builtin_clz(periodMs));
+        if (bucket >= JITTER_BUCKETS) {
+            bucket = JITTER_BUCKETS - 1;
+        }
+        jitterBuckets[bucket]++;
+        jitterCount++;
+        jitterSumUs += periodUs;
+        if (periodUs > jitterMaxUs) {
+            jitterMaxUs = periodUs;
+        }
+        if (periodUs > MONITOR_LOOP_PERIOD_WARN_US) {
+            slowLoopsSinceSample++;
+        }
+    }
+    lastLoopMicros = nowUs;
+
+    unsigned long now = ::millis();
+    if (now - lastSampleTime >= MONITOR_SAMPLE_INTERVAL_MS) {
+        lastSampleTime = now;
+        sample();
+    }
+}
+
+void SystemMonitor::sample() {
+    sampleTasks();
+    sampleHeap();
+
+    // Warnings are rate-limited to one report per sample interval
+    if (slowLoopsSinceSample > 0) {
+        DEBUG_PRINTF("[MON] WARNING: %u loop iterations exceeded %u ms (max %u us)\n",
+                     slowLoopsSinceSample, MONITOR_LOOP_PERIOD_WARN_US / 1000, jitterMaxUs);
+        slowLoopsSinceSample = 0;
+    }
+}
+
+const SystemMonitor::TaskSample* SystemMonitor::findPrevious(UBaseType_t number, const TaskSample* previous, int previousCount) {
+    for (int i = 0; i < previousCount; i++) {
+        if (previous[i].number == number) {
+            return &previous[i];
+        }
+    }
+    return nullptr;
+}
+
+void SystemMonitor::sampleTasks() {
+#if configUSE_TRACE_FACILITY
+    static TaskSample previous[MAX_TASKS];
+    int previousCount = taskCount;
+    memcpy(previous, tasks, sizeof(TaskSample) * previousCount);
+
+    uint32_t totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(statusBuffer, MAX_TASKS, &totalRunTime);
+    if (count == 0) {
+        // More tasks than MAX_TASKS - keep the previous sample
+        return;
+    }
+
+    uint32_t totalDelta = totalRunTime - lastTotalRunTime;
+    lastTotalRunTime = totalRunTime;
+
+    taskCount = (int)count;
+    for (int i = 0; i < taskCount; i++) {
+        const TaskStatus_t& status = statusBuffer[i];
+        TaskSample& task = tasks[i];
+
+        strncpy(task.name, status.pcTaskName, sizeof(task.name) - 1);
+        task.name[sizeof(task.name) - 1] = '\0';
+        task.number = status.xTaskNumber;
+        // On ESP-IDF the high-water mark is reported in bytes
+        task.stackFreeBytes = status.usStackHighWaterMark;
+        task.runTime = status.ulRunTimeCounter;
+        task.priority = status.uxCurrentPriority;
+#if configTASKLIST_INCLUDE_COREID
+        task.core = (status.xCoreID == tskNO_AFFINITY) ? -1 : (int8_t)status.xCoreID;
+#else
+        task.core = -1;
+#endif
+
+        // CPU load since the last sample; the total covers all cores
+        task.cpuPercent = 0;
+        const TaskSample* prev = findPrevious(task.number, previous, previousCount);
+        if (prev && totalDelta > 0) {
+            uint64_t percent = (uint64_t)(task.runTime - prev->runTime) * 100ULL * portNUM_PROCESSORS / totalDelta;
+            task.cpuPercent = (uint8_t)(percent > 100 ? 100 : percent);
+        }
+
+        if (task.stackFreeBytes < MONITOR_STACK_WARN_BYTES) {
+            DEBUG_PRINTF("[MON] WARNING: task '%s' has only %u bytes of stack left\n",
+                         task.name, task.stackFreeBytes);
+        }
+    }
+#endif
+}
+
+void SystemMonitor::sampleHeap() {
+    uint32_t freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint32_t freePsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+    if (freeInternal < minFreeInternal) minFreeInternal = freeInternal;
+    if (freePsram < minFreePsram) minFreePsram = freePsram;
+
+    if (freeInternal < MONITOR_INTERNAL_HEAP_WARN) {
+        DEBUG_PRINTF("[MON] WARNING: internal heap low: %u bytes free (largest block %u)\n",
+                     freeInternal, heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    }
+    if (psramFound() && freePsram < MONITOR_PSRAM_HEAP_WARN) {
+        DEBUG_PRINTF("[MON] WARNING: PSRAM heap low: %u bytes free\n", freePsram);
+    }
+}
+
+void SystemMonitor::printTasks() {
+#if configUSE_TRACE_FACILITY
+    sampleTasks();
+    DEBUG_PRINTLN("Task              Core Prio  CPU%  StackFree");
+    for (int i = 0; i < taskCount; i++) {
+        const TaskSample& task = tasks[i];
+#if configGENERATE_RUN_TIME_STATS
+        DEBUG_PRINTF("%-16s  %4d %4u  %3u%%  %6u\n", task.name, task.core,
+                     (unsigned)task.priority, task.cpuPercent, task.stackFreeBytes);
+#else
+        DEBUG_PRINTF("%-16s  %4d %4u   n/a  %6u\n", task.name, task.core,
+                     (unsigned)task.priority, task.stackFreeBytes);
+#endif
+    }
+#if !configGENERATE_RUN_TIME_STATS
+    DEBUG_PRINTLN("CPU% needs configGENERATE_RUN_TIME_STATS, which the prebuilt Arduino core leaves off");
+#endif
+#else
+    DEBUG_PRINTF("Task list not available (configUSE_TRACE_FACILITY=0). Loop task stack free: %u bytes\n",
+                 (unsigned)uxTaskGetStackHighWaterMark(nullptr));
+#endif
+}
+
+void SystemMonitor::printHeap() {
+    sampleHeap();
+    DEBUG_PRINTF("Internal: %u free, %u largest block, %u min free (monitor), %u min free (IDF)\n",
+                 heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                 heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                 minFreeInternal,
+                 heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (psramFound()) {
+        DEBUG_PRINTF("PSRAM:    %u free, %u largest block, %u min free (monitor), %u total\n",
+                     heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+                     heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM),
+                     minFreePsram,
+                     ESP.getPsramSize());
+    } else {
+        DEBUG_PRINTLN("PSRAM:    not available");
+    }
+    Psram::printStats();
+}
+
+void SystemMonitor::printJitter() {
+    if (jitterCount == 0) {
+        DEBUG_PRINTLN("No loop iterations recorded yet");
+        return;
+    }
+
+    DEBUG_PRINTF("Loop period over %u iterations: mean %u us, max %u us\n",
+                 jitterCount, (uint32_t)(jitterSumUs / jitterCount), jitterMaxUs);
+    for (int i = 0; i < JITTER_BUCKETS; i++) {
+        if (jitterBuckets[i] == 0) {
+            continue;
+        }
+        if (i == JITTER_BUCKETS - 1) {
+            DEBUG_PRINTF("  >=%5u ms: %u\n", 1U << (i - 1), jitterBuckets[i]);
+        } else {
+            DEBUG_PRINTF("   <%5u ms: %u\n", 1U << i, jitterBuckets[i]);
+        }
+    }
+}
+
+void SystemMonitor::resetJitter() {
+    memset(jitterBuckets, 0, sizeof(jitterBuckets));
+    jitterCount = 0;
+    jitterMaxUs = 0;
+    jitterSumUs = 0;
+    lastLoopMicros = 0;
+}
@@ -0,0 +1,160 @@
+#include "TouchInput.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "SerialConsole.h"
+#include "PowerManager.h"
+#include "DisplayPower.h"
+#include "DeferredLog.h"
+#include "I2CBus.h"
+
+static TouchReadFn readTouch = nullptr;
+static I2CDevice touchDevice("GT911", 0x5D, I2C_CLOCK_GT911, I2C_TIMEOUT_MS, I2CPriority::TOUCH);
+static QueueHandle_t eventQueue = nullptr;
+static TaskHandle_t touchTaskHandle = nullptr;
+
+// Written by the ISR, consumed by the touch task
+static volatile uint32_t irqTimestampUs = 0;
+
+// Counters shared between the ISR, the touch task and the console
+static std::atomic<uint32_t> irqCount(0);
+static std::atomic<uint32_t> readCount(0);
+static std::atomic<uint32_t> eventCount(0);
+static std::atomic<uint32_t> droppedCount(0);
+
+// Delivery latency, updated by the LVGL read callback (loop task)
+static uint32_t latencySamples = 0;
+static uint64_t latencySumUs = 0;
+static uint32_t latencyMaxUs = 0;
+
+// Last state handed to LVGL, repeated while the queue is empty
+static TouchEvent lastDelivered = {0, 0, 0, false};
+
+static void IRAM_ATTR touchIsr() {
+    irqTimestampUs = micros();
+    irqCount.fetch_add(1, std::memory_order_relaxed);
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(touchTaskHandle, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+struct TouchSample {
+    uint16_t x;
+    uint16_t y;
+    bool touched;
+};
+
+// Runs on the I2C bus task
+static I2CResult readOnBus(void* context) {
+    TouchSample* sample = static_cast<TouchSample*>(context);
+    sample->touched = readTouch(&sample->x, &sample->y);
+    return I2CResult::OK;
+}
+
+static void pushEvent(const TouchEvent& event) {
+    if (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
+        // Full: drop the oldest so the latest state (e.g. a release) is kept
+        TouchEvent discarded;
+        xQueueReceive(eventQueue, &discarded, 0);
+        xQueueSend(eventQueue, &event, 0);
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    eventCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void touchTask(void* parameter) {
+    (void)parameter;
+    TouchEvent state = {0, 0, 0, false};
+
+    for (;;) {
+        TickType_t wait;
+#if TOUCH_INT_PIN >= 0
+        wait = state.pressed ? pdMS_TO_TICKS(TOUCH_PRESSED_POLL_MS) : portMAX_DELAY;
+#else
+        wait = pdMS_TO_TICKS(TOUCH_FALLBACK_POLL_MS);
+#endif
+        bool interrupted = ulTaskNotifyTake(pdTRUE, wait) > 0;
+
+        TouchSample sample = {0, 0, false};
+        touchDevice.run(readOnBus, &sample);
+        readCount.fetch_add(1, std::memory_order_relaxed);
+        uint16_t x = sample.x, y = sample.y;
+        bool touched = sample.touched;
+
+        if (touched == state.pressed && (!touched || (x == state.x && y == state.y))) {
+            continue;
+        }
+        state.timestampUs = interrupted ? irqTimestampUs : micros();
+        state.pressed = touched;
+        if (touched) {
+            state.x = x;
+            state.y = y;
+        }
+        pushEvent(state);
+    }
+}
+
+static void touchCommand(const char* args) {
+    (void)args;
+    TouchInput::printStats();
+}
+
+void TouchInput::begin(TouchReadFn read) {
+    readTouch = read;
+    eventQueue = xQueueCreate(TOUCH_QUEUE_LENGTH, sizeof(TouchEvent));
+    xTaskCreate(touchTask, "TouchTask", TOUCH_TASK_STACK_SIZE, nullptr, TOUCH_TASK_PRIORITY, &touchTaskHandle);
+
+#if TOUCH_INT_PIN >= 0
+    pinMode(TOUCH_INT_PIN, INPUT_PULLUP);
+    attachInterrupt(TOUCH_INT_PIN, touchIsr, FALLING);
+    LOG_INFO(SYSTEM, "Touch: interrupt driven on GPIO %d", TOUCH_INT_PIN);
+#else
+    (void)touchIsr;
+    LOG_INFO(SYSTEM, "Touch: no INT line, polling every %d ms", TOUCH_FALLBACK_POLL_MS);
+#endif
+
+    SerialConsole::getInstance()->registerCommand("touch", "Touch events, I2C reads and latency", touchCommand);
+}
+
+void TouchInput::readCallback(lv_indev_t* indev, lv_indev_data_t* data) {
+    TouchEvent event;
+    if (eventQueue && xQueueReceive(eventQueue, &event, 0) == pdTRUE) {
+        uint32_t latency = micros() - event.timestampUs;
+        latencySamples++;
+        latencySumUs += latency;
+        if (latency > latencyMaxUs) {
+            latencyMaxUs = latency;
+        }
+        lastDelivered = event;
+
+        // Deliver queued press/release transitions in order within this read
+        data->continue_reading = uxQueueMessagesWaiting(eventQueue) > 0;
+    }
+
+    if (lastDelivered.pressed) {
+        PowerManager::getInstance()->pulse(PowerSubsystem::TOUCH);
+        if (DisplayPower::getInstance()->isBlanked()) {
+            // The waking touch only turns the panel on
+            DisplayPower::getInstance()->wake();
+            lv_indev_wait_release(indev);
+        }
+        data->state = LV_INDEV_STATE_PRESSED;
+    } else {
+        data->state = LV_INDEV_STATE_RELEASED;
+    }
+    data->point.x = lastDelivered.x;
+    data->point.y = lastDelivered.y;
+}
+
+void TouchInput::printStats() {
+    DEBUG_PRINTF("Touch: %s, %u interrupts, %u I2C reads, %u events, %u dropped\n",
+                 TOUCH_INT_PIN >= 0 ? "interrupt driven" : "polling (no INT line)",
+                 irqCount.load(), readCount.load(), eventCount.load(), droppedCount.load());
+    if (latencySamples > 0) {
+        DEBUG_PRINTF("Sample to LVGL latency: avg %u us, max %u us over %u events\n",
+                     (uint32_t)(latencySumUs / latencySamples), latencyMaxUs, latencySamples);
+    }
+}
@@ -4,20 +4,17 @@
 #include <vars.h>     // Include for EEZ global variable enums
 #include <eez-flow.h> // Include for EEZ flow framework
 #include <structs.h>  // Include for WeatherValue class
-#include <Preferences.h>
 #include "debug_config.h"
+#include "Profiler.h"
+#include "AllocTracker.h"
 #include "HardwareConfig.h"
+#include "RadioData.h"
 
 // Initialize static singleton instance to nullptr
 UIManager* UIManager::_instance = nullptr;
 
 // Private constructor implementation
 UIManager::UIManager() {
-    sgp30 = new Adafruit_SGP30();
-    // Pass the shared I2C bus instance (Wire1) to the SHT31 constructor.
-    sht31 = new Adafruit_SHT31(&Wire1);
-    sgp30Initialized = false;
-    sht31Initialized = false;
 }
 
 // Singleton instance getter
@@ -28,61 +25,9 @@ UIManager* UIManager::getInstance() {
     return _instance;
 }
 
-// Initialize sensors
+// Initialize sensors and start the 1 Hz sampling task
 bool UIManager::initSensors() {
-    bool success = true;
-    Preferences preferences;
-
-    // Initialize SHT31. The I2C bus is now correctly passed in the constructor.
-    if (!sht31->begin(0x44)) {
-#if SENSOR_DEBUG
-        DEBUG_PRINTLN("Couldn't find SHT31 sensor on I2C bus 1!");
-#endif
-        success = false;
-    } else {
-        sht31Initialized = true;
-#if SENSOR_DEBUG
-        DEBUG_PRINTLN("SHT31 sensor initialized successfully");
-#endif
-    }
-
-    // Initialize SGP30 VOC and eCO2 sensor using the shared Wire1 bus.
-    if (!sgp30->begin(&Wire1)) {
-#if SENSOR_DEBUG
-        DEBUG_PRINTLN("Couldn't find SGP30 sensor on I2C bus 1!");
-#endif
-        success = false;
-    } else {
-        sgp30Initialized = true;
-#if SENSOR_DEBUG
-        DEBUG_PRINTLN("SGP30 sensor initialized successfully");
-        DEBUG_PRINT("Found SGP30 serial #");
-        DEBUG_PRINT(sgp30->serialnumber[0], HEX);
-        DEBUG_PRINT(sgp30->serialnumber[1], HEX);
-        DEBUG_PRINTLN(sgp30->serialnumber[2], HEX);
-#endif
-        // Initialize IAQ algorithm baseline
-        sgp30->IAQinit();
-
-        // Try to load baseline values from non-volatile storage
-        preferences.begin("sgp30", false);
-        eco2_baseline = preferences.getUInt("eco2_base", 0);
-        tvoc_baseline = preferences.getUInt("tvoc_base", 0);
-        preferences.end();
-
-        // If we have valid baseline values, set them
-        if (eco2_baseline > 0 && tvoc_baseline > 0) {
-#if SENSOR_DEBUG
-            DEBUG_PRINTF("Setting SGP30 baselines: eCO2=0x%X, TVOC=0x%X\n", eco2_baseline, tvoc_baseline);
-#endif
-            sgp30->setIAQBaseline(eco2_baseline, tvoc_baseline);
-        }
-    }
-
-    // Initialize the baseline timestamp
-    lastBaselineTime = ::millis();
-
-    return success;
+    return SensorTask::getInstance()->begin();
 }
 
 // Update temperature display
@@ -236,140 +181,82 @@ void UIManager::updateCO2(uint16_t eco2) {
     }
 }
 
-// Read sensors and update UI
+// Take over the sensor task's latest values and update UI
 void UIManager::updateEnvironmentalData() {
-    // Only proceed if sensors were initialized successfully
-    if (sht31Initialized) {
-        // With a shared, stable I2C bus, the re-initialization patch is no longer needed.
-        
-        // Read temperature and humidity from SHT31
-        float temperature = sht31->readTemperature();
-        float humidity = sht31->readHumidity();
-        
-        // Check if readings are valid (not NaN)
-        if (!isnan(temperature)) {
-            updateTemperature(temperature);
-        } else {
-#if SENSOR_DEBUG
-            DEBUG_PRINTLN("Invalid temperature reading (NaN)");
-#endif
-        }
-        
-        if (!isnan(humidity)) {
-            updateHumidity(humidity);
-        } else {
-#if SENSOR_DEBUG
-            DEBUG_PRINTLN("Invalid humidity reading (NaN)");
-#endif
-        }
-    }
+    PROFILE_ZONE("ui.envData");
+    ALLOC_SCOPE(AllocTag::SENSOR);
     
-    if (sgp30Initialized) {
-        // With a shared, stable I2C bus, the re-initialization patch is no longer needed.
-        
-        // Read TVOC and eCO2 from SGP30
-        if (sgp30->IAQmeasure()) {
-            updateTVOC(sgp30->TVOC);
-            updateCO2(sgp30->eCO2);
-            
-            // Handle baseline updates
-            handleSGP30Baseline();
-        } else {
-#if SENSOR_DEBUG
-            DEBUG_PRINTLN("Failed to read from SGP30 sensor");
-#endif
-        }
+    SensorSnapshot snapshot;
+    SensorTask::getInstance()->getSnapshot(snapshot);
+    if (snapshot.sequence == lastSensorSequence) {
+        return;
     }
-}
-
-// SGP30 baseline management
-void UIManager::handleSGP30Baseline() {
-    unsigned long currentTime = ::millis();
+    lastSensorSequence = snapshot.sequence;
     
-    #if SENSOR_DEBUG
-    // Debug output for baseline timing
-    DEBUG_PRINT("handleSGP30Baseline called. Current time: ");
-    DEBUG_PRINT(currentTime);
-    DEBUG_PRINT(", lastBaselineTime: ");
-    DEBUG_PRINT(lastBaselineTime);
-    DEBUG_PRINT(", diff: ");
-    DEBUG_PRINT(currentTime - lastBaselineTime);
-    DEBUG_PRINT(", threshold: ");
-    DEBUG_PRINTLN(SGP30_BASELINE_INTERVAL_MS);
-    #endif
+    if (snapshot.climateValid) {
+        updateTemperature(snapshot.temperatureCenti / 100.0f);
+        updateHumidity(snapshot.humidityCenti / 100.0f);
+    }
     
-    // Check if it's time to read/save the baseline (every hour)
-    if ((currentTime - lastBaselineTime) >= SGP30_BASELINE_INTERVAL_MS) {
-        lastBaselineTime = currentTime;
-        
-        // Get current baseline values
-        if (sgp30->getIAQBaseline(&eco2_baseline, &tvoc_baseline)) {
-            // Store the baseline values in non-volatile storage
-            Preferences preferences;
-            preferences.begin("sgp30", false);
-            preferences.putUInt("eco2_base", eco2_baseline);
-            preferences.putUInt("tvoc_base", tvoc_baseline);
-            preferences.end();
-            
-#if SENSOR_DEBUG
-            DEBUG_PRINTF("SGP30 baselines saved: eCO2=0x%X, TVOC=0x%X\n", eco2_baseline, tvoc_baseline);
-#endif
-        } else {
-#if SENSOR_DEBUG
-            DEBUG_PRINTLN("Failed to get SGP30 baseline values");
-#endif
-        }
+    // Smoothed eCO2/TVOC, available once the SGP30 has warmed up
+    if (snapshot.airValid) {
+        updateTVOC(snapshot.tvoc);
+        updateCO2(snapshot.eco2);
     }
 }
 
 // Update time on the main screen
-void UIManager::updateTimeUI() {
-    struct tm timeinfo;
+void UIManager::updateTimeUI(const struct tm& timeinfo) {
     char timeString[9];
+    strftime(timeString, sizeof(timeString), "%H:%M:%S", &timeinfo);
+    
+    // Update EEZ global variable for UI data binding
+    eez::flow::setGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_TIME, eez::StringValue(timeString));
     
-    if (getLocalTime(&timeinfo)) {
-        strftime(timeString, sizeof(timeString), "%H:%M:%S", &timeinfo);
-        
-        // Update EEZ global variable for UI data binding
-        eez::flow::setGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_TIME, eez::StringValue(timeString));
-        
 #if TIME_DEBUG
-        DEBUG_PRINT("Time updated via EEZ global variable: ");
-        DEBUG_PRINTLN(timeString);
+    DEBUG_PRINT("Time updated via EEZ global variable: ");
+    DEBUG_PRINTLN(timeString);
 #endif
-    }
 }
 
 // Update date on the main screen in German format
-void UIManager::updateDateUI() {
-    struct tm timeinfo;
+void UIManager::updateDateUI(const struct tm& timeinfo) {
     char dateString[30];
     
-    if (getLocalTime(&timeinfo)) {
-        // Get current hour to track hour changes
-        int current_hour = timeinfo.tm_hour;
-        
-        // Store the last update hour
-        hourChangeTracking = current_hour;
-        
-        // Array of German weekday names
-        const char* weekdays_de[] = {"Sonntag", "Montag", "Dienstag", "Mittwoch", "Donnerstag", "Freitag", "Samstag"};
-        
-        // Format: Weekday dd.mm.yyyy
-        sprintf(dateString, "%s %02d.%02d.%04d", 
-                weekdays_de[timeinfo.tm_wday], 
-                timeinfo.tm_mday, 
-                timeinfo.tm_mon + 1, 
-                timeinfo.tm_year + 1900);
-        
-        // Update EEZ global variable for UI data binding
-        eez::flow::setGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_DATE, eez::StringValue(dateString));
-        
+    // Array of German weekday names
+    const char* weekdays_de[] = {"Sonntag", "Montag", "Dienstag", "Mittwoch", "Donnerstag", "Freitag", "Samstag"};
+    
+    // Format: Weekday dd.mm.yyyy
+    sprintf(dateString, "%s %02d.%02d.%04d", 
+            weekdays_de[timeinfo.tm_wday], 
+            timeinfo.tm_mday, 
+            timeinfo.tm_mon + 1, 
+            timeinfo.tm_year + 1900);
+    
+    // Update EEZ global variable for UI data binding
+    eez::flow::setGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_DATE, eez::StringValue(dateString));
+    
 #if TIME_DEBUG
-        DEBUG_PRINT("Date updated via EEZ global variable: ");
-        DEBUG_PRINTLN(dateString);
+    DEBUG_PRINT("Date updated via EEZ global variable: ");
+    DEBUG_PRINTLN(dateString);
 #endif
+}
+
+// Update playback info from the audio side's latest snapshot
+void UIManager::updatePlaybackUI() {
+    // Cheap when nothing changed: a single atomic load, no copy
+    if (!g_playbackState.consume()) {
+        return;
     }
+    
+    const PlaybackSnapshot& info = g_playbackState.latest();
+    
+    PlaybackStrucValue playback;
+    playback.AlarmTitle(info.AlarmTitle);
+    playback.Title(info.Title);
+    playback.Album(info.Album);
+    playback.Artist(info.Artist);
+    eez::flow::setGlobalVariable(FLOW_GLOBAL_VARIABLE_PLAYBACK_INFO, playback);
 }
 
 // Check if WiFi status has changed
@@ -496,16 +383,13 @@ void UIManager::updateWiFiStatusUI() {
     }
 }
 
-// Initialize the weather service with API key and location
-bool UIManager::initWeatherService(const String& apiKey, float latitude, float longitude,
+// Initialize the weather service with API key and locations
+bool UIManager::initWeatherService(const String& apiKey, const WeatherLocationConfig* locations, int count,
                                  const String& units, const String& language) {
     WeatherService& weatherService = WeatherService::getInstance();
-    bool result = weatherService.init(apiKey, latitude, longitude, units, language);
-    
-    // Set the update interval (5 minutes = 300000 ms)
-    weatherService.setUpdateInterval(300000);
+    bool result = weatherService.init(apiKey, locations, count, units, language);
     
-    // Force an update to get initial weather data
+    // Fetch now if there is no cached data or it is out of date
     if (result && WiFi.status() == WL_CONNECTED) {
         updateWeatherData();
     }
@@ -515,28 +399,15 @@ bool UIManager::initWeatherService(const String& apiKey, float latitude, float l
 
 // Update weather data if needed and update the UI
 void UIManager::updateWeatherData() {
-    unsigned long currentTime = ::millis();
-    
-    // Debug output for weather timing
-    DEBUG_PRINT("updateWeatherData called. Current time: ");
-    DEBUG_PRINT(currentTime);
-    DEBUG_PRINT(", lastWeatherUpdateTime: ");
-    DEBUG_PRINT(lastWeatherUpdateTime);
-    DEBUG_PRINT(", diff: ");
-    DEBUG_PRINTLN(currentTime - lastWeatherUpdateTime);
-    
-    // Check if WiFi is connected - can't update weather without network
+    // Called every few seconds by the scheduler timer, so stay quiet here
     if (WiFi.status() != WL_CONNECTED) {
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("Cannot update weather: WiFi not connected");
-        #endif
         return;
     }
     
     // Get reference to the singleton weather service
     WeatherService& weatherService = WeatherService::getInstance();
     
-    // Check if it's time to update (will only update if interval has passed)
+    // Fetches at most one location whose data is due
     if (weatherService.update()) {
         // Update was performed, save the timestamp
         lastWeatherUpdateTime = ::millis();
@@ -544,9 +415,5 @@ void UIManager::updateWeatherData() {
         #if WEATHER_DEBUG
         DEBUG_PRINTLN("Weather data updated successfully");
         #endif
-    } else {
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("No weather update needed yet");
-        #endif
     }
 }
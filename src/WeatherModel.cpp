@@ -0,0 +1,488 @@
+#include "WeatherModel.h"
+#include "DeferredLog.h"
+#include "Profiler.h"
+
+//####################################################################################################
+// WeatherStreamReader
+//####################################################################################################
+
+size_t WeatherStreamReader::readBytes(char* out, size_t size) {
+    size_t copied = 0;
+    while (copied < size) {
+        if (position == length && !fill()) {
+            break;
+        }
+        size_t chunk = min(size - copied, length - position);
+        memcpy(out + copied, buffer + position, chunk);
+        position += chunk;
+        copied += chunk;
+    }
+    return copied;
+}
+
+bool WeatherStreamReader::find(const char* target) {
+    size_t targetLength = strlen(target);
+    size_t matched = 0;
+    int c;
+    while ((c = read()) >= 0) {
+        if (c == target[matched]) {
+            if (++matched == targetLength) {
+                return true;
+            }
+        } else {
+            matched = (c == target[0]) ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+int WeatherStreamReader::skipTo(char c) {
+    int next;
+    while ((next = read()) >= 0 && next != c) {
+    }
+    return next;
+}
+
+int WeatherStreamReader::skipToSeparator() {
+    int c;
+    while ((c = read()) >= 0 && c != ',' && c != ']') {
+    }
+    return c;
+}
+
+bool WeatherStreamReader::fill() {
+    if (!stream) {
+        return false;
+    }
+    size_t wanted = sizeof(buffer);
+    int available = stream->available();
+    if (available > 0 && (size_t)available < wanted) {
+        wanted = available;
+    } else if (available <= 0) {
+        // Nothing buffered yet: block (up to the stream timeout) for one byte
+        wanted = 1;
+    }
+    length = stream->readBytes(buffer, wanted);
+    position = 0;
+    total += length;
+    return length > 0;
+}
+
+//####################################################################################################
+// Weather icons
+//####################################################################################################
+
+// OpenWeatherMap condition numbers in WeatherIcon order
+static constexpr uint8_t ICON_CONDITION_CODES[WEATHER_ICON_CONDITIONS] = {1, 2, 3, 4, 9, 10, 11, 13, 50};
+#define ICON_UNKNOWN 0xFF
+
+// Condition index of a two-digit code (used to build the table below)
+static constexpr uint8_t conditionForCode(int code, int condition = 0) {
+    return condition == WEATHER_ICON_CONDITIONS ? ICON_UNKNOWN
+         : ICON_CONDITION_CODES[condition] == code ? condition
+         : conditionForCode(code, condition + 1);
+}
+
+#define ICON_CODE_ROW(t) \
+    conditionForCode(t * 10 + 0), conditionForCode(t * 10 + 1), conditionForCode(t * 10 + 2), \
+    conditionForCode(t * 10 + 3), conditionForCode(t * 10 + 4), conditionForCode(t * 10 + 5), \
+    conditionForCode(t * 10 + 6), conditionForCode(t * 10 + 7), conditionForCode(t * 10 + 8), \
+    conditionForCode(t * 10 + 9)
+
+// Condition for each numeric code "00".."99", generated at compile time
+static constexpr uint8_t ICON_CONDITION_BY_CODE[100] = {
+    ICON_CODE_ROW(0), ICON_CODE_ROW(1), ICON_CODE_ROW(2), ICON_CODE_ROW(3), ICON_CODE_ROW(4),
+    ICON_CODE_ROW(5), ICON_CODE_ROW(6), ICON_CODE_ROW(7), ICON_CODE_ROW(8), ICON_CODE_ROW(9)
+};
+
+static_assert(ICON_CONDITION_BY_CODE[10] == weatherIconCondition(WeatherIcon::RAIN_DAY), "Icon table out of order");
+static_assert(ICON_CONDITION_BY_CODE[50] == weatherIconCondition(WeatherIcon::MIST_NIGHT), "Icon table out of order");
+static_assert(ICON_CONDITION_BY_CODE[5] == ICON_UNKNOWN, "Icon table out of order");
+
+//####################################################################################################
+// Parsing
+//####################################################################################################
+
+WeatherModel::WeatherModel()
+    : hourlyCount(0), currentPeriod(PERIOD_MORNING), layoutUntil(0), nextEvent(0), lastNow(0), windowsValid(false) {
+    memset(&hourly, 0, sizeof(hourly));
+    memset(&descriptions, 0, sizeof(descriptions));
+}
+
+// Fields kept from "current" and from each "hourly" entry
+static void buildWeatherFilter(JsonDocument& filter, bool hourly) {
+    filter["dt"] = true;
+    filter["temp"] = true;
+    if (hourly) {
+        filter["pop"] = true;
+    } else {
+        filter["feels_like"] = true;
+        filter["sunrise"] = true;
+        filter["sunset"] = true;
+    }
+    JsonObject weather = filter["weather"].createNestedObject();
+    weather["description"] = true;
+    weather["icon"] = true;
+}
+
+static int16_t toCenti(float value) {
+    return (int16_t)constrain(lroundf(value * 100.0f), -32768L, 32767L);
+}
+
+WeatherIcon weatherIconFromCode(const char* code) {
+    if (code == nullptr || !isdigit((unsigned char)code[0]) || !isdigit((unsigned char)code[1])) {
+        return WeatherIcon::CLEAR_DAY;
+    }
+    uint8_t condition = ICON_CONDITION_BY_CODE[(code[0] - '0') * 10 + (code[1] - '0')];
+    if (condition == ICON_UNKNOWN) {
+        return WeatherIcon::CLEAR_DAY;
+    }
+    return makeWeatherIcon(condition, code[2] == 'n');
+}
+
+static uint8_t internDescription(DescriptionTable& descriptions, const char* text) {
+    if (text == nullptr) {
+        return WEATHER_NO_DESCRIPTION;
+    }
+    for (uint8_t id = 0; id < descriptions.count; id++) {
+        if (strcmp(descriptions.pool + descriptions.offset[id], text) == 0) {
+            return id;
+        }
+    }
+    size_t length = strlen(text) + 1;
+    if (descriptions.count >= WEATHER_MAX_DESCRIPTIONS || descriptions.used + length > WEATHER_DESCRIPTION_POOL) {
+        LOG_WARN(WEATHER, "Description table full, dropping \"%s\"", text);
+        return WEATHER_NO_DESCRIPTION;
+    }
+    memcpy(descriptions.pool + descriptions.used, text, length);
+    descriptions.offset[descriptions.count] = descriptions.used;
+    descriptions.used += length;
+    return descriptions.count++;
+}
+
+static void parseCurrent(WeatherParseScratch& scratch, const JsonObject& data) {
+    CurrentWeather& current = scratch.current;
+    current.dt = data["dt"].as<uint32_t>();
+    current.sunrise = data["sunrise"].as<uint32_t>();
+    current.sunset = data["sunset"].as<uint32_t>();
+    current.tempCenti = toCenti(data["temp"].as<float>());
+    current.feelsLikeCenti = toCenti(data["feels_like"].as<float>());
+    
+    // Weather description and icon
+    JsonObject weather = data["weather"][0];
+    current.icon = weatherIconFromCode(weather["icon"].as<const char*>());
+    current.description = internDescription(scratch.descriptions, weather["description"].as<const char*>());
+    
+    #if WEATHER_DEBUG
+    DEBUG_PRINTLN("Current weather:");
+    DEBUG_PRINTF("  Temperature: %.2f°C\n", current.tempCenti / 100.0f);
+    DEBUG_PRINTF("  Feels like: %.2f°C\n", current.feelsLikeCenti / 100.0f);
+    DEBUG_PRINTF("  Weather: %s\n", weather["description"].as<const char*>());
+    DEBUG_PRINTF("  Icon: %u\n", (unsigned)current.icon);
+    #endif
+}
+
+static void parseHourlyEntry(WeatherParseScratch& scratch, int index, const JsonObject& hourData) {
+    HourlyForecasts& hourly = scratch.hourly;
+    hourly.dt[index] = hourData["dt"].as<uint32_t>();
+    hourly.tempCenti[index] = toCenti(hourData["temp"].as<float>());
+    hourly.pop[index] = (uint8_t)constrain(lroundf(hourData["pop"].as<float>() * 100.0f), 0L, 100L);
+    
+    // Weather description and icon
+    JsonObject weather = hourData["weather"][0];
+    hourly.icon[index] = (uint8_t)weatherIconFromCode(weather["icon"].as<const char*>());
+    hourly.description[index] = internDescription(scratch.descriptions, weather["description"].as<const char*>());
+}
+
+bool WeatherModel::parse(WeatherParseBuffers& buffers, size_t& peakDocument) {
+    PROFILE_ZONE("weather.parse");
+    WeatherStreamReader& reader = buffers.reader;
+    JsonDocument& filter = buffers.filter;
+    JsonDocument& doc = buffers.entry;
+    WeatherParseScratch& scratch = buffers.scratch;
+
+    // Descriptions are interned again for every response
+    scratch.hourlyCount = 0;
+    scratch.descriptions.count = 0;
+    scratch.descriptions.used = 0;
+
+    // "current" precedes "hourly" in the One Call response
+    filter.clear();
+    buildWeatherFilter(filter, false);
+    if (!reader.find("\"current\":")) {
+        LOG_WARN(WEATHER, "No \"current\" after %u bytes", (unsigned)reader.bytesRead());
+        return false;
+    }
+    DeserializationError error = deserializeJson(doc, reader, DeserializationOption::Filter(filter));
+    if (error) {
+        LOG_WARN(WEATHER, "current: %s", error.c_str());
+        return false;
+    }
+    peakDocument = doc.memoryUsage();
+    parseCurrent(scratch, doc.as<JsonObject>());
+
+    filter.clear();
+    buildWeatherFilter(filter, true);
+    if (!reader.find("\"hourly\":") || reader.skipTo('[') < 0) {
+        LOG_WARN(WEATHER, "No \"hourly\" after %u bytes", (unsigned)reader.bytesRead());
+        return false;
+    }
+
+    // One array element at a time, stored as soon as it is complete. Entries
+    // beyond WEATHER_MAX_HOURLY are still read, so the array is seen to end.
+    int count = 0;
+    int separator;
+    do {
+        error = deserializeJson(doc, reader, DeserializationOption::Filter(filter));
+        if (error) {
+            // Also a body cut off or timed out mid-entry (IncompleteInput)
+            LOG_WARN(WEATHER, "hourly[%d]: %s", count, error.c_str());
+            return false;
+        }
+        if (doc.memoryUsage() > peakDocument) {
+            peakDocument = doc.memoryUsage();
+        }
+        if (count < WEATHER_MAX_HOURLY) {
+            parseHourlyEntry(scratch, count, doc.as<JsonObject>());
+            count++;
+        }
+        separator = reader.skipToSeparator();
+    } while (separator == ',');
+
+    if (separator != ']') {
+        LOG_WARN(WEATHER, "hourly: body ended after %d entries, %u bytes", count, (unsigned)reader.bytesRead());
+        return false;
+    }
+
+    // Complete: replace the model's data
+    current = scratch.current;
+    memcpy(&hourly, &scratch.hourly, sizeof(hourly));
+    hourlyCount = count;
+    memcpy(&descriptions, &scratch.descriptions, sizeof(descriptions));
+    resetWindows();
+    
+    #if WEATHER_DEBUG
+    DEBUG_PRINTF("Parsed %d hourly forecasts, %u descriptions (%u bytes)\n",
+                 hourlyCount, descriptions.count, descriptions.used);
+    #endif
+    return true;
+}
+
+const char* WeatherModel::getDescription(uint8_t id) const {
+    if (id >= descriptions.count) {
+        return "";
+    }
+    return descriptions.pool + descriptions.offset[id];
+}
+
+//####################################################################################################
+// Period summaries
+//####################################################################################################
+
+static int32_t roundedMean(int32_t sum, int32_t count) {
+    return (sum >= 0 ? sum + count / 2 : sum - count / 2) / count;
+}
+
+static void summarizePeriod(const PeriodAccumulator& period, bool night, ForecastSummary& summary) {
+    if (period.count == 0) {
+        // No hours in the window: default cloudy icon
+        summary.avgTempCenti = 0;
+        summary.avgPop = 0;
+        summary.icon = night ? WeatherIcon::CLOUDS_NIGHT : WeatherIcon::CLOUDS_DAY;
+        return;
+    }
+    
+    // Most frequent condition; ties go to the lower icon code
+    int best = 0;
+    for (int condition = 1; condition < WEATHER_ICON_CONDITIONS; condition++) {
+        if (period.conditions[condition] > period.conditions[best]) {
+            best = condition;
+        }
+    }
+    summary.avgTempCenti = (int16_t)roundedMean(period.tempSum, period.count);
+    summary.avgPop = (uint8_t)roundedMean(period.popSum, period.count);
+    summary.icon = makeWeatherIcon(best, night);
+}
+
+// Local time 'dayOffset' days after 'day' at the time of day of 'clockTime'
+static time_t atTimeOfDay(const struct tm& day, int dayOffset, const struct tm& clockTime) {
+    struct tm t = day;
+    t.tm_mday += dayOffset;
+    t.tm_hour = clockTime.tm_hour;
+    t.tm_min = clockTime.tm_min;
+    t.tm_sec = clockTime.tm_sec;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+void WeatherModel::resetWindows() {
+    windowsValid = false;
+}
+
+void WeatherModel::clear() {
+    current = CurrentWeather();
+    hourlyCount = 0;
+    memset(&hourly, 0, sizeof(hourly));
+    memset(&descriptions, 0, sizeof(descriptions));
+    for (int p = 0; p < PERIOD_COUNT; p++) {
+        summaries[p] = ForecastSummary();
+    }
+    resetWindows();
+}
+
+bool WeatherModel::summarize(time_t now) {
+    resetWindows();
+    advance(now);
+    return windowsValid;
+}
+
+// The period containing 'now' runs from now to its end; the other two
+// follow it. Sunrise and sunset keep the time of day of the fetched
+// "current" values but are moved to the days the windows fall on, so
+// the layout stays right while the data ages.
+void WeatherModel::computeLayout(time_t now, time_t start[], time_t end[]) {
+    struct tm today, sunriseInfo, sunsetInfo, noonInfo;
+    localtime_r(&now, &today);
+    time_t sunriseTime = current.sunrise;
+    time_t sunsetTime = current.sunset;
+    localtime_r(&sunriseTime, &sunriseInfo);
+    localtime_r(&sunsetTime, &sunsetInfo);
+    memset(&noonInfo, 0, sizeof(noonInfo));
+    noonInfo.tm_hour = 12;
+    
+    time_t sunrise[2], noon[2], sunset[2];      // Today, tomorrow
+    for (int day = 0; day < 2; day++) {
+        noon[day] = atTimeOfDay(today, day, noonInfo);
+        // Keep the windows ordered when there is no sunrise or sunset (polar day or night)
+        sunrise[day] = min(atTimeOfDay(today, day, sunriseInfo), noon[day]);
+        sunset[day] = max(atTimeOfDay(today, day, sunsetInfo), noon[day]);
+    }
+    
+    if (now < sunrise[0]) {
+        // After midnight, before sunrise
+        currentPeriod = PERIOD_NIGHT;
+        start[PERIOD_NIGHT] = now;                  end[PERIOD_NIGHT] = sunrise[0];
+        start[PERIOD_MORNING] = sunrise[0];         end[PERIOD_MORNING] = noon[0];
+        start[PERIOD_AFTERNOON] = noon[0];          end[PERIOD_AFTERNOON] = sunset[0];
+    } else if (now < noon[0]) {
+        currentPeriod = PERIOD_MORNING;
+        start[PERIOD_MORNING] = now;                end[PERIOD_MORNING] = noon[0];
+        start[PERIOD_AFTERNOON] = noon[0];          end[PERIOD_AFTERNOON] = sunset[0];
+        start[PERIOD_NIGHT] = sunset[0];            end[PERIOD_NIGHT] = sunrise[1];
+    } else if (now < sunset[0]) {
+        currentPeriod = PERIOD_AFTERNOON;
+        start[PERIOD_AFTERNOON] = now;              end[PERIOD_AFTERNOON] = sunset[0];
+        start[PERIOD_NIGHT] = sunset[0];            end[PERIOD_NIGHT] = sunrise[1];
+        start[PERIOD_MORNING] = sunrise[1];         end[PERIOD_MORNING] = noon[1];
+    } else {
+        // After sunset; past midnight the layout is the same, so it holds until sunrise
+        currentPeriod = PERIOD_NIGHT;
+        start[PERIOD_NIGHT] = now;                  end[PERIOD_NIGHT] = sunrise[1];
+        start[PERIOD_MORNING] = sunrise[1];         end[PERIOD_MORNING] = noon[1];
+        start[PERIOD_AFTERNOON] = noon[1];          end[PERIOD_AFTERNOON] = sunset[1];
+    }
+    layoutUntil = end[currentPeriod];
+    
+    #if WEATHER_DEBUG
+    static const char* const names[PERIOD_COUNT] = {"Morning", "Afternoon", "Night"};
+    for (int p = 0; p < PERIOD_COUNT; p++) {
+        struct tm from, to;
+        localtime_r(&start[p], &from);
+        localtime_r(&end[p], &to);
+        DEBUG_PRINTF("%s period: %02d.%02d %02d:%02d to %02d.%02d %02d:%02d\n", names[p],
+                     from.tm_mday, from.tm_mon + 1, from.tm_hour, from.tm_min,
+                     to.tm_mday, to.tm_mon + 1, to.tm_hour, to.tm_min);
+    }
+    #endif
+}
+
+void WeatherModel::addHour(PeriodAccumulator& totals, int index, int sign) {
+    totals.tempSum += sign * hourly.tempCenti[index];
+    totals.popSum += sign * hourly.pop[index];
+    totals.conditions[weatherIconCondition((WeatherIcon)hourly.icon[index])] += sign;
+    totals.count += sign;
+}
+
+// Hours are sorted, so a window is an index range. Its ends only move
+// forward: each hour enters and leaves a window once.
+void WeatherModel::slideWindow(int period, time_t start, time_t end) {
+    PeriodWindow& window = windows[period];
+    while (window.first < window.last && (time_t)hourly.dt[window.first] < start) {
+        addHour(window.totals, window.first++, -1);
+    }
+    if (window.first == window.last) {
+        while (window.first < hourlyCount && (time_t)hourly.dt[window.first] < start) {
+            window.first++;
+        }
+        window.last = window.first;
+    }
+    while (window.last > window.first && (time_t)hourly.dt[window.last - 1] >= end) {
+        addHour(window.totals, --window.last, -1);
+    }
+    while (window.last < hourlyCount && (time_t)hourly.dt[window.last] < end) {
+        addHour(window.totals, window.last++, 1);
+    }
+    window.end = end;
+}
+
+bool WeatherModel::advance(time_t now) {
+    if (windowsValid && now >= lastNow && now < nextEvent) {
+        return false;
+    }
+    PROFILE_ZONE("weather.dailyForecasts");
+    
+    if (hourlyCount == 0) {
+        #if WEATHER_DEBUG
+        DEBUG_PRINTLN("No hourly forecasts available for calculation");
+        #endif
+        return false;
+    }
+    
+    if (!windowsValid || now < lastNow) {
+        // New data or the clock went back: start from empty windows
+        memset(windows, 0, sizeof(windows));
+        layoutUntil = 0;
+    }
+    
+    if (now >= layoutUntil) {
+        // Sunrise, noon or sunset: all windows move
+        time_t start[PERIOD_COUNT], end[PERIOD_COUNT];
+        computeLayout(now, start, end);
+        for (int p = 0; p < PERIOD_COUNT; p++) {
+            slideWindow(p, start[p], end[p]);
+        }
+    } else {
+        // Within a period only its start (now) moves, past one hour at a time
+        slideWindow(currentPeriod, now, windows[currentPeriod].end);
+    }
+    
+    // Nothing changes before the next hour leaves the current window or the period ends
+    const PeriodWindow& window = windows[currentPeriod];
+    nextEvent = layoutUntil;
+    if (window.first < window.last && (time_t)hourly.dt[window.first] + 1 < nextEvent) {
+        nextEvent = (time_t)hourly.dt[window.first] + 1;
+    }
+    lastNow = now;
+    windowsValid = true;
+    
+    // Morning and afternoon always show the day variant, night the night variant
+    ForecastSummary previous[PERIOD_COUNT];
+    memcpy(previous, summaries, sizeof(previous));
+    for (int p = 0; p < PERIOD_COUNT; p++) {
+        summarizePeriod(windows[p].totals, p == PERIOD_NIGHT, summaries[p]);
+    }
+    
+    #if WEATHER_DEBUG
+    DEBUG_PRINTF("Forecast summary (%u/%u/%u datapoints): morning %.1f°C %u%% icon %u, "
+                 "afternoon %.1f°C %u%% icon %u, night %.1f°C %u%% icon %u\n",
+                 windows[PERIOD_MORNING].totals.count, windows[PERIOD_AFTERNOON].totals.count,
+                 windows[PERIOD_NIGHT].totals.count,
+                 summaries[PERIOD_MORNING].avgTempCenti / 100.0f, summaries[PERIOD_MORNING].avgPop,
+                 (unsigned)summaries[PERIOD_MORNING].icon,
+                 summaries[PERIOD_AFTERNOON].avgTempCenti / 100.0f, summaries[PERIOD_AFTERNOON].avgPop,
+                 (unsigned)summaries[PERIOD_AFTERNOON].icon,
+                 summaries[PERIOD_NIGHT].avgTempCenti / 100.0f, summaries[PERIOD_NIGHT].avgPop,
+                 (unsigned)summaries[PERIOD_NIGHT].icon);
+    #endif
+    return memcmp(previous, summaries, sizeof(previous)) != 0;
+}
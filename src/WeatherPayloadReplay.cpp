@@ -0,0 +1,88 @@
+#include "WeatherPayloadReplay.h"
+#include "debug_config.h"
+
+const char* const WEATHER_REPLAY_ZONE_NAMES[WEATHER_REPLAY_ZONES] = {
+    "CET-1CEST,M3.5.0,M10.5.0/3",
+    "UTC0",
+    "EST5EDT,M3.2.0,M11.1.0",
+    "JST-9"
+};
+
+const uint8_t WEATHER_REPLAY_HOUR_OFFSETS[WEATHER_REPLAY_HOURS] = {0, 6, 12, 18};
+
+const char* const WEATHER_PERIOD_NAMES[PERIOD_COUNT] = {"morning", "afternoon", "night"};
+
+bool replayWeatherPayload(WeatherParseBuffers& buffers, WeatherModel& model, WeatherModel& check,
+                          WeatherReplayResult& result) {
+    memset(&result, 0, sizeof(result));
+
+    uint32_t start = micros();
+    result.parsed = model.parse(buffers, result.peakDocument);
+    result.parseUs = micros() - start;
+    result.bytes = buffers.reader.bytesRead();
+    if (!result.parsed) {
+        DEBUG_PRINTF("  Parse failed after %u bytes\n", (unsigned)result.bytes);
+        return false;
+    }
+    DEBUG_PRINTF("  Parsed %u bytes in %u us: %d hours, %u descriptions (%u bytes), peak document %u of %u bytes\n",
+                 (unsigned)result.bytes, result.parseUs, model.hourlyCount, model.descriptions.count,
+                 model.descriptions.used, (unsigned)result.peakDocument, WEATHER_ENTRY_DOC_SIZE);
+
+    for (int z = 0; z < WEATHER_REPLAY_ZONES; z++) {
+        setenv("TZ", WEATHER_REPLAY_ZONE_NAMES[z], 1);
+        tzset();
+        DEBUG_PRINTF("  TZ %s\n", WEATHER_REPLAY_ZONE_NAMES[z]);
+        for (int h = 0; h < WEATHER_REPLAY_HOURS; h++) {
+            time_t now = (time_t)model.current.dt + WEATHER_REPLAY_HOUR_OFFSETS[h] * 3600;
+            struct tm local;
+            localtime_r(&now, &local);
+
+            start = micros();
+            model.summarize(now);
+            uint32_t summarizeUs = micros() - start;
+            if (summarizeUs > result.maxSummarizeUs) {
+                result.maxSummarizeUs = summarizeUs;
+            }
+
+            DEBUG_PRINTF("    %02d:%02d", local.tm_hour, local.tm_min);
+            for (int p = 0; p < PERIOD_COUNT; p++) {
+                const ForecastSummary& summary = model.summaries[p];
+                DEBUG_PRINTF("  %s %.2f/%u%%/%u", WEATHER_PERIOD_NAMES[p], summary.avgTempCenti / 100.0f,
+                             summary.avgPop, (unsigned)summary.icon);
+            }
+            DEBUG_PRINTF("  (%u us)\n", summarizeUs);
+        }
+
+        // Follow the clock minute by minute as the service does and compare
+        // with a full recomputation at every change
+        model.summarize((time_t)model.current.dt);
+        uint32_t changes = 0;
+        uint32_t mismatches = 0;
+        uint32_t maxAdvanceUs = 0;
+        uint64_t totalAdvanceUs = 0;
+        for (uint32_t minute = 1; minute <= WEATHER_REPLAY_MINUTES; minute++) {
+            time_t now = (time_t)model.current.dt + minute * 60;
+            start = micros();
+            bool changed = model.advance(now);
+            uint32_t advanceUs = micros() - start;
+            totalAdvanceUs += advanceUs;
+            if (advanceUs > maxAdvanceUs) {
+                maxAdvanceUs = advanceUs;
+            }
+            if (changed) {
+                changes++;
+                check = model;
+                check.summarize(now);
+                if (memcmp(check.summaries, model.summaries, sizeof(model.summaries)) != 0) {
+                    mismatches++;
+                }
+            }
+        }
+        DEBUG_PRINTF("    Incremental over %u min: %u changes, %u mismatches, mean %u us, max %u us\n",
+                     WEATHER_REPLAY_MINUTES, changes, mismatches,
+                     (uint32_t)(totalAdvanceUs / WEATHER_REPLAY_MINUTES), maxAdvanceUs);
+        result.changes += changes;
+        result.mismatches += mismatches;
+    }
+    return result.mismatches == 0;
+}
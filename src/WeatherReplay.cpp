@@ -0,0 +1,113 @@
+#include "WeatherReplay.h"
+#include <SD.h>
+#include <new>
+#include "WeatherService.h"
+#include "WeatherPayloadReplay.h"
+#include "ClockService.h"
+#include "SerialConsole.h"
+#include "debug_config.h"
+
+static void weatherCommand(const char* args) {
+    if (args && strcmp(args, "replay") == 0) {
+        WeatherReplay::run();
+    } else {
+        WeatherReplay::printStatus();
+    }
+}
+
+void WeatherReplay::begin() {
+    SerialConsole::getInstance()->registerCommand("weather", "Weather locations, data age and memory ('weather replay')", weatherCommand);
+}
+
+void WeatherReplay::printStatus() {
+    const WeatherService& service = WeatherService::getInstance();
+    const ClockSnapshot& clock = ClockService::getInstance()->now();
+
+    int allocated = 0;
+    for (int i = 0; i < service.getLocationCount(); i++) {
+        const WeatherLocation* location = service.getLocation(i);
+        if (location == nullptr) {
+            continue;
+        }
+        allocated++;
+        const WeatherModel& model = location->model;
+        DEBUG_PRINTF("%c%d %s (%.4f, %.4f): %d hours", i == service.getDisplayedLocation() ? '*' : ' ', i,
+                     location->name[0] ? location->name : "-", location->lat, location->lon, model.hourlyCount);
+        if (location->fetchedAt == 0 || !clock.valid) {
+            DEBUG_PRINTLN(", data age unknown");
+        } else {
+            DEBUG_PRINTF(", fetched %ld s ago, observed %ld s ago, next refresh in %ld s\n",
+                         (long)(clock.epoch - location->fetchedAt), (long)(clock.epoch - (time_t)model.current.dt),
+                         (long)(location->nextRefresh - clock.epoch));
+        }
+        if (location->failedAttempts > 0) {
+            DEBUG_PRINTF("   %u failed attempts, retry after %u s\n", location->failedAttempts, location->retryDelay);
+        }
+        DEBUG_PRINTF("   Descriptions: %u of %u, %u of %u bytes\n", model.descriptions.count, WEATHER_MAX_DESCRIPTIONS,
+                     model.descriptions.used, WEATHER_DESCRIPTION_POOL);
+        for (int p = 0; p < PERIOD_COUNT; p++) {
+            const ForecastSummary& summary = model.summaries[p];
+            DEBUG_PRINTF("   %-9s %6.2f, %3u%% pop, icon %u\n", WEATHER_PERIOD_NAMES[p], summary.avgTempCenti / 100.0f,
+                         summary.avgPop, (unsigned)summary.icon);
+        }
+    }
+    DEBUG_PRINTF("Memory: %d location(s) x %u bytes + %u bytes shared parse buffers = %u bytes\n",
+                 allocated, (unsigned)sizeof(WeatherLocation), (unsigned)service.getSharedBytes(),
+                 (unsigned)(allocated * sizeof(WeatherLocation) + service.getSharedBytes()));
+}
+
+static void replayFile(File& file, WeatherParseBuffers& buffers, WeatherModel& model, WeatherModel& check) {
+    DEBUG_PRINTF("%s (%u bytes)\n", file.name(), (unsigned)file.size());
+    buffers.reader.begin(&file);
+    WeatherReplayResult result;
+    replayWeatherPayload(buffers, model, check, result);
+}
+
+void WeatherReplay::run() {
+    File dir = SD.open(WEATHER_REPLAY_DIR);
+    if (!dir || !dir.isDirectory()) {
+        DEBUG_PRINTF("No recorded payloads: %s is missing\n", WEATHER_REPLAY_DIR);
+        return;
+    }
+
+    // Models of its own, so the live data and the screen stay untouched;
+    // the second one holds the full recomputations
+    WeatherModel* model = new (std::nothrow) WeatherModel[2];
+    WeatherParseBuffers* buffers = new (std::nothrow) WeatherParseBuffers();
+    if (model == nullptr || buffers == nullptr) {
+        DEBUG_PRINTLN("Not enough memory for the replay");
+        delete[] model;
+        delete buffers;
+        dir.close();
+        return;
+    }
+    DEBUG_PRINTF("Model %u bytes, parse buffers %u bytes (read %u, documents %u + %u)\n",
+                 (unsigned)sizeof(WeatherModel), (unsigned)sizeof(WeatherParseBuffers), WEATHER_READ_BUFFER_SIZE,
+                 WEATHER_FILTER_SIZE, WEATHER_ENTRY_DOC_SIZE);
+
+    // Summaries are computed in local time; the configured zone is restored afterwards
+    String savedZone = getenv("TZ") ? getenv("TZ") : "";
+
+    int replayed = 0;
+    File file;
+    while (replayed < WEATHER_REPLAY_MAX_FILES && (file = dir.openNextFile())) {
+        const char* name = file.name();
+        size_t length = strlen(name);
+        if (!file.isDirectory() && length > 5 && strcmp(name + length - 5, ".json") == 0) {
+            replayFile(file, *buffers, model[0], model[1]);
+            replayed++;
+        }
+        file.close();
+    }
+    dir.close();
+    delete[] model;
+    delete buffers;
+
+    if (savedZone.isEmpty()) {
+        unsetenv("TZ");
+    } else {
+        setenv("TZ", savedZone.c_str(), 1);
+    }
+    tzset();
+    DEBUG_PRINTF("%d payload(s) replayed from %s\n", replayed, WEATHER_REPLAY_DIR);
+}
@@ -2,80 +2,333 @@
 #include "ui.h"
 #include <screens.h>  // Include for the objects struct from EEZ Studio UI
 #include <images.h>  // Include for weather icon images
-#include <map>
+#include <esp_heap_caps.h>
 #include <vars.h>     // Include for EEZ global variable enums
 #include <eez-flow.h> // Include for EEZ flow framework
 #include <structs.h>  // Include for WeatherValue struct
+#include <new>
 #include "debug_config.h"
+#include "Profiler.h"
+#include "AllocTracker.h"
+#include "PsramAllocator.h"
+#include "DeferredLog.h"
+#include "PowerManager.h"
+#include "ClockService.h"
+#include "HttpsConnection.h"
+#include "AudioManager.h"
+#include <SD.h>
 
-// Forward declaration for getIconForCode method
-const void* getIconForCode(const String& iconCode);
-
-// Define static constants
-const int WeatherService::MAX_HOURLY_FORECASTS;
+// Requests that come due together follow each other on the same connection
+static_assert(WEATHER_FETCH_GAP_MS < HTTPS_KEEPALIVE_MS, "Fetch gap outlasts the kept-alive connection");
 
 // Initialize the static instance pointer
 WeatherService* WeatherService::instance = nullptr;
 
-bool WeatherService::init(const String& apiKey, float latitude, float longitude, 
+// EEZ Studio image for each WeatherIcon, in enum order
+static constexpr const lv_img_dsc_t* ICON_IMAGES[(int)WeatherIcon::COUNT] = {
+    &img_01d, &img_01n, &img_02d, &img_02n, &img_03d, &img_03n, &img_04d, &img_04n, &img_09d,
+    &img_09n, &img_10d, &img_10n, &img_11d, &img_11n, &img_13d, &img_13n, &img_50d, &img_50n
+};
+
+// The morning/afternoon/night windows follow the clock, so the summaries
+// are moved along the stored hourly data every minute (a no-op unless an
+// hour, sunrise, noon or sunset was crossed). A clock jump or DST change
+// rebuilds them. The card rotation counts seconds.
+static void weatherClockCallback(const ClockSnapshot& snapshot, uint8_t events, void* context) {
+    WeatherService* service = static_cast<WeatherService*>(context);
+    if (events & (CLOCK_MINUTE | CLOCK_DST | CLOCK_SYNC)) {
+        service->refreshForecastSummaries(snapshot, (events & (CLOCK_SYNC | CLOCK_DST)) != 0);
+    }
+    if (events & CLOCK_SECOND) {
+        service->rotate();
+    }
+}
+
+static void cachePath(int index, char* path, size_t size) {
+    if (index == 0) {
+        strncpy(path, WEATHER_CACHE_FILE, size - 1);
+        path[size - 1] = '\0';
+    } else {
+        snprintf(path, size, WEATHER_CACHE_PATTERN, index);
+    }
+}
+
+static bool hasData(const WeatherLocation* location) {
+    return location != nullptr && location->model.current.dt != 0;
+}
+
+WeatherService::WeatherService() : appid(""), units("metric"), lang("de") {
+    memset(locations, 0, sizeof(locations));
+}
+
+WeatherLocation* WeatherService::allocateLocation(int index) {
+    if (locations[index] == nullptr) {
+        ALLOC_SCOPE(AllocTag::WEATHER);
+        void* memory = Psram::allocate(sizeof(WeatherLocation));
+        if (memory == nullptr) {
+            LOG_ERROR(WEATHER, "No memory for weather location %d (%u bytes)", index, (unsigned)sizeof(WeatherLocation));
+            return nullptr;
+        }
+        locations[index] = new (memory) WeatherLocation();
+    }
+    return locations[index];
+}
+
+void WeatherService::releaseLocation(int index) {
+    if (locations[index] != nullptr) {
+        locations[index]->~WeatherLocation();
+        Psram::deallocate(locations[index]);
+        locations[index] = nullptr;
+    }
+}
+
+bool WeatherService::init(const String& apiKey, const WeatherLocationConfig* configs, int count,
                          const String& unitSystem, const String& language) {
     // Validate parameters
-    if (apiKey.isEmpty() || latitude == 0.0f || longitude == 0.0f) {
+    if (apiKey.isEmpty() || count <= 0) {
         #if WEATHER_DEBUG
         DEBUG_PRINTLN("Weather service initialization failed: invalid parameters");
-        DEBUG_PRINTF("API Key [%s], Lat [%.6f], Lon [%.6f]\n", 
-                    apiKey.isEmpty() ? "EMPTY" : apiKey.c_str(), latitude, longitude);
+        DEBUG_PRINTF("API Key [%s], %d location(s)\n", apiKey.isEmpty() ? "EMPTY" : apiKey.c_str(), count);
         #endif
         return false;
     }
     
     // Store configuration parameters
     appid = apiKey;
-    lat = latitude;
-    lon = longitude;
     units = unitSystem;
     lang = language;
     
+    count = min(count, WEATHER_MAX_LOCATIONS);
+    for (int i = 0; i < count; i++) {
+        WeatherLocation* location = allocateLocation(i);
+        if (location == nullptr) {
+            count = i;
+            break;
+        }
+        strncpy(location->name, configs[i].name.c_str(), WEATHER_LOCATION_NAME_LENGTH - 1);
+        location->name[WEATHER_LOCATION_NAME_LENGTH - 1] = '\0';
+        location->lat = configs[i].lat;
+        location->lon = configs[i].lon;
+        
+        // A cached snapshot of another place is shown until the first fetch
+        if (location->fetchedAt != 0 && (location->cachedLat != location->lat || location->cachedLon != location->lon)) {
+            LOG_INFO(WEATHER, "Location %d changed, cached weather is stale", i);
+            location->fetchedAt = 0;
+        }
+    }
+    
+    // Slots restored from SD for locations that are no longer configured
+    for (int i = count; i < WEATHER_MAX_LOCATIONS; i++) {
+        if (locations[i] != nullptr) {
+            char path[24];
+            cachePath(i, path, sizeof(path));
+            SD.remove(path);
+            releaseLocation(i);
+        }
+    }
+    locationCount = count;
+    if (displayed >= locationCount) {
+        displayed = 0;
+        updateWeatherUI();
+    }
+    
+    if (!clockSubscribed) {
+        clockSubscribed = ClockService::getInstance()->subscribe(CLOCK_SECOND | CLOCK_MINUTE | CLOCK_DST | CLOCK_SYNC,
+                                                                 weatherClockCallback, this);
+    }
+    
+    LOG_INFO(WEATHER, "%d location(s), %u bytes each, %u bytes shared parse buffers",
+             locationCount, (unsigned)sizeof(WeatherLocation), (unsigned)sizeof(WeatherParseBuffers));
+    
     #if WEATHER_DEBUG
     DEBUG_PRINTLN("Weather service initialized successfully");
     DEBUG_PRINTF("API Key: %s\n", appid.c_str());
-    DEBUG_PRINTF("Location: %.6f, %.6f\n", lat, lon);
+    for (int i = 0; i < locationCount; i++) {
+        DEBUG_PRINTF("Location %d: %s %.6f, %.6f\n", i, locations[i]->name, locations[i]->lat, locations[i]->lon);
+    }
     DEBUG_PRINTF("Units: %s, Language: %s\n", units.c_str(), lang.c_str());
     #endif
     
-    return true;
+    return locationCount > 0;
 }
 
 bool WeatherService::update() {
-    uint32_t currentTime = ::millis();
+    // One request at a time, spaced out
+    if (lastFetchMs != 0 && ::millis() - lastFetchMs < WEATHER_FETCH_GAP_MS) {
+        return false;
+    }
     
-    // Check if this is the first update after boot or if update interval has passed
-    if (lastUpdateTime == 0 || currentTime - lastUpdateTime >= updateInterval) {
-        #if WEATHER_DEBUG
-        if (lastUpdateTime == 0) {
-            DEBUG_PRINTLN("First weather update after boot");
-        } else {
-            DEBUG_PRINTLN("Weather update interval passed");
-        }
-        #endif
-        return forceUpdate();
+    const ClockSnapshot& clock = ClockService::getInstance()->now();
+    int index = nextDueLocation(clock);
+    if (index < 0) {
+        return false; // Data is still current
+    }
+    
+    // The TLS handshake and parsing would hold up a stream that is filling its buffer
+    if (audioManager.isStarting()) {
+        LOG_DEBUG(WEATHER, "Audio is starting, deferring the fetch for location %d", index);
+        return false;
     }
     
-    return false; // No update needed
+    #if WEATHER_DEBUG
+    if (locations[index]->fetchedAt == 0) {
+        DEBUG_PRINTF("No current weather data for location %d, fetching\n", index);
+    } else {
+        DEBUG_PRINTF("Weather data for location %d is %ld s old, fetching\n", index,
+                     (long)(clock.epoch - locations[index]->fetchedAt));
+    }
+    #endif
+    return forceUpdate(index);
 }
 
-bool WeatherService::forceUpdate() {
-    bool success = fetchWeatherData();
-    if (success) {
-        lastUpdateTime = ::millis();
-        calculateDailyForecasts();
+// The due location that has waited longest; locations without data first
+int WeatherService::nextDueLocation(const ClockSnapshot& clock) const {
+    int best = -1;
+    for (int i = 0; i < locationCount; i++) {
+        const WeatherLocation* location = locations[i];
+        if (location == nullptr || !isRefreshDue(*location, clock)) {
+            continue;
+        }
+        if (location->fetchedAt == 0) {
+            return i;
+        }
+        if (best < 0 || location->nextRefresh < locations[best]->nextRefresh) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+bool WeatherService::forceUpdate(int index) {
+    if (index < 0 || index >= locationCount || locations[index] == nullptr) {
+        return false;
+    }
+    WeatherLocation& location = *locations[index];
+    
+    location.lastAttemptMs = ::millis();
+    bool success = fetchWeatherData(location);
+    lastFetchMs = ::millis();
+    if (!success) {
+        // Back off while the network or the provider is failing
+        location.retryDelay = location.failedAttempts == 0 ? WEATHER_RETRY_MIN_S
+                            : min(location.retryDelay * 2, (uint32_t)WEATHER_RETRY_MAX_S);
+        location.failedAttempts++;
+        LOG_WARN(WEATHER, "Fetch for location %d failed (%u in a row), retrying in %u s",
+                 index, location.failedAttempts, location.retryDelay);
+        return false;
+    }
+    
+    location.failedAttempts = 0;
+    const ClockSnapshot& clock = ClockService::getInstance()->now();
+    location.fetchedAt = clock.valid ? clock.epoch : 0;
+    scheduleRefresh(location);
+    calculateDailyForecasts(location);
+    if (index == displayed || !hasData(locations[displayed])) {
+        displayed = index;
         updateWeatherUI();
     }
+    saveCache(index);
+    
+    return true;
+}
+
+// The provider recomputes the current conditions about every
+// WEATHER_PROVIDER_INTERVAL_S; fetching earlier returns the same data
+void WeatherService::scheduleRefresh(WeatherLocation& location) {
+    time_t providerUpdate = (time_t)location.model.current.dt + WEATHER_PROVIDER_INTERVAL_S + WEATHER_REFRESH_MARGIN_S;
+    time_t earliest = location.fetchedAt + WEATHER_MIN_REFRESH_S;
+    location.nextRefresh = providerUpdate > earliest ? providerUpdate : earliest;
     
-    return success;
+    #if WEATHER_DEBUG
+    DEBUG_PRINTF("Weather observed %ld s before fetch, next refresh in %ld s\n",
+                 (long)(location.fetchedAt - location.model.current.dt),
+                 (long)(location.nextRefresh - location.fetchedAt));
+    #endif
 }
 
-bool WeatherService::fetchWeatherData() {
+bool WeatherService::isRefreshDue(const WeatherLocation& location, const ClockSnapshot& clock) const {
+    if (location.failedAttempts > 0 && ::millis() - location.lastAttemptMs < location.retryDelay * 1000UL) {
+        return false;
+    }
+    if (!clock.valid) {
+        // The data age is unknown until the clock is set; only fill an empty screen
+        return location.model.current.dt == 0;
+    }
+    return location.fetchedAt == 0 || clock.epoch >= location.nextRefresh;
+}
+
+void WeatherService::refreshForecastSummaries(const ClockSnapshot& clock, bool rebuild) {
+    if (!clock.valid) {
+        return;
+    }
+    bool dropped = false;
+    for (int i = 0; i < locationCount; i++) {
+        WeatherLocation* location = locations[i];
+        if (location == nullptr) {
+            continue;
+        }
+        // A snapshot restored before the clock was set gets its age checked here
+        if (rebuild && hasData(location) &&
+            clock.epoch - (time_t)location->model.current.dt > WEATHER_CACHE_MAX_AGE_S) {
+            dropLocationData(i, clock);
+            dropped = true;
+            continue;
+        }
+        if (location->model.hourlyCount == 0) {
+            continue;
+        }
+        if (rebuild) {
+            location->model.resetWindows();
+        }
+        if (location->model.advance(clock.epoch) && i == displayed) {
+            updateWeatherUI();
+        }
+    }
+    if (dropped && !hasData(locations[displayed]) && !showNextLocation()) {
+        updateWeatherUI();
+    }
+}
+
+void WeatherService::dropLocationData(int index, const ClockSnapshot& clock) {
+    WeatherLocation& location = *locations[index];
+    LOG_INFO(WEATHER, "Weather for location %d is %ld h old, dropping it", index,
+             (long)((clock.epoch - (time_t)location.model.current.dt) / 3600));
+    location.model.clear();
+    location.fetchedAt = 0;
+    location.nextRefresh = 0;
+    
+    char path[24];
+    cachePath(index, path, sizeof(path));
+    SD.remove(path);
+}
+
+bool WeatherService::showNextLocation() {
+    for (int step = 1; step < locationCount; step++) {
+        int next = (displayed + step) % locationCount;
+        if (hasData(locations[next])) {
+            displayed = next;
+            updateWeatherUI();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WeatherService::rotate() {
+    if (++rotateSeconds < WEATHER_ROTATE_S) {
+        return;
+    }
+    rotateSeconds = 0;
+    showNextLocation();
+}
+
+bool WeatherService::fetchWeatherData(WeatherLocation& location) {
+    PROFILE_ZONE("weather.fetch");
+    ALLOC_SCOPE(AllocTag::WEATHER);
+    PowerActivityScope networkActive(PowerSubsystem::NETWORK);
+    LOG_DEBUG(HEAP, "Before weather fetch - internal free: %u, min free: %u",
+              heap_caps_get_free_size(MALLOC_CAP_INTERNAL), heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    
     if (!WiFi.isConnected()) {
         #if WEATHER_DEBUG
         DEBUG_PRINTLN("Cannot fetch weather: WiFi not connected");
@@ -84,64 +337,69 @@ bool WeatherService::fetchWeatherData() {
     }
     
     // Check if API key is available
-    if (appid.isEmpty() || lat == 0.0f || lon == 0.0f) {
+    if (appid.isEmpty() || location.lat == 0.0f || location.lon == 0.0f) {
         #if WEATHER_DEBUG
         DEBUG_PRINTLN("Weather API configuration is incomplete:");
         DEBUG_PRINTF("API Key [%s], Lat [%.6f], Lon [%.6f]\n", 
-                    appid.isEmpty() ? "EMPTY" : appid.c_str(), lat, lon);
+                    appid.isEmpty() ? "EMPTY" : appid.c_str(), location.lat, location.lon);
         #endif
         return false;
     }
     
-    HTTPClient http;
-    String url = "https://api.openweathermap.org/data/3.0/onecall?lat=" + String(lat, 6) +
-                "&lon=" + String(lon, 6) +
+    if (parseBuffers == nullptr) {
+        void* memory = Psram::allocate(sizeof(WeatherParseBuffers));
+        if (memory == nullptr) {
+            LOG_ERROR(WEATHER, "No memory for the parse buffers (%u bytes)", (unsigned)sizeof(WeatherParseBuffers));
+            return false;
+        }
+        parseBuffers = new (memory) WeatherParseBuffers();
+    }
+    
+    String uri = "/data/3.0/onecall?lat=" + String(location.lat, 6) +
+                "&lon=" + String(location.lon, 6) +
                 "&appid=" + appid +
                 "&units=" + units +
                 "&lang=" + lang +
-                "&exclude=minutely,alerts";
+                "&exclude=minutely,daily,alerts";
     
     #if WEATHER_DEBUG
-    DEBUG_PRINTF("Fetching weather data from: %s\n", url.c_str());
+    DEBUG_PRINTF("Fetching weather data from: %s%s\n", WEATHER_API_HOST, uri.c_str());
     #endif
     
-    http.begin(url);
-    int httpResponseCode = http.GET();
+    // The shared connection is kept alive between requests where the server allows it
+    HttpsConnectionManager* https = HttpsConnectionManager::getInstance();
+    int httpResponseCode = https->get(WEATHER_API_HOST, uri);
     
     if (httpResponseCode != 200) {
         #if WEATHER_DEBUG
         DEBUG_PRINTF("HTTP error code: %d\n", httpResponseCode);
-        if (httpResponseCode > 0) {
-            DEBUG_PRINTF("Response: %s\n", http.getString().c_str());
-        }
         #endif
-        http.end();
+        https->end();
         return false;
     }
     
-    String payload = http.getString();
-    http.end();
-    
-    #if WEATHER_DEBUG
-    DEBUG_PRINTLN("Weather data fetched successfully");
-    //DEBUG_PRINTLN(payload); // Only uncomment for debugging - this can be large
-    #endif
-    
-    // Parse JSON response
-    DynamicJsonDocument doc(32768); // Adjust size based on your needs
-    DeserializationError error = deserializeJson(doc, payload);
-    
-    if (error) {
+    // Parse straight from the connection: only the filtered fields of one
+    // object at a time are ever held in memory
+    uint32_t parseStart = ::millis();
+    WeatherStreamReader& reader = parseBuffers->reader;
+    reader.begin(https->getBody());
+    size_t peakDocument = 0;
+    bool parsed = location.model.parse(*parseBuffers, peakDocument);
+    reader.begin(nullptr);
+    https->end();
+
+    if (!parsed) {
         #if WEATHER_DEBUG
-        DEBUG_PRINT("JSON parsing error: ");
-        DEBUG_PRINTLN(error.c_str());
+        DEBUG_PRINTF("Weather response could not be parsed (%u bytes read)\n", (unsigned)reader.bytesRead());
         #endif
         return false;
     }
-    
-    // Extract data from JSON
-    parseCurrentWeather(doc["current"]);
-    parseHourlyForecast(doc["hourly"]);
+
+    LOG_DEBUG(WEATHER, "Parsed %u bytes in %u ms, %d hours, peak document %u bytes",
+              (unsigned)reader.bytesRead(), (unsigned)(::millis() - parseStart),
+              location.model.hourlyCount, (unsigned)peakDocument);
+    LOG_DEBUG(HEAP, "After weather fetch - internal free: %u, min free: %u",
+              heap_caps_get_free_size(MALLOC_CAP_INTERNAL), heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
     
     #if WEATHER_DEBUG
     DEBUG_PRINTLN("Weather data parsed successfully");
@@ -150,654 +408,288 @@ bool WeatherService::fetchWeatherData() {
     return true;
 }
 
-void WeatherService::parseCurrentWeather(const JsonObject& current) {
-    currentWeather.dt = current["dt"].as<long>();
-    currentWeather.sunrise = current["sunrise"].as<long>();
-    currentWeather.sunset = current["sunset"].as<long>();
-    currentWeather.temp = current["temp"].as<float>();
-    currentWeather.feels_like = current["feels_like"].as<float>();
-    currentWeather.pressure = current["pressure"].as<int>();
-    currentWeather.humidity = current["humidity"].as<int>();
-    currentWeather.dew_point = current["dew_point"].as<float>();
-    currentWeather.uvi = current["uvi"].as<float>();
-    currentWeather.clouds = current["clouds"].as<int>();
-    currentWeather.visibility = current["visibility"].as<int>();
-    currentWeather.wind_speed = current["wind_speed"].as<float>();
-    currentWeather.wind_deg = current["wind_deg"].as<int>();
-    
-    // Optional fields that may not be present
-    currentWeather.wind_gust = current.containsKey("wind_gust") ? current["wind_gust"].as<float>() : 0;
-    currentWeather.rain_1h = 0;
-    currentWeather.snow_1h = 0;
-    
-    if (current.containsKey("rain")) {
-        JsonObject rain = current["rain"];
-        if (rain.containsKey("1h")) {
-            currentWeather.rain_1h = rain["1h"].as<float>();
-        }
+void WeatherService::calculateDailyForecasts(WeatherLocation& location) {
+    // The periods are relative to the local time from the shared clock snapshot
+    const ClockSnapshot& clock = ClockService::getInstance()->now();
+    if (!clock.valid) {
+        LOG_WARN(WEATHER, "Clock not set, skipping forecast summaries");
+        return;
     }
-    
-    if (current.containsKey("snow")) {
-        JsonObject snow = current["snow"];
-        if (snow.containsKey("1h")) {
-            currentWeather.snow_1h = snow["1h"].as<float>();
+    location.model.summarize(clock.epoch);
+}
+
+//####################################################################################################
+// Persistent cache
+//####################################################################################################
+
+struct WeatherCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hourlyCount;
+    int64_t fetchedAt;
+    int64_t nextRefresh;
+    float lat;
+    float lon;
+    char name[WEATHER_LOCATION_NAME_LENGTH];
+};
+
+// The storage is plain data, so the file is the header followed by
+// the in-memory structures as they are
+struct WeatherCacheBody {
+    CurrentWeather current;
+    ForecastSummary summaries[PERIOD_COUNT];        // Morning, afternoon, night
+    HourlyForecasts hourly;
+    DescriptionTable descriptions;
+};
+
+bool WeatherService::restoreCache() {
+    bool restored = false;
+    for (int i = 0; i < WEATHER_MAX_LOCATIONS; i++) {
+        if (restoreLocation(i)) {
+            restored = true;
+            locationCount = max(locationCount, i + 1);
         }
     }
-    
-    // Weather description and icon
-    JsonArray weatherArray = current["weather"];
-    if (weatherArray.size() > 0) {
-        JsonObject weather = weatherArray[0];
-        currentWeather.weather_id = weather["id"].as<int>();
-        currentWeather.weather_main = weather["main"].as<const char*>();
-        currentWeather.weather_description = weather["description"].as<const char*>();
-        currentWeather.weather_icon = weather["icon"].as<const char*>();
+    if (!restored) {
+        return false;
     }
     
-    #if WEATHER_DEBUG
-    DEBUG_PRINTLN("Current weather:");
-    DEBUG_PRINTF("  Temperature: %.1f°C\n", currentWeather.temp);
-    DEBUG_PRINTF("  Feels like: %.1f°C\n", currentWeather.feels_like);
-    DEBUG_PRINTF("  Humidity: %d%%\n", currentWeather.humidity);
-    DEBUG_PRINTF("  Weather: %s (%s)\n", currentWeather.weather_main.c_str(), currentWeather.weather_description.c_str());
-    DEBUG_PRINTF("  Icon: %s\n", currentWeather.weather_icon.c_str());
-    #endif
+    // The saved summaries are shown as they were; the next clock tick
+    // (or the clock sync) recomputes them for the current time
+    displayed = 0;
+    while (displayed < locationCount - 1 && !hasData(locations[displayed])) {
+        displayed++;
+    }
+    updateWeatherUI();
+    return true;
 }
 
-void WeatherService::parseHourlyForecast(const JsonArray& hourly) {
-    hourlyForecastCount = min((int)hourly.size(), MAX_HOURLY_FORECASTS);
+bool WeatherService::restoreLocation(int index) {
+    PROFILE_ZONE("weather.restore");
+    char path[24];
+    cachePath(index, path, sizeof(path));
+    File file = SD.open(path, FILE_READ);
+    if (!file) {
+        return false;
+    }
     
-    for (int i = 0; i < hourlyForecastCount; i++) {
-        JsonObject hourData = hourly[i];
-        
-        hourlyForecasts[i].dt = hourData["dt"].as<long>();
-        hourlyForecasts[i].temp = hourData["temp"].as<float>();
-        hourlyForecasts[i].feels_like = hourData["feels_like"].as<float>();
-        hourlyForecasts[i].pressure = hourData["pressure"].as<int>();
-        hourlyForecasts[i].humidity = hourData["humidity"].as<int>();
-        hourlyForecasts[i].dew_point = hourData["dew_point"].as<float>();
-        hourlyForecasts[i].clouds = hourData["clouds"].as<int>();
-        hourlyForecasts[i].visibility = hourData.containsKey("visibility") ? hourData["visibility"].as<int>() : 0;
-        hourlyForecasts[i].wind_speed = hourData["wind_speed"].as<float>();
-        hourlyForecasts[i].wind_deg = hourData["wind_deg"].as<int>();
-        hourlyForecasts[i].wind_gust = hourData.containsKey("wind_gust") ? hourData["wind_gust"].as<float>() : 0;
-        hourlyForecasts[i].pop = hourData["pop"].as<float>();
-        
-        // Rain and snow (optional)
-        hourlyForecasts[i].rain_1h = 0;
-        hourlyForecasts[i].snow_1h = 0;
-        
-        if (hourData.containsKey("rain")) {
-            if (hourData["rain"].is<JsonObject>()) {
-                JsonObject rain = hourData["rain"];
-                if (rain.containsKey("1h")) {
-                    hourlyForecasts[i].rain_1h = rain["1h"].as<float>();
-                }
-            } else {
-                // Sometimes the API returns rain as a direct value
-                hourlyForecasts[i].rain_1h = hourData["rain"].as<float>();
-            }
-        }
-        
-        if (hourData.containsKey("snow")) {
-            if (hourData["snow"].is<JsonObject>()) {
-                JsonObject snow = hourData["snow"];
-                if (snow.containsKey("1h")) {
-                    hourlyForecasts[i].snow_1h = snow["1h"].as<float>();
-                }
-            } else {
-                hourlyForecasts[i].snow_1h = hourData["snow"].as<float>();
-            }
-        }
-        
-        // Weather description and icon
-        JsonArray weatherArray = hourData["weather"];
-        if (weatherArray.size() > 0) {
-            JsonObject weather = weatherArray[0];
-            hourlyForecasts[i].weather_id = weather["id"].as<int>();
-            hourlyForecasts[i].weather_main = weather["main"].as<const char*>();
-            hourlyForecasts[i].weather_description = weather["description"].as<const char*>();
-            hourlyForecasts[i].weather_icon = weather["icon"].as<const char*>();
-        }
+    WeatherCacheHeader header;
+    WeatherCacheBody body;
+    bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == WEATHER_CACHE_MAGIC && header.version == WEATHER_CACHE_VERSION &&
+              header.hourlyCount <= WEATHER_MAX_HOURLY &&
+              file.size() == sizeof(header) + sizeof(WeatherCacheBody) &&
+              file.read((uint8_t*)&body, sizeof(body)) == sizeof(body) &&
+              body.descriptions.count <= WEATHER_MAX_DESCRIPTIONS &&
+              body.descriptions.used <= WEATHER_DESCRIPTION_POOL;
+    file.close();
+    if (!ok) {
+        LOG_WARN(WEATHER, "%s has an unknown format, ignoring it", path);
+        SD.remove(path);
+        return false;
     }
     
-    #if WEATHER_DEBUG
-    DEBUG_PRINTF("Parsed %d hourly forecasts\n", hourlyForecastCount);
-    #endif
+    // Past the hourly horizon the snapshot has nothing left to show. Without
+    // a clock the age is unknown; refreshForecastSummaries() checks it on sync.
+    const ClockSnapshot& clock = ClockService::getInstance()->now();
+    if (clock.valid && clock.epoch - (time_t)header.fetchedAt > WEATHER_CACHE_MAX_AGE_S) {
+        LOG_INFO(WEATHER, "Cached weather in %s is %ld h old, ignoring it",
+                 path, (long)((clock.epoch - (time_t)header.fetchedAt) / 3600));
+        return false;
+    }
+    
+    WeatherLocation* location = allocateLocation(index);
+    if (location == nullptr) {
+        return false;
+    }
+    WeatherModel& model = location->model;
+    model.current = body.current;
+    memcpy(model.summaries, body.summaries, sizeof(model.summaries));
+    model.hourly = body.hourly;
+    model.descriptions = body.descriptions;
+    model.descriptions.pool[WEATHER_DESCRIPTION_POOL - 1] = '\0';
+    
+    model.hourlyCount = header.hourlyCount;
+    model.resetWindows();
+    location->fetchedAt = (time_t)header.fetchedAt;
+    location->nextRefresh = (time_t)header.nextRefresh;
+    location->lat = location->cachedLat = header.lat;
+    location->lon = location->cachedLon = header.lon;
+    memcpy(location->name, header.name, WEATHER_LOCATION_NAME_LENGTH);
+    location->name[WEATHER_LOCATION_NAME_LENGTH - 1] = '\0';
+    
+    LOG_INFO(WEATHER, "Restored cached weather from %s (%d hours)", path, model.hourlyCount);
+    return true;
 }
 
-void WeatherService::calculateDailyForecasts() {
-    if (hourlyForecastCount == 0) {
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("No hourly forecasts available for calculation");
-        #endif
-        return;
+bool WeatherService::saveCache(int index) {
+    PROFILE_ZONE("weather.save");
+    WeatherLocation& location = *locations[index];
+    WeatherCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = WEATHER_CACHE_MAGIC;
+    header.version = WEATHER_CACHE_VERSION;
+    header.hourlyCount = location.model.hourlyCount;
+    header.fetchedAt = location.fetchedAt;
+    header.nextRefresh = location.nextRefresh;
+    header.lat = location.lat;
+    header.lon = location.lon;
+    memcpy(header.name, location.name, WEATHER_LOCATION_NAME_LENGTH);
+    
+    WeatherCacheBody body;
+    body.current = location.model.current;
+    memcpy(body.summaries, location.model.summaries, sizeof(body.summaries));
+    body.hourly = location.model.hourly;
+    body.descriptions = location.model.descriptions;
+    
+    // Written beside the old snapshot and swapped in, so a power loss
+    // leaves either the previous or the new one
+    char path[24];
+    cachePath(index, path, sizeof(path));
+    File file = SD.open(WEATHER_CACHE_TMP, FILE_WRITE);
+    if (!file) {
+        LOG_WARN(WEATHER, "Cannot write %s", WEATHER_CACHE_TMP);
+        return false;
     }
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t*)&body, sizeof(body)) == sizeof(body);
+    file.close();
     
-    // Get current time
-    time_t now;
-    time(&now);
-    
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
-    int currentHour = timeinfo.tm_hour;
-    int currentDay = timeinfo.tm_mday;
-    int currentMonth = timeinfo.tm_mon + 1; // 0-based to 1-based
-    
-    // Get sunrise and sunset times from current weather data
-    time_t sunriseTime = currentWeather.sunrise;
-    time_t sunsetTime = currentWeather.sunset;
-    
-    struct tm sunriseInfo, sunsetInfo;
-    localtime_r(&sunriseTime, &sunriseInfo);
-    localtime_r(&sunsetTime, &sunsetInfo);
-    
-    int sunriseHour = sunriseInfo.tm_hour;
-    int sunsetHour = sunsetInfo.tm_hour;
-    
-    #if WEATHER_DEBUG
-    DEBUG_PRINTF("Current time: %02d:%02d, day: %02d.%02d\n", 
-                 currentHour, timeinfo.tm_min, currentDay, currentMonth + 1);
-    DEBUG_PRINTF("Sunrise: %02d:%02d, Sunset: %02d:%02d\n", 
-                 sunriseHour, sunriseInfo.tm_min, 
-                 sunsetHour, sunsetInfo.tm_min);
-    #endif
-    
-    int middayHour = 12;
-    
-    // Initialize variables for calculating averages
-    float morningTempSum = 0;
-    float morningPopSum = 0;
-    float afternoonTempSum = 0;
-    float afternoonPopSum = 0;
-    float nightTempSum = 0;
-    float nightPopSum = 0;
-    
-    int morningCount = 0;
-    int afternoonCount = 0;
-    int nightCount = 0;
-    
-    // Store weather icons to find the most frequent one
-    std::vector<String> morningIcons;
-    std::vector<String> afternoonIcons;
-    std::vector<String> nightIcons;
-    
-    // Define time ranges for each period based on current time
-    time_t morningStartTime, morningEndTime;
-    time_t afternoonStartTime, afternoonEndTime;
-    time_t nightStartTime, nightEndTime;
-    
-    // Set start and end days/times for each period based on current time
-    const int NOON_HOUR = 12;
-    
-    if (currentHour >= sunriseHour && currentHour < NOON_HOUR) {
-        // Current time is in the morning (after sunrise, before noon)
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("Current time is in the morning period");
-        #endif
-        
-        // Morning: now until noon today
-        morningStartTime = now;
-        
-        // Calculate noon today
-        struct tm noonTime = timeinfo;
-        noonTime.tm_hour = NOON_HOUR;
-        noonTime.tm_min = 0;
-        noonTime.tm_sec = 0;
-        morningEndTime = mktime(&noonTime);
-        
-        // Afternoon: noon today until sunset today
-        afternoonStartTime = morningEndTime;
-        afternoonEndTime = sunsetTime;
-        
-        // Night: sunset today until sunrise tomorrow
-        nightStartTime = sunsetTime;
-        
-        // Calculate sunrise tomorrow
-        struct tm tomorrowSunrise = sunriseInfo;
-        tomorrowSunrise.tm_mday++; // Next day
-        nightEndTime = mktime(&tomorrowSunrise);
-        
-    } else if (currentHour >= NOON_HOUR && currentHour < sunsetHour) {
-        // Current time is in the afternoon (after noon, before sunset)
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("Current time is in the afternoon period");
-        #endif
-        
-        // Calculate sunrise tomorrow
-        struct tm tomorrowSunrise = sunriseInfo;
-        tomorrowSunrise.tm_mday++; // Next day
-        time_t nextSunrise = mktime(&tomorrowSunrise);
-        
-        // Calculate noon tomorrow
-        struct tm tomorrowNoon = timeinfo;
-        tomorrowNoon.tm_mday++; // Next day
-        tomorrowNoon.tm_hour = NOON_HOUR;
-        tomorrowNoon.tm_min = 0;
-        tomorrowNoon.tm_sec = 0;
-        time_t nextNoon = mktime(&tomorrowNoon);
-        
-        // Morning: sunrise tomorrow until noon tomorrow
-        morningStartTime = nextSunrise;
-        morningEndTime = nextNoon;
-        
-        // Afternoon: now until sunset today
-        afternoonStartTime = now;
-        afternoonEndTime = sunsetTime;
-        
-        // Night: sunset today until sunrise tomorrow
-        nightStartTime = sunsetTime;
-        nightEndTime = nextSunrise;
-        
-    } else if (currentHour >= sunsetHour) {
-        // Current time is at night after sunset but before midnight
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("Current time is at night (after sunset, before midnight)");
-        #endif
-        
-        // Calculate sunrise tomorrow
-        struct tm tomorrowSunrise = sunriseInfo;
-        tomorrowSunrise.tm_mday++; // Next day
-        time_t nextSunrise = mktime(&tomorrowSunrise);
-        
-        // Calculate noon tomorrow
-        struct tm tomorrowNoon = timeinfo;
-        tomorrowNoon.tm_mday++; // Next day
-        tomorrowNoon.tm_hour = NOON_HOUR;
-        tomorrowNoon.tm_min = 0;
-        tomorrowNoon.tm_sec = 0;
-        time_t nextNoon = mktime(&tomorrowNoon);
-        
-        // Calculate sunset tomorrow
-        struct tm tomorrowSunset = sunsetInfo;
-        tomorrowSunset.tm_mday++; // Next day
-        time_t nextSunset = mktime(&tomorrowSunset);
-        
-        // Morning: sunrise tomorrow until noon tomorrow
-        morningStartTime = nextSunrise;
-        morningEndTime = nextNoon;
-        
-        // Afternoon: noon tomorrow until sunset tomorrow
-        afternoonStartTime = nextNoon;
-        afternoonEndTime = nextSunset;
-        
-        // Night: now until sunrise tomorrow
-        nightStartTime = now;
-        nightEndTime = nextSunrise;
-        
-    } else {
-        // Current time is after midnight and before sunrise
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("Current time is at night (after midnight, before sunrise)");
-        #endif
-        
-        // Calculate noon today
-        struct tm todayNoon = timeinfo;
-        todayNoon.tm_hour = NOON_HOUR;
-        todayNoon.tm_min = 0;
-        todayNoon.tm_sec = 0;
-        time_t noonToday = mktime(&todayNoon);
-        
-        // Morning: sunrise today until noon today
-        morningStartTime = sunriseTime;
-        morningEndTime = noonToday;
-        
-        // Afternoon: noon today until sunset today
-        afternoonStartTime = noonToday;
-        afternoonEndTime = sunsetTime;
-        
-        // Night: now until sunrise today
-        nightStartTime = now;
-        nightEndTime = sunriseTime;
+    if (!ok || (SD.exists(path) && !SD.remove(path)) || !SD.rename(WEATHER_CACHE_TMP, path)) {
+        LOG_WARN(WEATHER, "Saving %s failed", path);
+        SD.remove(WEATHER_CACHE_TMP);
+        return false;
     }
-    
-    #if WEATHER_DEBUG
-    struct tm morningStart, morningEnd, afternoonStart, afternoonEnd, nightStart, nightEnd;
-    localtime_r(&morningStartTime, &morningStart);
-    localtime_r(&morningEndTime, &morningEnd);
-    localtime_r(&afternoonStartTime, &afternoonStart);
-    localtime_r(&afternoonEndTime, &afternoonEnd);
-    localtime_r(&nightStartTime, &nightStart);
-    localtime_r(&nightEndTime, &nightEnd);
-    
-    DEBUG_PRINTF("Morning period: %02d.%02d %02d:%02d to %02d.%02d %02d:%02d\n",
-                 morningStart.tm_mday, morningStart.tm_mon + 1, morningStart.tm_hour, morningStart.tm_min,
-                 morningEnd.tm_mday, morningEnd.tm_mon + 1, morningEnd.tm_hour, morningEnd.tm_min);
-    
-    DEBUG_PRINTF("Afternoon period: %02d.%02d %02d:%02d to %02d.%02d %02d:%02d\n",
-                 afternoonStart.tm_mday, afternoonStart.tm_mon + 1, afternoonStart.tm_hour, afternoonStart.tm_min,
-                 afternoonEnd.tm_mday, afternoonEnd.tm_mon + 1, afternoonEnd.tm_hour, afternoonEnd.tm_min);
-    
-    DEBUG_PRINTF("Night period: %02d.%02d %02d:%02d to %02d.%02d %02d:%02d\n",
-                 nightStart.tm_mday, nightStart.tm_mon + 1, nightStart.tm_hour, nightStart.tm_min,
-                 nightEnd.tm_mday, nightEnd.tm_mon + 1, nightEnd.tm_hour, nightEnd.tm_min);
-    #endif
-    
-    // Process hourly forecasts and categorize them
-    for (int i = 0; i < hourlyForecastCount; i++) {
-        // Get the date/time for this forecast
-        time_t forecastTime = hourlyForecasts[i].dt;
-        
-        // Only process the next 48 hours
-        if (forecastTime > now + 48*3600) {
-            break;
-        }
-        
-        // Check which period this forecast belongs to
-        if (forecastTime >= morningStartTime && forecastTime < morningEndTime) {
-            // Morning forecast
-            morningTempSum += hourlyForecasts[i].temp;
-            morningPopSum += hourlyForecasts[i].pop;
-            
-            // For morning forecast, ensure we use day icons
-            String iconCode = hourlyForecasts[i].weather_icon;
-            if (iconCode.length() >= 3 && iconCode.charAt(iconCode.length() - 1) == 'n') {
-                iconCode = iconCode.substring(0, iconCode.length() - 1) + "d";
-#if WEATHER_DEBUG
-                DEBUG_PRINTF("Converting morning icon %s to day icon %s\n", 
-                             hourlyForecasts[i].weather_icon.c_str(), iconCode.c_str());
-#endif
-            }
-            morningIcons.push_back(iconCode);
-            morningCount++;
-            
-#if WEATHER_DEBUG
-            struct tm* debugTimeinfo = localtime(&forecastTime);
-            DEBUG_PRINTF("Added to morning forecast: %02d.%02d %02d:%02d, icon: %s\n",
-                         debugTimeinfo->tm_mday, debugTimeinfo->tm_mon + 1,
-                         debugTimeinfo->tm_hour, debugTimeinfo->tm_min,
-                         iconCode.c_str());
-#endif
-        }
-        
-        if (forecastTime >= afternoonStartTime && forecastTime < afternoonEndTime) {
-            // Afternoon forecast
-            afternoonTempSum += hourlyForecasts[i].temp;
-            afternoonPopSum += hourlyForecasts[i].pop;
-            
-            // For afternoon forecast, always ensure we use day icons
-            String iconCode = hourlyForecasts[i].weather_icon;
-            if (iconCode.length() >= 3 && iconCode.charAt(iconCode.length() - 1) == 'n') {
-                iconCode = iconCode.substring(0, iconCode.length() - 1) + "d";
-#if WEATHER_DEBUG
-                DEBUG_PRINTF("Converting afternoon icon %s to day icon %s\n", 
-                             hourlyForecasts[i].weather_icon.c_str(), iconCode.c_str());
-#endif
-            }
-            afternoonIcons.push_back(iconCode);
-            afternoonCount++;
-            
-#if WEATHER_DEBUG
-            struct tm* debugTimeinfo = localtime(&forecastTime);
-            DEBUG_PRINTF("Added to afternoon forecast: %02d.%02d %02d:%02d, icon: %s\n",
-                         debugTimeinfo->tm_mday, debugTimeinfo->tm_mon + 1,
-                         debugTimeinfo->tm_hour, debugTimeinfo->tm_min,
-                         iconCode.c_str());
-#endif
-        }
-        
-        if (forecastTime >= nightStartTime && forecastTime < nightEndTime) {
-            // Night forecast
-            nightTempSum += hourlyForecasts[i].temp;
-            nightPopSum += hourlyForecasts[i].pop;
-            
-            // For night forecast, ensure we use night icons
-            String iconCode = hourlyForecasts[i].weather_icon;
-            if (iconCode.length() >= 3 && iconCode.charAt(iconCode.length() - 1) == 'd') {
-                iconCode = iconCode.substring(0, iconCode.length() - 1) + "n";
-#if WEATHER_DEBUG
-                DEBUG_PRINTF("Converting night icon %s to night icon %s\n", 
-                             hourlyForecasts[i].weather_icon.c_str(), iconCode.c_str());
-#endif
-            }
-            nightIcons.push_back(iconCode);
-            nightCount++;
-            
-#if WEATHER_DEBUG
-            struct tm* debugTimeinfo = localtime(&forecastTime);
-            DEBUG_PRINTF("Added to night forecast: %02d.%02d %02d:%02d, icon: %s\n",
-                         debugTimeinfo->tm_mday, debugTimeinfo->tm_mon + 1,
-                         debugTimeinfo->tm_hour, debugTimeinfo->tm_min,
-                         iconCode.c_str());
-#endif
-        }
+    location.cachedLat = location.lat;
+    location.cachedLon = location.lon;
+    return true;
+}
+
+static void showWeatherIcon(lv_obj_t* icon, const void* image) {
+    if (icon != nullptr && image != nullptr) {
+        lv_img_set_src(icon, image);
+        lv_obj_remove_flag(icon, LV_OBJ_FLAG_HIDDEN);
     }
-    // Calculate morning forecast summary
-    if (morningCount > 0) {
-        morningForecast.avgTemp = morningTempSum / morningCount;
-        morningForecast.avgPop = morningPopSum / morningCount;
-        morningForecast.iconCode = getMostFrequentIcon(morningIcons);
-        
-        // We've already enforced day icons during collection, but double check here
-        if (morningForecast.iconCode.length() >= 3 && 
-            morningForecast.iconCode.charAt(morningForecast.iconCode.length() - 1) == 'n') {
-            morningForecast.iconCode = 
-                morningForecast.iconCode.substring(0, morningForecast.iconCode.length() - 1) + "d";
-            
-            #if WEATHER_DEBUG
-            DEBUG_PRINTF("Final correction: Morning icon set to %s\n", morningForecast.iconCode.c_str());
-            #endif
-        }
-    } else {
-        morningForecast.avgTemp = 0;
-        morningForecast.avgPop = 0;
-        morningForecast.iconCode = "03d"; // Default cloudy icon
-        
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("No morning forecasts found, using default icon 03d");
-        #endif
+}
+
+static void setWeatherText(lv_obj_t* label, const char* text) {
+    if (label != nullptr) {
+        lv_label_set_text(label, text);
     }
-    
-    // Calculate afternoon forecast summary
-    if (afternoonCount > 0) {
-        afternoonForecast.avgTemp = afternoonTempSum / afternoonCount;
-        afternoonForecast.avgPop = afternoonPopSum / afternoonCount;
-        afternoonForecast.iconCode = getMostFrequentIcon(afternoonIcons);
-        
-        // We've already enforced day icons during collection, but double check here
-        if (afternoonForecast.iconCode.length() >= 3 && 
-            afternoonForecast.iconCode.charAt(afternoonForecast.iconCode.length() - 1) == 'n') {
-            afternoonForecast.iconCode = 
-                afternoonForecast.iconCode.substring(0, afternoonForecast.iconCode.length() - 1) + "d";
-            
-            #if WEATHER_DEBUG
-            DEBUG_PRINTF("Final correction: Afternoon icon set to %s\n", afternoonForecast.iconCode.c_str());
-            #endif
+}
+
+// Placeholders for a location whose data was dropped and not fetched again yet
+static void showNoWeather() {
+    lv_obj_t* const icons[] = {objects.morning_icon, objects.afternoon_icon, objects.night_icon, objects.current_weather_icon};
+    for (lv_obj_t* icon : icons) {
+        if (icon != nullptr) {
+            lv_obj_add_flag(icon, LV_OBJ_FLAG_HIDDEN);
         }
-    } else {
-        afternoonForecast.avgTemp = 0;
-        afternoonForecast.avgPop = 0;
-        afternoonForecast.iconCode = "03d"; // Default cloudy icon
-        
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("No afternoon forecasts found, using default icon 03d");
-        #endif
     }
-    
-    // Calculate night forecast summary
-    if (nightCount > 0) {
-        nightForecast.avgTemp = nightTempSum / nightCount;
-        nightForecast.avgPop = nightPopSum / nightCount;
-        nightForecast.iconCode = getMostFrequentIcon(nightIcons);
-        
-        // We've already enforced night icons during collection, but double check here
-        if (nightForecast.iconCode.length() >= 3 && 
-            nightForecast.iconCode.charAt(nightForecast.iconCode.length() - 1) == 'd') {
-            nightForecast.iconCode = 
-                nightForecast.iconCode.substring(0, nightForecast.iconCode.length() - 1) + "n";
-            
-            #if WEATHER_DEBUG
-            DEBUG_PRINTF("Final correction: Night icon set to %s\n", nightForecast.iconCode.c_str());
-            #endif
-        }
-    } else {
-        nightForecast.avgTemp = 0;
-        nightForecast.avgPop = 0;
-        nightForecast.iconCode = "03n"; // Default cloudy night icon
-        
-        #if WEATHER_DEBUG
-        DEBUG_PRINTLN("No night forecasts found, using default icon 03n");
-        #endif
+    lv_obj_t* const values[] = {objects.morning_temp_label, objects.morning_rain_label,
+                                objects.afternoon_temp_label, objects.afternoon_rain_label,
+                                objects.night_temp_label, objects.night_rain_label};
+    for (lv_obj_t* label : values) {
+        setWeatherText(label, "--");
     }
-    
-    #if WEATHER_DEBUG
-    DEBUG_PRINTLN("Final forecast summary:");
-    DEBUG_PRINTF("  Morning: %.1f°C, %d%% pop, icon: %s (%d datapoints)\n", 
-                 morningForecast.avgTemp, (int)(morningForecast.avgPop * 100), 
-                 morningForecast.iconCode.c_str(), morningCount);
-    DEBUG_PRINTF("  Afternoon: %.1f°C, %d%% pop, icon: %s (%d datapoints)\n", 
-                 afternoonForecast.avgTemp, (int)(afternoonForecast.avgPop * 100), 
-                 afternoonForecast.iconCode.c_str(), afternoonCount);
-    DEBUG_PRINTF("  Night: %.1f°C, %d%% pop, icon: %s (%d datapoints)\n", 
-                 nightForecast.avgTemp, (int)(nightForecast.avgPop * 100), 
-                 nightForecast.iconCode.c_str(), nightCount);
-    #endif
+    setWeatherText(objects.feels_like_label, "");
+    setWeatherText(objects.weather_desc_label, "");
+
+    eez::Value weatherValue = eez::flow::getGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_WEATHER);
+    WeatherValue weatherStruct(weatherValue);
+    weatherStruct.Temperature("--");
+    eez::flow::setGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_WEATHER, weatherStruct);
 }
 
-String WeatherService::getMostFrequentIcon(const std::vector<String>& icons) {
-    if (icons.empty()) {
-#if WEATHER_DEBUG
-        DEBUG_PRINTLN("Warning: Empty icons vector in getMostFrequentIcon, using default icon");
-#endif
-        return "01d"; // Default clear sky day icon
-    }
-    
-#if WEATHER_DEBUG
-    DEBUG_PRINTF("Getting most frequent icon from %d icons:\n", icons.size());
-    for (size_t i = 0; i < icons.size(); i++) {
-        DEBUG_PRINTF("  Icon %d: %s\n", i, icons[i].c_str());
-    }
-#endif
-    
-    // Count occurrences of each icon
-    std::map<String, int> iconCount;
-    for (const String& icon : icons) {
-        // Ensure we're only using the base icon code (without file extension if present)
-        String cleanIcon = icon;
-        // Remove any file extension that might be in the icon string
-        int dotPos = cleanIcon.indexOf('.');
-        if (dotPos > 0) {
-            cleanIcon = cleanIcon.substring(0, dotPos);
-        }
-        
-        if (iconCount.find(cleanIcon) != iconCount.end()) {
-            iconCount[cleanIcon]++;
-        } else {
-            iconCount[cleanIcon] = 1;
-        }
+void WeatherService::updateWeatherUI() {
+    const WeatherLocation* location = displayed < locationCount ? locations[displayed] : nullptr;
+    if (location == nullptr) {
+        return;
     }
+    const WeatherModel& model = location->model;
     
-    // Find most frequent icon
-    String mostFrequentIcon = icons[0];
-    int maxCount = 0;
-    
-#if WEATHER_DEBUG
-    DEBUG_PRINTLN("Icon counts:");
-#endif
-    
-    for (const auto& pair : iconCount) {
-#if WEATHER_DEBUG
-        DEBUG_PRINTF("  %s: %d occurrences\n", pair.first.c_str(), pair.second);
-#endif
-        if (pair.second > maxCount) {
-            maxCount = pair.second;
-            mostFrequentIcon = pair.first;
+    // The location name is the card title, so a rotating card says where it is.
+    // Always set: the previous location's name must not stay on the card.
+    if (objects.current_weather_title_label != nullptr) {
+        if (location->name[0] != '\0') {
+            lv_label_set_text(objects.current_weather_title_label, location->name);
+        } else if (displayed == 0) {
+            lv_label_set_text(objects.current_weather_title_label, WEATHER_DEFAULT_TITLE);
+        } else {
+            lv_label_set_text_fmt(objects.current_weather_title_label, WEATHER_LOCATION_TITLE, displayed + 1);
         }
     }
     
-#if WEATHER_DEBUG
-    DEBUG_PRINTF("Most frequent icon selected: %s\n", mostFrequentIcon.c_str());
-#endif
+    if (!hasData(location)) {
+        showNoWeather();
+        return;
+    }
     
-    return mostFrequentIcon;
-}
-
-void WeatherService::updateWeatherUI() {
     // Update morning forecast UI elements
-    if (objects.morning_icon != nullptr) {
-        const void* morning_img_src = getIconForCode(morningForecast.iconCode);
-        if (morning_img_src != nullptr) {
-            lv_img_set_src(objects.morning_icon, morning_img_src);
-        }
-    }
+    showWeatherIcon(objects.morning_icon, getIconImage(model.summaries[PERIOD_MORNING].icon));
 
     if (objects.morning_temp_label != nullptr) {
         char temp_str[16];
-        snprintf(temp_str, sizeof(temp_str), "%.1f°C", morningForecast.avgTemp);
+        snprintf(temp_str, sizeof(temp_str), "%.1f°C", model.summaries[PERIOD_MORNING].avgTempCenti / 100.0f);
         lv_label_set_text(objects.morning_temp_label, temp_str);
     }
 
     if (objects.morning_rain_label != nullptr) {
         char rain_str[16];
-        snprintf(rain_str, sizeof(rain_str), "%.0f%%", morningForecast.avgPop * 100);
+        snprintf(rain_str, sizeof(rain_str), "%u%%", model.summaries[PERIOD_MORNING].avgPop);
         lv_label_set_text(objects.morning_rain_label, rain_str);
     }
 
     // Update afternoon forecast UI elements
-    if (objects.afternoon_icon != nullptr) {
-        const void* afternoon_img_src = getIconForCode(afternoonForecast.iconCode);
-        if (afternoon_img_src != nullptr) {
-            lv_img_set_src(objects.afternoon_icon, afternoon_img_src);
-        }
-    }
+    showWeatherIcon(objects.afternoon_icon, getIconImage(model.summaries[PERIOD_AFTERNOON].icon));
 
     if (objects.afternoon_temp_label != nullptr) {
         char temp_str[16];
-        snprintf(temp_str, sizeof(temp_str), "%.1f°C", afternoonForecast.avgTemp);
+        snprintf(temp_str, sizeof(temp_str), "%.1f°C", model.summaries[PERIOD_AFTERNOON].avgTempCenti / 100.0f);
         lv_label_set_text(objects.afternoon_temp_label, temp_str);
     }
 
     if (objects.afternoon_rain_label != nullptr) {
         char rain_str[16];
-        snprintf(rain_str, sizeof(rain_str), "%.0f%%", afternoonForecast.avgPop * 100);
+        snprintf(rain_str, sizeof(rain_str), "%u%%", model.summaries[PERIOD_AFTERNOON].avgPop);
         lv_label_set_text(objects.afternoon_rain_label, rain_str);
     }
 
     // Update night forecast UI elements
-    if (objects.night_icon != nullptr) {
-        const void* night_img_src = getIconForCode(nightForecast.iconCode);
-        if (night_img_src != nullptr) {
-            lv_img_set_src(objects.night_icon, night_img_src);
-        }
-    }
+    showWeatherIcon(objects.night_icon, getIconImage(model.summaries[PERIOD_NIGHT].icon));
 
     if (objects.night_temp_label != nullptr) {
         char temp_str[16];
-        snprintf(temp_str, sizeof(temp_str), "%.1f°C", nightForecast.avgTemp);
+        snprintf(temp_str, sizeof(temp_str), "%.1f°C", model.summaries[PERIOD_NIGHT].avgTempCenti / 100.0f);
         lv_label_set_text(objects.night_temp_label, temp_str);
     }
 
     if (objects.night_rain_label != nullptr) {
         char rain_str[16];
-        snprintf(rain_str, sizeof(rain_str), "%.0f%%", nightForecast.avgPop * 100);
+        snprintf(rain_str, sizeof(rain_str), "%u%%", model.summaries[PERIOD_NIGHT].avgPop);
         lv_label_set_text(objects.night_rain_label, rain_str);
     }
 
     // Update current weather UI elements
-    if (objects.current_weather_icon != nullptr) {
-        const void* current_img_src = getIconForCode(currentWeather.weather_icon);
-        if (current_img_src != nullptr) {
-            lv_img_set_src(objects.current_weather_icon, current_img_src);
-        }
-    }
+    showWeatherIcon(objects.current_weather_icon, getIconImage(model.current.icon));
 
     // Update the temperature in the CurrentWeather global struct
     // This allows data binding to work properly - format temperature as string with 1 decimal place
     eez::Value weatherValue = eez::flow::getGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_WEATHER);
     WeatherValue weatherStruct(weatherValue);
     char temp_str[16];
-    snprintf(temp_str, sizeof(temp_str), "%.1f", currentWeather.temp); // Format with 1 decimal place
+    snprintf(temp_str, sizeof(temp_str), "%.1f", model.current.tempCenti / 100.0f); // Format with 1 decimal place
     weatherStruct.Temperature(temp_str); // Store as string with 1 decimal
     eez::flow::setGlobalVariable(FLOW_GLOBAL_VARIABLE_CURRENT_WEATHER, weatherStruct);
 
     if (objects.feels_like_label != nullptr) {
         char feels_like_str[32];
-        snprintf(feels_like_str, sizeof(feels_like_str), "Feels like: %.1f°C", currentWeather.feels_like);
+        snprintf(feels_like_str, sizeof(feels_like_str), "Feels like: %.1f°C", model.current.feelsLikeCenti / 100.0f);
         lv_label_set_text(objects.feels_like_label, feels_like_str);
     }
 
     if (objects.weather_desc_label != nullptr) {
-        lv_label_set_text(objects.weather_desc_label, currentWeather.weather_description.c_str());
+        lv_label_set_text(objects.weather_desc_label, model.getDescription(model.current.description));
     }
 
     // Note: ui_Image1 is likely removed or renamed in the new UI structure
@@ -808,28 +700,11 @@ void WeatherService::updateWeatherUI() {
     #endif
 }
 
-// Implementation of getIconForCode function to map OpenWeatherMap icon codes to UI icon resources
-const void* WeatherService::getIconForCode(const String& iconCode) {
-    // Map OpenWeatherMap icon codes to our UI icon resources using EEZ Studio image references
-    if (iconCode == "01d") return &img_01d;
-    if (iconCode == "01n") return &img_01n;
-    if (iconCode == "02d") return &img_02d;
-    if (iconCode == "02n") return &img_02n;
-    if (iconCode == "03d") return &img_03d;
-    if (iconCode == "03n") return &img_03n;
-    if (iconCode == "04d") return &img_04d;
-    if (iconCode == "04n") return &img_04n;
-    if (iconCode == "09d") return &img_09d;
-    if (iconCode == "09n") return &img_09n;
-    if (iconCode == "10d") return &img_10d;
-    if (iconCode == "10n") return &img_10n;
-    if (iconCode == "11d") return &img_11d;
-    if (iconCode == "11n") return &img_11n;
-    if (iconCode == "13d") return &img_13d;
-    if (iconCode == "13n") return &img_13n;
-    if (iconCode == "50d") return &img_50d;
-    if (iconCode == "50n") return &img_50n;
-    
-    // Default case - clear sky day if no match is found
-    return &img_01d;
+// Map weather icons to our UI icon resources using EEZ Studio image references
+const void* WeatherService::getIconImage(WeatherIcon icon) {
+    if ((uint8_t)icon >= (uint8_t)WeatherIcon::COUNT) {
+        // Default case - clear sky day if no match is found
+        return &img_01d;
+    }
+    return ICON_IMAGES[(uint8_t)icon];
 }
@@ -19,11 +19,30 @@
 #include "EventHandler.h"
 #include "AudioManager.h"
 #include "RadioData.h"
+#include "SerialConsole.h"
+#include "SensorHistory.h"
+#include "HistoryChart.h"
+#include "HttpsConnection.h"
+#include "WeatherReplay.h"
+#include "SystemMonitor.h"
+#include "Profiler.h"
+#include "AllocTracker.h"
+#include "DeferredLog.h"
+#include "LvglHeap.h"
+#include "Benchmark.h"
+#include "PowerManager.h"
+#include "DisplayPower.h"
+#include "StandbyManager.h"
+#include "ClockService.h"
+#include "TouchInput.h"
+#include "I2CBus.h"
 
 // Forward declarations
 void my_log_cb(lv_log_level_t level, const char *buf);
 void my_disp_flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
-void my_touchpad_read(lv_indev_t *drv, lv_indev_data_t *data);
+bool read_touch_controller(uint16_t *x, uint16_t *y);
+void render_start_cb(lv_event_t *e);
+void set_backlight(bool on);
 void listDirectory(fs::FS &fs, const char *dirname, uint8_t levels);
 void connectToWiFi();
 void initializeWeatherService();
@@ -31,7 +50,7 @@ void syncTimeFromNTP();
 void updateWiFiStatusUI();
 void startPeriodicTasks();
 void wifiStatusTimerCallback(lv_timer_t *timer);
-void timeUpdateTimerCallback(lv_timer_t *timer);
+void clockUpdateCallback(const ClockSnapshot& snapshot, uint8_t events, void* context);
 void envSensorTimerCallback(lv_timer_t *timer);
 void weatherUpdateTimerCallback(lv_timer_t *timer);
 
@@ -41,7 +60,6 @@ lv_indev_t * touch_indev = NULL;
 
 // LVGL timers
 lv_timer_t * wifi_status_timer = NULL;
-lv_timer_t * time_update_timer = NULL;
 lv_timer_t * env_sensor_timer = NULL;
 lv_timer_t * weather_update_timer = NULL;
 
@@ -81,19 +99,35 @@ static LGFX gfx;
 /* LVGL 9.2.2+ logging callback */
 void my_log_cb(lv_log_level_t level, const char *buf)
 {
-    (void)level;  // Unused parameter
-    DEBUG_PRINT("[LVGL] ");
-    DEBUG_PRINT(buf);
-    if (buf[strlen(buf)-1] != '\n') {
-        DEBUG_PRINTLN();
+    // Deferred so LVGL is never stalled on the serial ports
+    uint8_t logLevel = level >= LV_LOG_LEVEL_ERROR ? LOG_LEVEL_ERROR :
+                       level == LV_LOG_LEVEL_WARN ? LOG_LEVEL_WARN : LOG_LEVEL_INFO;
+
+    // A record keeps LOG_STRING_MAX characters; LVGL's lines (function,
+    // message, file:line) can be longer, so they go out in parts with the
+    // continuations indented
+    size_t length = strlen(buf);
+    while (length > 0 && buf[length - 1] == '\n') {
+        length--;
+    }
+    char part[LOG_STRING_MAX + 1];
+    for (size_t offset = 0; offset < length; offset += LOG_STRING_MAX) {
+        size_t partLength = min(length - offset, (size_t)LOG_STRING_MAX);
+        memcpy(part, buf + offset, partLength);
+        part[partLength] = '\0';
+        if (offset == 0) {
+            LOG_AT(LVGL, logLevel, "%s", part);
+        } else {
+            LOG_AT(LVGL, logLevel, "  %s", part);
+        }
     }
-    Serial.flush();
 }
 #endif
 
 /* Display flushing using low-level LovyanGFX commands for robustness */
 void my_disp_flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
 {
+    PROFILE_ZONE("disp.flush");
     uint32_t w = area->x2 - area->x1 + 1;
     uint32_t h = area->y2 - area->y1 + 1;
 
@@ -105,19 +139,25 @@ void my_disp_flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
     lv_display_flush_ready(disp);
 }
 
-/* Read the touchpad using LovyanGFX integrated touch */
-void my_touchpad_read(lv_indev_t *drv, lv_indev_data_t *data)
+/* Read the GT911 through LovyanGFX; called from the touch task only (see TouchInput) */
+bool read_touch_controller(uint16_t *x, uint16_t *y)
 {
-    uint16_t touchX, touchY;
-    bool touched = gfx.getTouch(&touchX, &touchY);
-    
-    if (touched) {
-        data->state = LV_INDEV_STATE_PRESSED;
-        data->point.x = touchX;
-        data->point.y = touchY;
-    } else {
-        data->state = LV_INDEV_STATE_RELEASED;
-    }
+    return gfx.getTouch(x, y);
+}
+
+/* Keep full clock while LVGL renders (see PowerPolicy) */
+void render_start_cb(lv_event_t *e)
+{
+    (void)e;
+    PowerManager::getInstance()->pulse(PowerSubsystem::RENDER);
+}
+
+/* Panel backlight for night blanking (see DisplayPower) */
+void set_backlight(bool on)
+{
+    // The level set at init, captured when the panel is first blanked
+    static uint8_t level = gfx.getBrightness();
+    gfx.setBrightness(on ? level : 0);
 }
 
 // Custom tick callback function for LVGL 9.x compatibility
@@ -141,6 +181,16 @@ void setup()
     
     // Give Serial0 (UART bridge) time to initialize
     delay(100); // Brief delay to ensure Serial0 is ready
+
+    // Start the log drain task early so LOG_* output from setup() is printed
+    DeferredLog::begin();
+
+    // From here on all Wire1 traffic goes through the I2C bus task
+    I2CBus::getInstance()->begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_FREQUENCY);
+
+    // After a deep-sleep alarm wake, get Wi-Fi and the stream going before
+    // the display and UI are brought up
+    StandbyManager::getInstance()->resumeFromStandby();
     
     #if SYSTEM_DEBUG
     delay(5000);
@@ -189,6 +239,8 @@ void setup()
     // Create a display driver
     display = lv_display_create(screenWidth, screenHeight);
     lv_display_set_flush_cb(display, my_disp_flush);
+    // Raise the CPU clock as soon as LVGL starts rendering a frame
+    lv_display_add_event_cb(display, render_start_cb, LV_EVENT_RENDER_START, NULL);
 
     // Use PARTIAL_MODE with two buffers in PSRAM.
     // This is a robust and flicker-free approach when driver-level double buffering is not available or configured.
@@ -214,7 +266,7 @@ void setup()
         DEBUG_PRINTLN("ERROR: Failed to create LVGL input device!");
     } else {
         lv_indev_set_type(touch_indev, LV_INDEV_TYPE_POINTER);
-        lv_indev_set_read_cb(touch_indev, my_touchpad_read);
+        lv_indev_set_read_cb(touch_indev, TouchInput::readCallback);
         
         // Set the display for the input device
         if (display) {
@@ -225,6 +277,9 @@ void setup()
         
         // Enable the input device
         lv_indev_enable(touch_indev, true);
+
+        // Touch samples are read by the touch task and queued for the indev
+        TouchInput::begin(read_touch_controller);
     }
 
     // Initialize SD Card
@@ -321,14 +376,44 @@ void setup()
         DEBUG_PRINTLN("Failed to initialize one or more environmental sensors");
 #endif
     }
+    
+    // Sensor history rings (reloaded from SD) fed by the clock service
+    SensorHistory::getInstance()->begin();
+    
+    // Tapping a sensor value opens its history chart
+    HistoryChart::getInstance()->begin();
+    
+    // Show the last fetched weather (every location) until the network is up
+    WeatherService::getInstance().restoreCache();
     DEBUG_PRINTLN("UI initialized");
     
+    // Shared HTTPS connection for the weather API (idle timeout, 'https' command)
+    HttpsConnectionManager::getInstance()->begin();
+    
     // Now that UI is initialized, connect to WiFi using credentials from config.json
     connectToWiFi();
     
     // Start periodic tasks (WiFi status updates, etc.)
     startPeriodicTasks();
 
+    // Start task/heap monitoring and its serial console commands
+    SystemMonitor::getInstance()->begin();
+    LvglHeap::begin();
+    Benchmark::begin();
+    WeatherReplay::begin();
+
+    // The panel holds its lock until it is blanked at night; everything else
+    // takes its locks on demand
+    DisplayPower::getInstance()->begin(set_backlight);
+    PowerManager::getInstance()->begin();
+    StandbyManager::getInstance()->begin();
+#if PROFILING
+    Profiler::begin();
+#endif
+#if ALLOC_TRACE
+    AllocTracker::begin();
+#endif
+
     DEBUG_PRINTLN("Setup done");
 }
 
@@ -365,7 +450,10 @@ void connectToWiFi() {
     DEBUG_PRINTF("Connecting to WiFi SSID: %s\n", wifiSSID.c_str());
 #endif
     
-    WiFi.begin(wifiSSID.c_str(), wifiPassword.c_str());
+    // Already up if the standby fast path reconnected after an alarm wake
+    if (WiFi.status() != WL_CONNECTED) {
+        WiFi.begin(wifiSSID.c_str(), wifiPassword.c_str());
+    }
     
     int timeout = 0;
     while (WiFi.status() != WL_CONNECTED && timeout < 20) {
@@ -409,8 +497,10 @@ void initializeWeatherService() {
     String apiKey;
     float latitude, longitude;
     String units, language;
+    WeatherLocationConfig locations[WEATHER_MAX_LOCATIONS];
     
-    if (!configManager->getWeatherSettings(apiKey, latitude, longitude, units, language)) {
+    int locationCount = configManager->getWeatherLocations(locations, WEATHER_MAX_LOCATIONS);
+    if (!configManager->getWeatherSettings(apiKey, latitude, longitude, units, language) || locationCount == 0) {
 #if WEATHER_DEBUG
         DEBUG_PRINTLN("No weather configuration found or configuration is incomplete");
 #endif
@@ -420,12 +510,12 @@ void initializeWeatherService() {
 #if WEATHER_DEBUG
     DEBUG_PRINTLN("Weather configuration found, initializing service...");
     DEBUG_PRINTF("API Key: [%s]\n", apiKey.length() > 0 ? apiKey.c_str() : "EMPTY");
-    DEBUG_PRINTF("Location: [%.6f, %.6f]\n", latitude, longitude);
+    DEBUG_PRINTF("Locations: %d, home [%.6f, %.6f]\n", locationCount, latitude, longitude);
     DEBUG_PRINTF("Units: [%s], Language: [%s]\n", units.c_str(), language.c_str());
 #endif
     
     // Initialize weather service
-    if (uiManager->initWeatherService(apiKey, latitude, longitude, units, language)) {
+    if (uiManager->initWeatherService(apiKey, locations, locationCount, units, language)) {
 #if WEATHER_DEBUG
         DEBUG_PRINTLN("WeatherService initialized successfully");
 #endif
@@ -592,19 +682,15 @@ void envSensorTimerCallback(lv_timer_t * timer) {
 
 // Time and date update functions have been moved to UIManager class
 
-// Callback for time update timer
-void timeUpdateTimerCallback(lv_timer_t *timer) {
-    // Update time using UIManager
-    if (uiManager) {
-        uiManager->updateTimeUI();
-        
-        // Check if hour has changed to update date as well
-        struct tm timeinfo;
-        if (getLocalTime(&timeinfo)) {
-            if (timeinfo.tm_hour != uiManager->getLastUpdateHour()) {
-                uiManager->updateDateUI();
-            }
-        }
+// Clock service subscriber for the time and date labels
+void clockUpdateCallback(const ClockSnapshot& snapshot, uint8_t events, void* context) {
+    (void)context;
+    if (!uiManager) {
+        return;
+    }
+    uiManager->updateTimeUI(snapshot.local);
+    if (events & (CLOCK_DAY | CLOCK_DST)) {
+        uiManager->updateDateUI(snapshot.local);
     }
 }
 
@@ -626,20 +712,23 @@ void startPeriodicTasks() {
     // Create a timer that runs every 10 seconds (10000ms) for WiFi status updates
     wifi_status_timer = lv_timer_create(wifiStatusTimerCallback, 10000, NULL);
     
-    // Create a timer that runs every second (1000ms) for time updates
-    time_update_timer = lv_timer_create(timeUpdateTimerCallback, 1000, NULL);
+    // Time and date labels follow the clock service (second and day boundaries)
+    ClockService::getInstance()->subscribe(CLOCK_SECOND | CLOCK_DAY | CLOCK_DST, clockUpdateCallback);
     
-    // Create a timer that runs every 30 seconds (30000ms) for environmental sensor updates
-    env_sensor_timer = lv_timer_create(envSensorTimerCallback, 30000, NULL);
+    // The sensor task samples at 1 Hz; the labels take over its smoothed values less often
+    env_sensor_timer = lv_timer_create(envSensorTimerCallback, SENSOR_UI_INTERVAL_MS, NULL);
     
-    // Create a timer that runs every 5 minutes (300000ms) for weather data updates
-    weather_update_timer = lv_timer_create(weatherUpdateTimerCallback, 300000, NULL);
+    // The weather scheduler decides from the data age whether a check fetches a location
+    weather_update_timer = lv_timer_create(weatherUpdateTimerCallback, WEATHER_CHECK_INTERVAL_MS, NULL);
     
     // Run the first updates immediately using UIManager
     if (uiManager) {
         uiManager->updateWiFiStatusUI();
-        uiManager->updateTimeUI();
-        uiManager->updateDateUI();
+        const ClockSnapshot& clock = ClockService::getInstance()->now();
+        if (clock.valid) {
+            uiManager->updateTimeUI(clock.local);
+            uiManager->updateDateUI(clock.local);
+        }
     }
     
     // Immediately run environment sensor update
@@ -658,11 +747,25 @@ void startPeriodicTasks() {
 void loop()
 {
     static uint32_t last_print = 0;
-    static uint32_t last_touch_check = 0;
     static bool first_run = true;
     static uint32_t last_tick = 0;
     uint32_t now = millis();
     
+    // Record loop timing and sample task/heap statistics
+    SystemMonitor::getInstance()->loopTick();
+    
+    // Handle serial console commands (non-blocking)
+    SerialConsole::getInstance()->loop();
+
+    // Convert the time once per second and notify clock subscribers
+    ClockService::getInstance()->tick();
+
+    // Release power locks whose linger time has passed
+    PowerManager::getInstance()->loop();
+
+    // Wake-to-audio latency after a standby wake
+    StandbyManager::getInstance()->loop();
+    
     // Update LVGL tick counter - required for proper timing
     if(now - last_tick > 0) {
         lv_tick_inc(now - last_tick);
@@ -677,6 +780,16 @@ void loop()
     // Process audio pipeline
     audioManager.loop();
     
+#if ALLOC_TRACE
+    // Advance a running play/stop leak check
+    AllocTracker::loop();
+#endif
+    
+    // Reflect newly published playback info in the UI
+    if (uiManager) {
+        uiManager->updatePlaybackUI();
+    }
+    
     // Force reinitialize touch if needed (only on first run)
     if (first_run) {
         // If touch is not initialized properly after 3 seconds, try to reinitialize
@@ -697,33 +810,10 @@ void loop()
         // System debug info
         // DEBUG_PRINTF("Free heap: %d bytes\n", (int)ESP.getFreeHeap());
 #endif
-        
-#if TOUCH_DEBUG
-        // Only print touch debug info if TOUCH_DEBUG is enabled
-        DEBUG_PRINTLN("Touch device is available through LovyanGFX");
-        // Try to read touch to keep it active
-        uint16_t touchX, touchY;
-        bool touched = gfx.getTouch(&touchX, &touchY);
-        if (touched) {
-            DEBUG_PRINTF("Touch active at X: %d, Y: %d\n", touchX, touchY);
-        }
-#else
-        // If not in debug mode, just silently keep touch active
-        uint16_t touchX, touchY;
-        gfx.getTouch(&touchX, &touchY);
-#endif
+
         last_print = now;
     }
     
-    // Check for touch input
-    if (now - last_touch_check > 100) {  // Every 100ms
-        if (touch_indev) {
-            // Force a read of the touch device
-            lv_indev_get_read_timer(touch_indev);
-        }
-        last_touch_check = now;
-    }
-    
     // Small delay to prevent watchdog reset
     delay(2);
 }
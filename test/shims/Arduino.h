@@ -0,0 +1,120 @@
+#ifndef HOST_ARDUINO_SHIM_H
+#define HOST_ARDUINO_SHIM_H
+
+// Host stand-in for the parts of the Arduino core that the platform-neutral
+// modules (WeatherModel, WeatherPayloadReplay, HttpsBody) use: Stream, String, the
+// timing functions and the debug serial ports. Only the native environment
+// puts test/shims on the include path.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+// Callers poll with delay(1); the host just keeps polling
+inline void delay(unsigned long ms) {
+    (void)ms;
+}
+
+class String {
+public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    String(const std::string& text) : value(text) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.length(); }
+    bool isEmpty() const { return value.empty(); }
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String operator+(const String& other) const { return String(value + other.value); }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator!=(const String& other) const { return value != other.value; }
+
+private:
+    std::string value;
+};
+
+// Byte output as in the Arduino core; the shim streams are read only
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) { return 0; }
+};
+
+// Byte input as in the Arduino core; readBytes blocks until 'length' bytes or the end
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    virtual size_t readBytes(char* buffer, size_t length) {
+        size_t count = 0;
+        int c;
+        while (count < length && (c = read()) >= 0) {
+            buffer[count++] = (char)c;
+        }
+        return count;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+};
+
+// Serial goes to stdout; Serial0 (the UART copy of DEBUG_* output) is dropped
+class HostSerial {
+public:
+    explicit HostSerial(FILE* out) : out(out) {}
+
+    void print(const char* text) { if (out) fputs(text, out); }
+    void print(const String& text) { print(text.c_str()); }
+    void print(long value) { if (out) fprintf(out, "%ld", value); }
+    void print(unsigned long value) { if (out) fprintf(out, "%lu", value); }
+    void print(int value) { print((long)value); }
+    void print(unsigned int value) { print((unsigned long)value); }
+    void print(double value) { if (out) fprintf(out, "%.2f", value); }
+
+    template <typename T>
+    void println(const T& value) { print(value); println(); }
+    void println() { print("\n"); }
+
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (!out) {
+            return 0;
+        }
+        va_list args;
+        va_start(args, format);
+        int written = vfprintf(out, format, args);
+        va_end(args);
+        return written;
+    }
+
+private:
+    FILE* out;
+};
+
+static HostSerial Serial(stdout);
+static HostSerial Serial0(nullptr);
+
+#endif // HOST_ARDUINO_SHIM_H
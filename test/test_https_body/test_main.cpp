@@ -0,0 +1,221 @@
+// Host test of the response body framing: 'pio test -e native -f test_https_body'
+//
+// HttpsBody reads from a FakeStream holding the bytes the server sent,
+// followed by the start of the next response ("NEXT") as on a kept-alive
+// connection. Every body must end exactly at its own framing, and drain()
+// must only report a connection as reusable when the framing ended.
+
+#include <Arduino.h>
+#include <string>
+#include <unity.h>
+#include "HttpsBody.h"
+
+#define NEXT_RESPONSE "NEXT"
+
+// Bytes already received on the connection; 'window' limits what
+// available() reports, like a TLS record that arrived only in part
+class FakeStream : public Stream {
+public:
+    explicit FakeStream(const std::string& data, int window = -1) : data(data), position(0), window(window) {}
+
+    int available() override {
+        int left = (int)(data.size() - position);
+        return window >= 0 ? min(left, window) : left;
+    }
+    int read() override { return position < data.size() ? (uint8_t)data[position++] : -1; }
+    int peek() override { return position < data.size() ? (uint8_t)data[position] : -1; }
+
+    std::string rest() const { return data.substr(position); }
+
+private:
+    std::string data;
+    size_t position;
+    int window;
+};
+
+static std::string readAll(HttpsBody& body) {
+    std::string text;
+    int c;
+    while ((c = body.read()) >= 0) {
+        text += (char)c;
+    }
+    return text;
+}
+
+static const char* CHUNKED_BODY = "5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\nTrailer: x\r\n\r\n";
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_content_length() {
+    FakeStream stream("hello world" NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, 11, false);
+    TEST_ASSERT_EQUAL_STRING("hello world", readAll(body).c_str());
+    TEST_ASSERT_TRUE(body.drain());
+    TEST_ASSERT_EQUAL_STRING(NEXT_RESPONSE, stream.rest().c_str());
+}
+
+void test_content_length_zero() {
+    FakeStream stream(NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, 0, false);
+    TEST_ASSERT_EQUAL(0, body.available());
+    TEST_ASSERT_EQUAL(-1, body.read());
+    TEST_ASSERT_TRUE(body.drain());
+    TEST_ASSERT_EQUAL_STRING(NEXT_RESPONSE, stream.rest().c_str());
+}
+
+void test_chunked() {
+    FakeStream stream(std::string(CHUNKED_BODY) + NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL_STRING("hello world", readAll(body).c_str());
+    TEST_ASSERT_TRUE(body.drain());
+    TEST_ASSERT_EQUAL_STRING(NEXT_RESPONSE, stream.rest().c_str());
+}
+
+void test_chunked_uppercase_size() {
+    FakeStream stream("A\r\n0123456789\r\n0\r\n\r\n" NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL_STRING("0123456789", readAll(body).c_str());
+    TEST_ASSERT_TRUE(body.drain());
+    TEST_ASSERT_EQUAL_STRING(NEXT_RESPONSE, stream.rest().c_str());
+}
+
+void test_chunked_read_bytes_across_chunks() {
+    FakeStream stream(std::string(CHUNKED_BODY) + NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    char buffer[32];
+    size_t got = body.readBytes(buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL(11, got);
+    TEST_ASSERT_EQUAL_STRING_LEN("hello world", buffer, 11);
+    TEST_ASSERT_TRUE(body.drain());
+    TEST_ASSERT_EQUAL_STRING(NEXT_RESPONSE, stream.rest().c_str());
+}
+
+void test_chunked_available_stays_in_chunk() {
+    FakeStream stream(std::string(CHUNKED_BODY) + NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    // Nothing before the first header is read
+    TEST_ASSERT_EQUAL(0, body.available());
+    TEST_ASSERT_EQUAL('h', body.read());
+    TEST_ASSERT_EQUAL(4, body.available());
+}
+
+void test_available_limited_by_stream() {
+    FakeStream stream("hello world" NEXT_RESPONSE, 3);
+    HttpsBody body;
+    body.start(&stream, 11, false);
+    TEST_ASSERT_EQUAL(3, body.available());
+}
+
+void test_content_length_drain_after_partial_read() {
+    FakeStream stream("hello world" NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, 11, false);
+    TEST_ASSERT_EQUAL('h', body.read());
+    TEST_ASSERT_TRUE(body.drain());
+    TEST_ASSERT_EQUAL_STRING(NEXT_RESPONSE, stream.rest().c_str());
+}
+
+void test_chunked_drain_after_partial_read() {
+    FakeStream stream(std::string(CHUNKED_BODY) + NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL('h', body.read());
+    TEST_ASSERT_TRUE(body.drain());
+    TEST_ASSERT_EQUAL_STRING(NEXT_RESPONSE, stream.rest().c_str());
+}
+
+void test_peek_does_not_consume() {
+    FakeStream stream(std::string(CHUNKED_BODY) + NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL('h', body.peek());
+    TEST_ASSERT_EQUAL('h', body.peek());
+    TEST_ASSERT_EQUAL_STRING("hello world", readAll(body).c_str());
+}
+
+void test_content_length_truncated() {
+    FakeStream stream("hello");
+    HttpsBody body;
+    body.start(&stream, 11, false);
+    TEST_ASSERT_EQUAL_STRING("hello", readAll(body).c_str());
+    TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_chunked_truncated() {
+    FakeStream stream("5\r\nhello\r\n6\r\n wo");
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL_STRING("hello wo", readAll(body).c_str());
+    TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_chunked_missing_last_chunk() {
+    FakeStream stream("5\r\nhello\r\n");
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL_STRING("hello", readAll(body).c_str());
+    TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_chunked_malformed_header() {
+    FakeStream stream("zz\r\nhello\r\n0\r\n\r\n" NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL(-1, body.read());
+    TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_chunked_missing_crlf_after_chunk() {
+    FakeStream stream("5\r\nhelloX\r\n0\r\n\r\n" NEXT_RESPONSE);
+    HttpsBody body;
+    body.start(&stream, -1, true);
+    TEST_ASSERT_EQUAL_STRING("hello", readAll(body).c_str());
+    TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_until_close_not_reusable() {
+    FakeStream stream("hello world");
+    HttpsBody body;
+    body.start(&stream, -1, false);
+    TEST_ASSERT_EQUAL_STRING("hello world", readAll(body).c_str());
+    TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_drain_without_start() {
+    HttpsBody body;
+    TEST_ASSERT_FALSE(body.drain());
+    TEST_ASSERT_EQUAL(-1, body.read());
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_content_length);
+    RUN_TEST(test_content_length_zero);
+    RUN_TEST(test_chunked);
+    RUN_TEST(test_chunked_uppercase_size);
+    RUN_TEST(test_chunked_read_bytes_across_chunks);
+    RUN_TEST(test_chunked_available_stays_in_chunk);
+    RUN_TEST(test_available_limited_by_stream);
+    RUN_TEST(test_content_length_drain_after_partial_read);
+    RUN_TEST(test_chunked_drain_after_partial_read);
+    RUN_TEST(test_peek_does_not_consume);
+    RUN_TEST(test_content_length_truncated);
+    RUN_TEST(test_chunked_truncated);
+    RUN_TEST(test_chunked_missing_last_chunk);
+    RUN_TEST(test_chunked_malformed_header);
+    RUN_TEST(test_chunked_missing_crlf_after_chunk);
+    RUN_TEST(test_until_close_not_reusable);
+    RUN_TEST(test_drain_without_start);
+    return UNITY_END();
+}
@@ -0,0 +1,153 @@
+// Host test of the power lock rules: 'pio test -e native -f test_power_policy'
+//
+// PowerPolicy is fed activity events and millisecond times; the tests
+// check how long each subsystem lingers after its last activity and which
+// locks the active subsystems add up to.
+
+#include <unity.h>
+#include "PowerPolicy.h"
+
+static void assertLocks(const PowerLocks& locks, bool cpuMax, bool apbMax, bool noLightSleep) {
+    TEST_ASSERT_EQUAL(cpuMax, locks.cpuMax);
+    TEST_ASSERT_EQUAL(apbMax, locks.apbMax);
+    TEST_ASSERT_EQUAL(noLightSleep, locks.noLightSleep);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_idle_holds_nothing() {
+    PowerPolicy policy;
+    // lastActivityMs starts at 0; that must not count as activity at time 0
+    assertLocks(policy.evaluate(0), false, false, false);
+    assertLocks(policy.evaluate(50), false, false, false);
+    for (int i = 0; i < (int)PowerSubsystem::COUNT; i++) {
+        TEST_ASSERT_FALSE(policy.isActive((PowerSubsystem)i, 0));
+    }
+}
+
+void test_pulse_lingers() {
+    PowerPolicy policy;
+    policy.pulse(PowerSubsystem::RENDER, 1000);
+    TEST_ASSERT_TRUE(policy.isActive(PowerSubsystem::RENDER, 1000));
+    TEST_ASSERT_TRUE(policy.isActive(PowerSubsystem::RENDER, 1099));
+    TEST_ASSERT_FALSE(policy.isActive(PowerSubsystem::RENDER, 1100));
+
+    policy.pulse(PowerSubsystem::TOUCH, 1000);
+    TEST_ASSERT_TRUE(policy.isActive(PowerSubsystem::TOUCH, 3999));
+    TEST_ASSERT_FALSE(policy.isActive(PowerSubsystem::TOUCH, 4000));
+}
+
+void test_pulse_extends_linger() {
+    PowerPolicy policy;
+    policy.pulse(PowerSubsystem::RENDER, 1000);
+    policy.pulse(PowerSubsystem::RENDER, 1080);
+    TEST_ASSERT_TRUE(policy.isActive(PowerSubsystem::RENDER, 1150));
+    TEST_ASSERT_FALSE(policy.isActive(PowerSubsystem::RENDER, 1180));
+}
+
+void test_held_until_released() {
+    PowerPolicy policy;
+    policy.setActive(PowerSubsystem::AUDIO, true, 1000);
+    TEST_ASSERT_TRUE(policy.isActive(PowerSubsystem::AUDIO, 1000000));
+
+    // Linger counts from the release, not from when it was set active
+    policy.setActive(PowerSubsystem::AUDIO, false, 1000000);
+    TEST_ASSERT_TRUE(policy.isActive(PowerSubsystem::AUDIO, 1000499));
+    TEST_ASSERT_FALSE(policy.isActive(PowerSubsystem::AUDIO, 1000500));
+}
+
+void test_release_without_hold_does_not_restart_linger() {
+    PowerPolicy policy;
+    policy.pulse(PowerSubsystem::NETWORK, 1000);
+    policy.setActive(PowerSubsystem::NETWORK, false, 1150);
+    TEST_ASSERT_FALSE(policy.isActive(PowerSubsystem::NETWORK, 1200));
+}
+
+void test_display_released_at_once() {
+    PowerPolicy policy;
+    policy.setActive(PowerSubsystem::DISPLAY, true, 0);
+    assertLocks(policy.evaluate(60000), false, false, true);
+
+    // Blanked: nothing is left that keeps the chip out of light sleep
+    policy.setActive(PowerSubsystem::DISPLAY, false, 60000);
+    assertLocks(policy.evaluate(60000), false, false, false);
+}
+
+void test_locks_per_subsystem() {
+    struct Expected {
+        PowerSubsystem subsystem;
+        bool cpuMax;
+        bool apbMax;
+        bool noLightSleep;
+    };
+    const Expected expected[] = {
+        {PowerSubsystem::DISPLAY, false, false, true},
+        {PowerSubsystem::RENDER,  true,  false, false},
+        {PowerSubsystem::AUDIO,   true,  true,  true},
+        {PowerSubsystem::NETWORK, true,  false, true},
+        {PowerSubsystem::TOUCH,   true,  false, false},
+    };
+    for (const Expected& e : expected) {
+        PowerPolicy policy;
+        policy.setActive(e.subsystem, true, 1000);
+        assertLocks(policy.evaluate(1000), e.cpuMax, e.apbMax, e.noLightSleep);
+    }
+}
+
+void test_locks_aggregate() {
+    PowerPolicy policy;
+    policy.pulse(PowerSubsystem::TOUCH, 1000);
+    policy.setActive(PowerSubsystem::NETWORK, true, 1000);
+    assertLocks(policy.evaluate(1000), true, false, true);
+
+    // Network done: touch alone still wants the full clock, sleep is allowed again
+    policy.setActive(PowerSubsystem::NETWORK, false, 1500);
+    assertLocks(policy.evaluate(1700), true, false, false);
+
+    // Touch linger over: nothing left
+    assertLocks(policy.evaluate(4000), false, false, false);
+}
+
+void test_audio_outlasts_render() {
+    PowerPolicy policy;
+    policy.setActive(PowerSubsystem::AUDIO, true, 0);
+    policy.pulse(PowerSubsystem::RENDER, 100);
+    policy.setActive(PowerSubsystem::AUDIO, false, 150);
+    assertLocks(policy.evaluate(200), true, true, true);
+    assertLocks(policy.evaluate(649), true, true, true);
+    assertLocks(policy.evaluate(650), false, false, false);
+}
+
+void test_linger_across_millis_wrap() {
+    PowerPolicy policy;
+    policy.pulse(PowerSubsystem::TOUCH, 0xFFFFFF00u);
+    TEST_ASSERT_TRUE(policy.isActive(PowerSubsystem::TOUCH, 0x10u));
+    TEST_ASSERT_FALSE(policy.isActive(PowerSubsystem::TOUCH, 0xFFFFFF00u + 3000u));
+}
+
+void test_subsystem_names() {
+    TEST_ASSERT_EQUAL_STRING("display", PowerPolicy::subsystemName(PowerSubsystem::DISPLAY));
+    TEST_ASSERT_EQUAL_STRING("touch", PowerPolicy::subsystemName(PowerSubsystem::TOUCH));
+    TEST_ASSERT_EQUAL_STRING("?", PowerPolicy::subsystemName(PowerSubsystem::COUNT));
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_holds_nothing);
+    RUN_TEST(test_pulse_lingers);
+    RUN_TEST(test_pulse_extends_linger);
+    RUN_TEST(test_held_until_released);
+    RUN_TEST(test_release_without_hold_does_not_restart_linger);
+    RUN_TEST(test_display_released_at_once);
+    RUN_TEST(test_locks_per_subsystem);
+    RUN_TEST(test_locks_aggregate);
+    RUN_TEST(test_audio_outlasts_render);
+    RUN_TEST(test_linger_across_millis_wrap);
+    RUN_TEST(test_subsystem_names);
+    return UNITY_END();
+}
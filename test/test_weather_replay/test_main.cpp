@@ -0,0 +1,375 @@
+// Host replay of recorded One Call payloads: 'pio test -e native -v'
+//
+// Every *.json in test/weather_payloads (or $WEATHER_PAYLOAD_DIR) goes
+// through replayWeatherPayload(), the same code the 'weather replay'
+// console command runs on the device. For each payload the report shows
+// bytes, parse time, the peak filtered document, the heap held and the
+// period summaries at several times of day in several time zones. The
+// test fails if a payload does not parse, if parsing allocates, or if the
+// incremental summaries ever differ from a full recomputation.
+//
+// A second test measures the peak memory of the streaming parse against
+// the whole-document parse it replaced: the body buffered in one block
+// and deserialized unfiltered into a WEATHER_WHOLE_DOC_SIZE document.
+//
+// Sizes are those of the host build; pointers and ArduinoJson's slots
+// are larger than on the ESP32-S3, the timings are not comparable.
+
+#include <Arduino.h>
+#include <dirent.h>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "WeatherModel.h"
+#include "WeatherPayloadReplay.h"
+
+#define WEATHER_WHOLE_DOC_SIZE      32768   // Document of the former whole-body parse
+
+#ifndef WEATHER_PAYLOAD_DIR
+#define WEATHER_PAYLOAD_DIR "test/weather_payloads"
+#endif
+
+//##################################################################################################
+// Heap accounting: every operator new and ArduinoJson allocation is counted with its size
+
+static size_t heapInUse = 0;
+static size_t heapPeak = 0;
+
+static const size_t HEAP_HEADER = alignof(max_align_t);
+
+static void* trackedAllocate(size_t size) {
+    uint8_t* block = static_cast<uint8_t*>(malloc(size + HEAP_HEADER));
+    if (block == nullptr) {
+        return nullptr;
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    heapInUse += size;
+    if (heapInUse > heapPeak) {
+        heapPeak = heapInUse;
+    }
+    return block + HEAP_HEADER;
+}
+
+static size_t trackedSize(void* pointer) {
+    return *reinterpret_cast<size_t*>(static_cast<uint8_t*>(pointer) - HEAP_HEADER);
+}
+
+static void trackedFree(void* pointer) {
+    if (pointer == nullptr) {
+        return;
+    }
+    heapInUse -= trackedSize(pointer);
+    free(static_cast<uint8_t*>(pointer) - HEAP_HEADER);
+}
+
+void* operator new(size_t size) {
+    void* pointer = trackedAllocate(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    trackedFree(pointer);
+}
+
+// ArduinoJson allocator for the whole-document comparison
+struct TrackedAllocator {
+    void* allocate(size_t size) { return trackedAllocate(size); }
+    void deallocate(void* pointer) { trackedFree(pointer); }
+    void* reallocate(void* pointer, size_t size) {
+        void* resized = trackedAllocate(size);
+        if (resized != nullptr && pointer != nullptr) {
+            memcpy(resized, pointer, min(size, trackedSize(pointer)));
+        }
+        trackedFree(pointer);
+        return resized;
+    }
+};
+
+typedef BasicJsonDocument<TrackedAllocator> TrackedJsonDocument;
+
+//##################################################################################################
+// Payload files
+
+class FileStream : public Stream {
+public:
+    explicit FileStream(FILE* file) : file(file) {}
+
+    int available() override {
+        long position = ftell(file);
+        fseek(file, 0, SEEK_END);
+        long end = ftell(file);
+        fseek(file, position, SEEK_SET);
+        return (int)(end - position);
+    }
+    int read() override { return fgetc(file); }
+    int peek() override {
+        int c = fgetc(file);
+        if (c >= 0) {
+            ungetc(c, file);
+        }
+        return c;
+    }
+    size_t readBytes(char* buffer, size_t length) override { return fread(buffer, 1, length, file); }
+
+private:
+    FILE* file;
+};
+
+// The first 'limit' bytes of another stream, as if the connection dropped there
+class CutStream : public Stream {
+public:
+    CutStream(Stream& source, size_t limit) : source(source), remaining(limit) {}
+
+    int available() override { return (int)min((size_t)max(source.available(), 0), remaining); }
+    int read() override {
+        if (remaining == 0) {
+            return -1;
+        }
+        remaining--;
+        return source.read();
+    }
+    int peek() override { return remaining ? source.peek() : -1; }
+    size_t readBytes(char* buffer, size_t length) override {
+        size_t got = source.readBytes(buffer, min(length, remaining));
+        remaining -= got;
+        return got;
+    }
+
+private:
+    Stream& source;
+    size_t remaining;
+};
+
+static std::string payloadDirectory() {
+    const char* dir = getenv("WEATHER_PAYLOAD_DIR");
+    return dir ? dir : WEATHER_PAYLOAD_DIR;
+}
+
+static std::vector<std::string> listPayloads() {
+    std::vector<std::string> names;
+    DIR* dir = opendir(payloadDirectory().c_str());
+    if (dir == nullptr) {
+        return names;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        size_t length = strlen(entry->d_name);
+        if (length > 5 && strcmp(entry->d_name + length - 5, ".json") == 0) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+//##################################################################################################
+// Tests
+
+static std::string savedZone;
+
+void setUp() {
+}
+
+void tearDown() {
+    if (savedZone.empty()) {
+        unsetenv("TZ");
+    } else {
+        setenv("TZ", savedZone.c_str(), 1);
+    }
+    tzset();
+}
+
+static void test_corpus_present() {
+    TEST_ASSERT_TRUE_MESSAGE(!listPayloads().empty(), "No payloads in " WEATHER_PAYLOAD_DIR);
+}
+
+static void test_replay_payloads() {
+    // As on the device: two models (the second for recomputations) and one set of parse buffers
+    size_t heapBefore = heapInUse;
+    WeatherModel* model = new WeatherModel[2];
+    WeatherParseBuffers* buffers = new WeatherParseBuffers();
+    size_t heapHeld = heapInUse - heapBefore;
+    printf("Model %u bytes, parse buffers %u bytes, held %u bytes\n", (unsigned)sizeof(WeatherModel),
+           (unsigned)sizeof(WeatherParseBuffers), (unsigned)heapHeld);
+
+    for (const std::string& name : listPayloads()) {
+        std::string path = payloadDirectory() + "/" + name;
+        FILE* file = fopen(path.c_str(), "rb");
+        TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+        FileStream stream(file);
+        printf("%s (%d bytes)\n", name.c_str(), stream.available());
+
+        buffers->reader.begin(&stream);
+        size_t heapStart = heapInUse;
+        heapPeak = heapInUse;
+        WeatherReplayResult result;
+        replayWeatherPayload(*buffers, model[0], model[1], result);
+        fclose(file);
+
+        size_t replayHeap = heapPeak - heapStart;
+        printf("  Heap: %u bytes held (models and parse buffers), peak +%u bytes during the replay\n",
+               (unsigned)heapHeld, (unsigned)replayHeap);
+        printf("  Summary: parse %u us, summarize max %u us, %u summary changes\n", result.parseUs,
+               result.maxSummarizeUs, result.changes);
+
+        TEST_ASSERT_TRUE_MESSAGE(result.parsed, name.c_str());
+        TEST_ASSERT_TRUE_MESSAGE(model[0].hourlyCount > 0, name.c_str());
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, result.mismatches, name.c_str());
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, replayHeap, name.c_str());
+    }
+
+    delete buffers;
+    delete[] model;
+}
+
+static void test_parse_memory() {
+    WeatherModel* model = new WeatherModel();
+
+    for (const std::string& name : listPayloads()) {
+        std::string path = payloadDirectory() + "/" + name;
+        FILE* file = fopen(path.c_str(), "rb");
+        TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+        FileStream stream(file);
+        size_t size = stream.available();
+
+        // Streaming: the parse buffers are all it needs, whatever the body size
+        size_t heapStart = heapInUse;
+        heapPeak = heapInUse;
+        uint32_t start = micros();
+        WeatherParseBuffers* buffers = new WeatherParseBuffers();
+        buffers->reader.begin(&stream);
+        size_t peakDocument = 0;
+        bool parsed = model->parse(*buffers, peakDocument);
+        uint32_t streamUs = micros() - start;
+        delete buffers;
+        size_t streamPeak = heapPeak - heapStart;
+
+        // Whole document: body in one block, then deserialized in full
+        rewind(file);
+        heapPeak = heapInUse;
+        start = micros();
+        char* body = new char[size];
+        size_t bodyBytes = stream.readBytes(body, size);
+        size_t wholeUsage = 0;
+        DeserializationError error;
+        {
+            TrackedJsonDocument doc(WEATHER_WHOLE_DOC_SIZE);
+            error = deserializeJson(doc, (const char*)body, bodyBytes);
+            wholeUsage = doc.memoryUsage();
+        }
+        uint32_t wholeUs = micros() - start;
+        delete[] body;
+        size_t wholePeak = heapPeak - heapStart;
+        fclose(file);
+
+        printf("%s (%u bytes)\n", name.c_str(), (unsigned)size);
+        printf("  Streaming: peak %u bytes, %u us (peak document %u bytes)\n", (unsigned)streamPeak, streamUs,
+               (unsigned)peakDocument);
+        printf("  Whole document: peak %u bytes, %u us (document %u of %u bytes%s%s)\n", (unsigned)wholePeak,
+               wholeUs, (unsigned)wholeUsage, WEATHER_WHOLE_DOC_SIZE, error ? ", " : "", error ? error.c_str() : "");
+
+        TEST_ASSERT_TRUE_MESSAGE(parsed, name.c_str());
+        TEST_ASSERT_TRUE_MESSAGE(streamPeak <= sizeof(WeatherParseBuffers), name.c_str());
+        TEST_ASSERT_TRUE_MESSAGE(streamPeak < wholePeak, name.c_str());
+    }
+
+    delete model;
+}
+
+// Offset just past the ']' closing the "hourly" array (0 if there is none)
+static size_t hourlyEnd(FILE* file) {
+    rewind(file);
+    const char* key = "\"hourly\":";
+    size_t matched = 0;
+    size_t offset = 0;
+    int depth = -1;
+    bool inString = false;
+    bool escaped = false;
+    int c;
+    while ((c = fgetc(file)) >= 0) {
+        offset++;
+        if (depth < 0) {
+            matched = c == key[matched] ? matched + 1 : (c == key[0] ? 1 : 0);
+            if (key[matched] == '\0') {
+                depth = 0;
+            }
+        } else if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+            }
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '[' || c == '{') {
+            depth++;
+        } else if ((c == ']' || c == '}') && --depth == 0) {
+            return offset;
+        }
+    }
+    return 0;
+}
+
+// A body cut off anywhere must fail the parse and leave the model as it was
+static void test_truncated_payloads() {
+    WeatherModel* model = new WeatherModel();
+    WeatherModel* before = new WeatherModel();
+    WeatherParseBuffers* buffers = new WeatherParseBuffers();
+
+    for (const std::string& name : listPayloads()) {
+        std::string path = payloadDirectory() + "/" + name;
+        FILE* file = fopen(path.c_str(), "rb");
+        TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+        FileStream stream(file);
+        size_t size = stream.available();
+
+        buffers->reader.begin(&stream);
+        size_t peakDocument = 0;
+        TEST_ASSERT_TRUE_MESSAGE(model->parse(*buffers, peakDocument), name.c_str());
+        memcpy((void*)before, (const void*)model, sizeof(WeatherModel));
+
+        // Every 97th byte, then each of the last ones up to the ']' closing "hourly"
+        size_t end = hourlyEnd(file);
+        TEST_ASSERT_TRUE_MESSAGE(end > 0, name.c_str());
+        int failures = 0;
+        for (size_t cut = 0; cut < end; cut = cut + 97 < end - 1 ? cut + 97 : cut + 1) {
+            rewind(file);
+            CutStream truncated(stream, cut);
+            buffers->reader.begin(&truncated);
+            if (model->parse(*buffers, peakDocument)) {
+                printf("  %s: parsed when cut at %u of %u bytes\n", name.c_str(), (unsigned)cut, (unsigned)size);
+                failures++;
+            }
+            TEST_ASSERT_TRUE_MESSAGE(memcmp((const void*)before, (const void*)model, sizeof(WeatherModel)) == 0,
+                                     name.c_str());
+        }
+        fclose(file);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, failures, name.c_str());
+    }
+
+    delete buffers;
+    delete before;
+    delete model;
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    const char* zone = getenv("TZ");
+    savedZone = zone ? zone : "";
+
+    UNITY_BEGIN();
+    RUN_TEST(test_corpus_present);
+    RUN_TEST(test_replay_payloads);
+    RUN_TEST(test_parse_memory);
+    RUN_TEST(test_truncated_payloads);
+    return UNITY_END();
+}